@@ -0,0 +1,58 @@
+#ifndef IOC_EARTH_BASEMAP_CACHE_H
+#define IOC_EARTH_BASEMAP_CACHE_H
+
+#include "LruCache.h"
+#include "MapProjection.h"
+#include <mapnik/datasource.hpp>
+#include <cstddef>
+#include <string>
+#include <utility>
+
+namespace ioc_earth {
+
+/**
+ * @brief Cache delle geometrie di base già proiettate
+ *
+ * Con una proiezione diversa da longlat Mapnik riproietterebbe ogni vertice
+ * degli shapefile (coste, confini) a ogni rendering. La cache legge lo
+ * shapefile una volta per proiezione, trasforma le geometrie con
+ * MapProjection e le conserva in un memory datasource già nel sistema di
+ * riferimento della mappa, spezzando le linee dove escono dalla zona
+ * visibile (emisfero nascosto, polo opposto). Una voce viene ricalcolata
+ * solo quando cambiano i parametri della proiezione (stringa PROJ) o il
+ * file. Thread-safe.
+ */
+class BasemapCache {
+public:
+    /// Numero di coppie (shapefile, proiezione) mantenute in memoria
+    static constexpr std::size_t kCacheCapacity = 8;
+
+    /**
+     * @brief Istanza condivisa da tutti i renderer
+     */
+    static BasemapCache& shared();
+
+    /**
+     * @brief Datasource dello shapefile proiettato
+     * @param shapefile_path Percorso al file .shp
+     * @param projection Proiezione di destinazione
+     * @return Datasource da usare con srs = projection.proj4(), nullptr in caso di errore
+     */
+    mapnik::datasource_ptr get(const std::string& shapefile_path, const MapProjection& projection);
+
+    /**
+     * @brief Svuota la cache
+     */
+    void clear();
+
+private:
+    // Chiave: (shapefile, stringa PROJ)
+    LruCache<std::pair<std::string, std::string>, mapnik::datasource_ptr> cache_{kCacheCapacity};
+
+    static mapnik::datasource_ptr build(const std::string& shapefile_path,
+                                        const MapProjection& projection);
+};
+
+} // namespace ioc_earth
+
+#endif // IOC_EARTH_BASEMAP_CACHE_H
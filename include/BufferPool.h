@@ -0,0 +1,71 @@
+#ifndef IOC_EARTH_BUFFER_POOL_H
+#define IOC_EARTH_BUFFER_POOL_H
+
+#include <mapnik/image.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ioc_earth {
+
+/**
+ * @brief Pool condiviso di immagini RGBA e di buffer per i dati codificati
+ *
+ * Un canvas 1600x1200 sono 8 MB: allocarlo e azzerarlo a ogni rendering
+ * costa page fault visibili con molte richieste al secondo. Le immagini
+ * prese dal pool tornano al pool quando il puntatore viene distrutto e
+ * vengono riusate per le richieste della stessa dimensione; i buffer di
+ * byte tornano al pool quando l'ultimo shared_ptr viene rilasciato, quindi
+ * una cache può tenerli per riferimento senza copiarli.
+ *
+ * Il contenuto delle immagini riusate non è azzerato: agg_renderer le
+ * riempie con lo sfondo della mappa. La memoria trattenuta è limitata da
+ * kMaxPooledBytes; le restituzioni oltre il limite vengono liberate.
+ */
+class BufferPool {
+public:
+    /// Memoria massima trattenuta dal pool (immagini + buffer)
+    static constexpr std::size_t kMaxPooledBytes = std::size_t(256) << 20;
+
+    struct ImageReturn {
+        void operator()(mapnik::image_rgba8* image) const;
+    };
+    using ImagePtr = std::unique_ptr<mapnik::image_rgba8, ImageReturn>;
+    using BytesPtr = std::shared_ptr<std::vector<std::uint8_t>>;
+
+    static BufferPool& shared();
+
+    /**
+     * @brief Immagine width x height, riusata se disponibile
+     */
+    ImagePtr acquireImage(unsigned int width, unsigned int height);
+
+    /**
+     * @brief Buffer vuoto con almeno capacity byte riservati
+     */
+    BytesPtr acquireBytes(std::size_t capacity = 0);
+
+    /**
+     * @brief Libera tutta la memoria trattenuta
+     */
+    void trim();
+
+    std::size_t pooledBytes() const;
+
+private:
+    BufferPool() = default;
+
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<mapnik::image_rgba8>> images_;
+    std::vector<std::unique_ptr<std::vector<std::uint8_t>>> bytes_;
+    std::size_t pooled_bytes_ = 0;
+
+    void release(mapnik::image_rgba8* image);
+    void release(std::vector<std::uint8_t>* bytes);
+};
+
+} // namespace ioc_earth
+
+#endif // IOC_EARTH_BUFFER_POOL_H
@@ -0,0 +1,92 @@
+#ifndef IOC_EARTH_CSV_FORMAT_H
+#define IOC_EARTH_CSV_FORMAT_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace ioc_earth {
+
+/**
+ * @brief Campo CSV secondo RFC 4180
+ *
+ * Tra virgolette, con le virgolette interne raddoppiate, se contiene
+ * separatori, virgolette o a capo, se ha spazi ai bordi (che altrimenti
+ * verrebbero tolti in lettura) o se inizia con '#' (che in testa alla
+ * riga la renderebbe un commento).
+ */
+inline std::string csvField(const std::string& text) {
+    const bool quote = text.find_first_of(",\"\r\n") != std::string::npos ||
+                       (!text.empty() && (text.front() == '#' || text.front() == ' ' ||
+                                          text.front() == '\t' || text.back() == ' ' ||
+                                          text.back() == '\t'));
+    if (!quote) {
+        return text;
+    }
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"') quoted += '"';
+        quoted += c;
+    }
+    quoted += '"';
+    return quoted;
+}
+
+/**
+ * @brief Divide un record CSV (RFC 4180) nei suoi campi
+ *
+ * I campi tra virgolette possono contenere separatori, a capo e virgolette
+ * raddoppiate e vengono restituiti senza modifiche; quelli senza virgolette
+ * vengono ripuliti da spazi, tabulazioni e '\r' ai bordi.
+ * @param record Testo del record (più righe se un campo contiene a capo)
+ * @param fields Uscita: campi del record
+ * @return false se il record termina dentro un campo tra virgolette: il
+ *         chiamante aggiunge la riga successiva e riprova
+ */
+inline bool splitCsvRecord(const std::string& record, std::vector<std::string>& fields) {
+    fields.clear();
+    const std::size_t n = record.size();
+    std::size_t i = 0;
+    while (true) {
+        std::size_t start = i;
+        while (i < n && (record[i] == ' ' || record[i] == '\t')) ++i;
+        std::string field;
+        if (i < n && record[i] == '"') {
+            bool closed = false;
+            for (++i; i < n; ++i) {
+                if (record[i] != '"') {
+                    field += record[i];
+                } else if (i + 1 < n && record[i + 1] == '"') {
+                    field += '"';
+                    ++i;
+                } else {
+                    closed = true;
+                    ++i;
+                    break;
+                }
+            }
+            if (!closed) {
+                return false;
+            }
+            // Dopo la virgoletta di chiusura conta solo il separatore
+            while (i < n && record[i] != ',') ++i;
+        } else {
+            i = record.find(',', start);
+            if (i == std::string::npos) i = n;
+            const std::size_t first = record.find_first_not_of(" \t\r", start);
+            const std::size_t last = record.find_last_not_of(" \t\r", i - (i > 0 ? 1 : 0));
+            if (first != std::string::npos && first < i && last != std::string::npos && last >= first) {
+                field = record.substr(first, last - first + 1);
+            }
+        }
+        fields.push_back(std::move(field));
+        if (i >= n) {
+            return true;
+        }
+        ++i;
+    }
+}
+
+} // namespace ioc_earth
+
+#endif // IOC_EARTH_CSV_FORMAT_H
@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include "ImageFormat.h"
+#include "SkyProjection.h"
 
 namespace ioc_earth {
 
@@ -17,6 +19,8 @@ struct SAOStar {
     double magnitude;            // Magnitudine visuale
     std::string spectral_type;   // Tipo spettrale
     std::string constellation;   // Costellazione
+    double pm_ra_mas_yr = 0.0;   // Moto proprio in RA, μα·cosδ (mas/anno)
+    double pm_dec_mas_yr = 0.0;  // Moto proprio in Dec (mas/anno)
 };
 
 /**
@@ -50,6 +54,11 @@ struct TargetInfo {
     std::vector<std::string> trajectory_times;         // Timestamp
 };
 
+/// Dataset immutabili condivisibili tra più finder chart senza copie
+using SAOCatalogPtr = std::shared_ptr<const std::vector<SAOStar>>;
+using ConstellationLineSetPtr = std::shared_ptr<const std::vector<ConstellationLine>>;
+using ConstellationBoundarySetPtr = std::shared_ptr<const std::vector<ConstellationBoundary>>;
+
 /**
  * @brief Renderer per carte di avvicinamento astronomiche
  * 
@@ -96,23 +105,53 @@ public:
      */
     void addSAOStars(const std::vector<SAOStar>& stars);
     
+    /**
+     * @brief Aggiunge stelle SAO spostando il vector senza copiarlo
+     * @param stars Vector di stelle SAO (rvalue)
+     */
+    void addSAOStars(std::vector<SAOStar>&& stars);
+    
+    /**
+     * @brief Aggiunge stelle SAO da un catalogo condiviso (nessuna copia)
+     * 
+     * Utile per generare molte finder chart sullo stesso catalogo.
+     * @param stars Catalogo immutabile condiviso
+     */
+    void addSAOStars(SAOCatalogPtr stars);
+    
     /**
      * @brief Aggiunge linee delle costellazioni
      * @param lines Vector di linee
      */
     void addConstellationLines(const std::vector<ConstellationLine>& lines);
+    void addConstellationLines(std::vector<ConstellationLine>&& lines);
+    void addConstellationLines(ConstellationLineSetPtr lines);
     
     /**
      * @brief Aggiunge confini delle costellazioni
      * @param boundaries Vector di confini
      */
     void addConstellationBoundaries(const std::vector<ConstellationBoundary>& boundaries);
+    void addConstellationBoundaries(std::vector<ConstellationBoundary>&& boundaries);
+    void addConstellationBoundaries(ConstellationBoundarySetPtr boundaries);
+    
+    /**
+     * @brief Imposta l'epoca di osservazione delle stelle
+     * 
+     * Le stelle SAO vengono mostrate alla data dell'evento applicando il moto
+     * proprio (StarCatalogTransform::shared(), con cache). Non vengono
+     * precesse: centro, target e costellazioni sono nell'equinozio J2000.
+     * @param epoch_jd Giorno giuliano dell'evento (0 = posizioni del catalogo)
+     */
+    void setObservationEpoch(double epoch_jd);
     
     /**
      * @brief Imposta il target da evidenziare
      * @param target Informazioni sul target
      */
     void setTarget(const TargetInfo& target);
+    void setTarget(TargetInfo&& target);
+    void setTarget(std::shared_ptr<const TargetInfo> target);
     
     /**
      * @brief Stile di rendering della carta
@@ -136,6 +175,11 @@ public:
         bool show_magnitude_scale = true;             // Dimensione stella = f(mag)
         
         int label_font_size = 8;
+        double grid_step_degrees = 1.0;               // Spaziatura griglia RA/Dec
+        
+        // Proiezione gnomonica: i cerchi massimi restano rette come
+        // nell'oculare e nelle carte stampate
+        SkyProjectionType projection = SkyProjectionType::Gnomonic;
     };
     
     void setChartStyle(const ChartStyle& style);
@@ -143,10 +187,11 @@ public:
     
     /**
      * @brief Renderizza la finder chart
-     * @param output_path Percorso file PNG output
+     * @param output_path Percorso file immagine output
+     * @param format Formato e compressione (PNG RGBA di default)
      * @return true se successo
      */
-    bool renderFinderChart(const std::string& output_path);
+    bool renderFinderChart(const std::string& output_path, const ImageFormat& format = ImageFormat());
     
     /**
      * @brief Renderizza in buffer
@@ -182,16 +227,26 @@ private:
     double field_of_view_;
     double mag_limit_;
     
-    std::vector<SAOStar> stars_;
-    std::vector<ConstellationLine> constellation_lines_;
-    std::vector<ConstellationBoundary> constellation_boundaries_;
-    TargetInfo target_;
+    // Dati immutabili, eventualmente condivisi con altre finder chart
+    SAOCatalogPtr stars_;
+    ConstellationLineSetPtr constellation_lines_;
+    ConstellationBoundarySetPtr constellation_boundaries_;
+    std::shared_ptr<const TargetInfo> target_;
     
     ChartStyle style_;
+    double observation_epoch_jd_ = 0.0;
     
     mutable std::vector<uint8_t> last_rendered_buffer_;
     
-    // Conversione coordinate celesti -> pixel
+    // Proiezione corrente e semi-dimensioni del campo sul piano (gradi)
+    SkyProjection projection_;
+    double half_width_ = 0.0;
+    double half_height_ = 0.0;
+    
+    void updateProjection();
+    SkyBox fieldRegion() const;
+    
+    // Conversione coordinate celesti -> pixel (-1, -1 se non proiettabile)
     void celestialToPixel(double ra, double dec, int& x, int& y) const;
     
     // Rendering componenti
@@ -0,0 +1,111 @@
+#ifndef IOC_EARTH_GLYPH_CACHE_H
+#define IOC_EARTH_GLYPH_CACHE_H
+
+#include "LruCache.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct FT_LibraryRec_;
+struct FT_FaceRec_;
+
+namespace ioc_earth {
+
+/**
+ * @brief Glifi rasterizzati per carattere, dimensione e alone
+ *
+ * Le etichette di un campo stellare ripetono poche decine di caratteri
+ * ("SAO ", cifre, lettere greche): ogni glifo viene rasterizzato con
+ * FreeType (già dipendenza di Mapnik) alla prima richiesta e poi riusato
+ * da tutte le etichette e da tutti i renderer, insieme alla sua maschera
+ * di alone già dilatata. I caratteri sono cercati per nome tra quelli
+ * registrati in mapnik::freetype_engine (es. "DejaVu Sans" trova
+ * "DejaVu Sans Book"). La cache tiene i kFontCapacity caratteri usati più
+ * di recente (nome, dimensione, alone): con fattori di scala arbitrari le
+ * dimensioni non si accumulano. I glifi appartengono al loro Font e i
+ * puntatori restano validi finché qualcuno tiene lo shared_ptr del Font;
+ * la FT_Face viene chiusa con l'ultimo riferimento. Thread-safe.
+ */
+class GlyphCache {
+public:
+    /**
+     * @brief Maschere di copertura di un glifo
+     */
+    struct Glyph {
+        int left = 0;                          // Dalla penna al bordo sinistro
+        int top = 0;                           // Dalla linea di base al bordo superiore (verso l'alto)
+        int width = 0;
+        int height = 0;
+        double advance = 0.0;                  // Avanzamento della penna in pixel
+        std::vector<std::uint8_t> coverage;    // width × height
+        std::vector<std::uint8_t> halo;        // (width + 2r) × (height + 2r), r = raggio dell'alone
+    };
+
+    /**
+     * @brief Carattere a una dimensione, con i glifi già rasterizzati
+     */
+    class Font {
+    public:
+        Font() = default;
+        Font(const Font&) = delete;
+        Font& operator=(const Font&) = delete;
+        ~Font();
+
+        double ascender() const { return ascender_; }
+        double lineHeight() const { return line_height_; }
+        unsigned int haloRadius() const { return halo_radius_; }
+
+    private:
+        friend class GlyphCache;
+        FT_FaceRec_* face_ = nullptr;
+        double ascender_ = 0.0;
+        double line_height_ = 0.0;
+        unsigned int halo_radius_ = 0;
+        mutable std::unordered_map<char32_t, std::unique_ptr<Glyph>> glyphs_;
+    };
+
+    static GlyphCache& shared();
+
+    /**
+     * @brief Carattere registrato in Mapnik alla dimensione data
+     * @param face_name Nome del carattere (es. "DejaVu Sans")
+     * @param pixel_size Altezza em in pixel
+     * @param halo_radius Raggio dell'alone in pixel (0: nessuno)
+     * @return nullptr se il carattere non è registrato o non è leggibile
+     */
+    std::shared_ptr<const Font> font(const std::string& face_name, unsigned int pixel_size,
+                                     unsigned int halo_radius);
+
+    /**
+     * @brief Glifi di un testo UTF-8, rasterizzati alla prima richiesta
+     * @param font Carattere restituito da font()
+     * @param text Testo UTF-8, anche su più righe
+     * @param glyphs Uscita: un glifo per carattere e nullptr per ogni a capo;
+     *               i caratteri che il font non contiene vengono saltati
+     */
+    void glyphs(const Font& font, const std::string& text, std::vector<const Glyph*>& glyphs);
+
+    /// Caratteri (nome, dimensione, alone) tenuti in cache
+    static constexpr std::size_t kFontCapacity = 32;
+
+private:
+    GlyphCache() = default;
+
+    using FontKey = std::pair<std::string, std::pair<unsigned int, unsigned int>>;
+
+    std::mutex mutex_;
+    FT_LibraryRec_* library_ = nullptr;
+    LruCache<FontKey, std::shared_ptr<Font>> fonts_{kFontCapacity};
+    std::set<std::string> missing_faces_;      // Un solo avviso per carattere non disponibile
+
+    const Glyph* rasterize(const Font& font, char32_t code);
+};
+
+} // namespace ioc_earth
+
+#endif // IOC_EARTH_GLYPH_CACHE_H
@@ -0,0 +1,83 @@
+#ifndef IOC_EARTH_IMAGE_FORMAT_H
+#define IOC_EARTH_IMAGE_FORMAT_H
+
+#include <string>
+
+namespace ioc_earth {
+
+/**
+ * @brief Formato e parametri di codifica delle immagini prodotte
+ *
+ * Le mappe di default sono quasi in bianco e nero: in PNG8 con palette
+ * quantizzata occupano una frazione del PNG RGBA, e senza canale alfa
+ * (sfondo opaco) il file si riduce ancora. Il livello zlib permette di
+ * scegliere tra codifica veloce (1) e file minimi (9). JPEG e WebP sono
+ * disponibili se Mapnik è stato compilato con il relativo supporto;
+ * altrimenti il salvataggio fallisce con un errore.
+ *
+ * SVG e PDF sono uscite vettoriali (backend Cairo di Mapnik) per la
+ * stampa: stessa scena del raster, dimensioni della mappa in punti
+ * tipografici (1/72"). Sono disponibili solo per il salvataggio su file.
+ */
+struct ImageFormat {
+    enum class Type {
+        PNG,    // RGBA a 32 bit
+        PNG8,   // Palette quantizzata (fino a 256 colori)
+        JPEG,
+        WebP,
+        SVG,    // Vettoriale (Cairo)
+        PDF     // Vettoriale (Cairo)
+    };
+
+    /// Strategia di compressione zlib per PNG e PNG8
+    enum class Strategy {
+        Default,
+        Filtered,
+        HuffmanOnly,
+        RLE
+    };
+
+    Type type = Type::PNG;
+    int compression_level = -1;      // zlib 0-9 (-1: predefinito)
+    Strategy strategy = Strategy::Default;
+    unsigned int colors = 256;       // Colori della palette PNG8 (2-256)
+    bool alpha = true;               // false: nessun canale alfa (PNG/PNG8)
+    int quality = 85;                // JPEG/WebP 0-100
+
+    static ImageFormat png(int compression_level = -1);
+    static ImageFormat png8(unsigned int colors = 256, int compression_level = -1);
+    static ImageFormat jpeg(int quality = 85);
+    static ImageFormat webp(int quality = 85);
+    static ImageFormat svg();
+    static ImageFormat pdf();
+
+    /**
+     * @brief Interpreta "png", "png8", "jpeg"/"jpg", "webp", "svg", "pdf" (es. estensioni)
+     * @return false se il nome non è riconosciuto
+     */
+    static bool fromName(const std::string& name, ImageFormat& format);
+
+    /**
+     * @brief true per il PNG RGBA con strategia predefinita, che i renderer
+     *        codificano direttamente (anche a fasce)
+     */
+    bool isPlainPNG() const;
+
+    /// true per SVG e PDF
+    bool isVector() const { return type == Type::SVG || type == Type::PDF; }
+
+    /**
+     * @brief Stringa di formato per mapnik::save_to_file/save_to_string
+     *
+     * Es. "png8:m=h:c=64:z=9:t=0", "jpeg80", "webp:quality=75"; per i
+     * formati vettoriali il tipo di superficie Cairo ("svg", "pdf").
+     */
+    std::string mapnikFormat() const;
+
+    /// Estensione del file senza punto ("png", "jpg", "webp", "svg", "pdf")
+    std::string extension() const;
+};
+
+} // namespace ioc_earth
+
+#endif // IOC_EARTH_IMAGE_FORMAT_H
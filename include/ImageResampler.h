@@ -0,0 +1,39 @@
+#ifndef IOC_EARTH_IMAGE_RESAMPLER_H
+#define IOC_EARTH_IMAGE_RESAMPLER_H
+
+#include <mapnik/image.hpp>
+
+namespace ioc_earth {
+
+/**
+ * @brief Riduzione di immagini RGBA per media d'area
+ *
+ * Ogni pixel di destinazione è la media dei pixel sorgente che copre,
+ * pesati per la frazione di area (filtro box esatto, anche con fattori
+ * non interi): nessun aliasing sulle linee sottili della mappa, a
+ * differenza del campionamento al pixel più vicino. Il filtro è separabile:
+ * prima le righe sorgente vengono sommate in verticale, poi ogni riga
+ * intermedia in orizzontale.
+ *
+ * La media è fatta sui colori premoltiplicati per l'alfa, altrimenti il
+ * colore dei pixel trasparenti (sfondo non disegnato) sbaverebbe sui bordi
+ * di linee e marker. agg_renderer consegna l'immagine non premoltiplicata:
+ * in quel caso i canali vengono premoltiplicati durante la somma e
+ * riportati a colori diretti alla fine. La destinazione ha lo stesso stato
+ * della sorgente.
+ */
+class ImageResampler {
+public:
+    /**
+     * @brief Riduce source alle dimensioni di target
+     * @param source Immagine sorgente
+     * @param target Immagine di destinazione, già dimensionata (non più
+     *               grande di source in nessuna delle due direzioni)
+     * @return false se target è vuota o più grande della sorgente
+     */
+    static bool downsample(const mapnik::image_rgba8& source, mapnik::image_rgba8& target);
+};
+
+} // namespace ioc_earth
+
+#endif // IOC_EARTH_IMAGE_RESAMPLER_H
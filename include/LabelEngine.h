@@ -0,0 +1,163 @@
+#ifndef IOC_EARTH_LABEL_ENGINE_H
+#define IOC_EARTH_LABEL_ENGINE_H
+
+#include "GlyphCache.h"
+#include <mapnik/image.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ioc_earth {
+
+/**
+ * @brief Aspetto e priorità delle etichette di un insieme di punti
+ */
+struct LabelOptions {
+    std::string font = "DejaVu Sans";
+    std::string color = "#000000";
+    std::string halo_color = "#FFFFFF";
+    unsigned int halo_radius = 1;       // Pixel a scala 1 (0: nessun alone)
+    double marker_radius = 4.0;         // Ingombro del marker attorno al punto, pixel a scala 1
+    double priority = 0.0;              // Priorità dell'insieme rispetto agli altri
+    std::vector<double> priorities;     // Per posizione nella vista, sommate a priority (es. -magnitudine)
+};
+
+/**
+ * @brief Indice spaziale a griglia uniforme per i rettangoli occupati
+ *
+ * Ogni rettangolo viene registrato nelle celle che copre; una verifica
+ * guarda solo i rettangoli di quelle celle. Con celle dell'ordine della
+ * dimensione di un'etichetta il costo di inserimento e verifica è
+ * costante e il posizionamento di n etichette è lineare in n.
+ */
+class LabelCollisionIndex {
+public:
+    struct Box {
+        double min_x, min_y, max_x, max_y;
+    };
+
+    /**
+     * @param width Larghezza dell'area in pixel
+     * @param height Altezza dell'area in pixel
+     * @param cell_size Lato delle celle in pixel
+     */
+    LabelCollisionIndex(double width, double height, double cell_size = 64.0);
+
+    bool intersects(const Box& box) const;
+    void insert(const Box& box);
+
+private:
+    double cell_size_;
+    int columns_;
+    int rows_;
+    std::vector<Box> boxes_;
+    std::vector<std::vector<std::uint32_t>> cells_;
+
+    bool cellRange(const Box& box, int& x0, int& y0, int& x1, int& y1) const;
+};
+
+/**
+ * @brief Posizionamento e disegno delle etichette dei punti
+ *
+ * I marker di tutti i punti sono ostacoli; le etichette vengono poi
+ * considerate in ordine di priorità decrescente (a parità, nell'ordine di
+ * inserimento) e ognuna prende la prima di otto posizioni attorno al
+ * punto (destra, sinistra, sopra, sotto, diagonali) che resta nell'immagine
+ * e non tocca quanto già occupato; se nessuna è libera l'etichetta viene
+ * scartata. Il testo è composto con i glifi di GlyphCache, senza
+ * rasterizzare di nuovo i caratteri, e viene disegnato sopra il raster di
+ * Mapnik con un alone per la leggibilità (nelle uscite SVG e PDF le stesse
+ * maschere vanno sulla pagina Cairo). Il posizionamento è globale,
+ * quindi il disegno di fasce e tile è coerente con l'immagine intera.
+ */
+class LabelEngine {
+public:
+    /**
+     * @brief Glifo posizionato nell'immagine intera
+     */
+    struct PlacedGlyph {
+        const GlyphCache::Glyph* glyph;
+        int x;                              // Bordo sinistro della copertura
+        int y;                              // Bordo superiore della copertura
+    };
+
+    /**
+     * @brief Etichetta accettata, pronta da disegnare
+     */
+    struct PlacedLabel {
+        LabelCollisionIndex::Box box;
+        std::shared_ptr<const GlyphCache::Font> font;  // Tiene validi i glifi anche se esce dalla cache
+        std::vector<PlacedGlyph> glyphs;
+        std::uint8_t color[4];              // RGBA non premoltiplicato
+        std::uint8_t halo_color[4];
+        int halo_radius;
+    };
+
+    LabelEngine(unsigned int width, unsigned int height);
+
+    /**
+     * @brief Registra uno stile di testo
+     * @param options Carattere e colori
+     * @param pixel_size Dimensione del carattere in pixel effettivi
+     * @param scale_factor Fattore di scala di alone e marker
+     * @return Indice dello stile, -1 se il carattere non è disponibile
+     */
+    int addStyle(const LabelOptions& options, unsigned int pixel_size, double scale_factor);
+
+    /**
+     * @brief Occupa il cerchio del marker di un punto
+     */
+    void addObstacle(double x, double y, double radius);
+
+    /**
+     * @brief Candida un'etichetta per il punto (x, y) in pixel
+     * @param text Testo UTF-8, anche su più righe; deve restare valido fino a place()
+     * @param style Indice restituito da addStyle()
+     * @param marker_radius Distanza minima del testo dal punto
+     */
+    void addLabel(double x, double y, double priority, const std::string& text, int style,
+                  double marker_radius);
+
+    /**
+     * @brief Posiziona le etichette candidate
+     * @param placed Uscita: etichette accettate
+     */
+    void place(std::vector<PlacedLabel>& placed);
+
+    /**
+     * @brief Disegna le etichette in una regione dell'immagine intera
+     * @param labels Etichette da place()
+     * @param image Regione di destinazione (premoltiplicata o meno, secondo il suo flag)
+     * @param offset_x Colonna dell'immagine intera corrispondente alla colonna 0
+     * @param offset_y Riga dell'immagine intera corrispondente alla riga 0
+     */
+    static void draw(const std::vector<PlacedLabel>& labels, mapnik::image_rgba8& image,
+                     unsigned int offset_x, unsigned int offset_y);
+
+private:
+    struct Style {
+        std::shared_ptr<const GlyphCache::Font> font;
+        std::uint8_t color[4];
+        std::uint8_t halo_color[4];
+    };
+
+    struct Candidate {
+        double x, y;
+        double priority;
+        const std::string* text;
+        int style;
+        double marker_radius;
+    };
+
+    unsigned int width_;
+    unsigned int height_;
+    std::vector<Style> styles_;
+    std::vector<Candidate> candidates_;
+    LabelCollisionIndex index_;
+};
+
+} // namespace ioc_earth
+
+#endif // IOC_EARTH_LABEL_ENGINE_H
@@ -0,0 +1,96 @@
+#ifndef IOC_EARTH_LRU_CACHE_H
+#define IOC_EARTH_LRU_CACHE_H
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <utility>
+
+namespace ioc_earth {
+
+/**
+ * @brief Cache LRU thread-safe per risultati costosi da ricalcolare
+ *
+ * Le cache della libreria contengono poche voci (8-32) con chiavi che
+ * confrontano puntatori e parametri: la ricerca è lineare in una lista
+ * ordinata dall'uso, in testa la voce più recente. getOrCompute() calcola
+ * il valore fuori dal lock, così altri thread possono usare la cache nel
+ * frattempo; se due thread calcolano la stessa chiave vince il primo
+ * inserimento e tutti ricevono lo stesso valore.
+ *
+ * Key richiede operator== (std::pair e std::tuple vanno bene); Value è
+ * tipicamente uno shared_ptr, copiato a ogni lettura.
+ */
+template <typename Key, typename Value>
+class LruCache {
+public:
+    explicit LruCache(std::size_t capacity) : capacity_(capacity) {}
+
+    /**
+     * @brief Valore della chiave, calcolato con compute() se assente
+     * @param compute Funzione senza argomenti che restituisce Value; i
+     *                valori nulli (errori) non vengono memorizzati
+     */
+    template <typename Compute>
+    Value getOrCompute(const Key& key, Compute&& compute) {
+        Value value;
+        if (find(key, value)) {
+            return value;
+        }
+        value = compute();
+        if (!value) {
+            return value;
+        }
+        return insert(key, std::move(value));
+    }
+
+    /**
+     * @brief Cerca una chiave e la porta in testa
+     * @return false se la chiave non è in cache
+     */
+    bool find(const Key& key, Value& value) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+            if (it->first == key) {
+                entries_.splice(entries_.begin(), entries_, it);
+                value = it->second;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Inserisce un valore in testa, scartando la voce meno recente
+     * @return Il valore in cache (quello già presente se un altro thread
+     *         ha inserito la stessa chiave nel frattempo)
+     */
+    Value insert(const Key& key, Value value) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+            if (it->first == key) {
+                entries_.splice(entries_.begin(), entries_, it);
+                return it->second;
+            }
+        }
+        entries_.emplace_front(key, std::move(value));
+        if (entries_.size() > capacity_) {
+            entries_.pop_back();
+        }
+        return entries_.front().second;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.clear();
+    }
+
+private:
+    std::size_t capacity_;
+    std::mutex mutex_;
+    std::list<std::pair<Key, Value>> entries_;
+};
+
+} // namespace ioc_earth
+
+#endif // IOC_EARTH_LRU_CACHE_H
@@ -4,10 +4,20 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
 #include <mapnik/map.hpp>
+#include <mapnik/image.hpp>
+#include "BufferPool.h"
+#include "ImageFormat.h"
+#include "LabelEngine.h"
+#include "MapProjection.h"
 
 namespace ioc_earth {
 
+class PngStreamWriter;
+
 /**
  * @brief Struttura per rappresentare un punto GPS con timestamp
  */
@@ -20,6 +30,161 @@ struct GPSPoint {
         : longitude(lon), latitude(lat), timestamp(ts) {}
 };
 
+/**
+ * @brief Vista non proprietaria su una sequenza di coordinate (lon/lat o x/y)
+ * 
+ * Permette di passare a MapPathRenderer i dati del chiamante senza convertirli
+ * in un std::vector<GPSPoint> temporaneo: le coordinate vengono lette
+ * direttamente dalla memoria originale tramite un passo (stride) in byte.
+ * Supporta:
+ * - array separati di x e y
+ * - vettori di strutture qualsiasi tramite puntatori a membro
+ * - sottoinsiemi tramite un array di indici
+ * 
+ * La vista non possiede i dati: la sorgente deve restare valida per tutta
+ * la durata della chiamata che riceve la vista.
+ */
+class CoordinateView {
+public:
+    CoordinateView() = default;
+    
+    /**
+     * @brief Crea una vista su array di coordinate
+     * @param x Puntatore alla prima coordinata x (longitudine / RA)
+     * @param y Puntatore alla prima coordinata y (latitudine / Dec)
+     * @param count Numero di punti
+     * @param stride_bytes Distanza in byte tra due punti consecutivi
+     */
+    CoordinateView(const double* x, const double* y, std::size_t count,
+                   std::size_t stride_bytes = sizeof(double))
+        : x_(x), y_(y), count_(count), stride_(stride_bytes) {}
+    
+    /**
+     * @brief Crea una vista su un array di strutture tramite puntatori a membro
+     * @param data Primo elemento dell'array
+     * @param count Numero di elementi
+     * @param x_member Membro con la coordinata x (es. &GPSPoint::longitude)
+     * @param y_member Membro con la coordinata y (es. &GPSPoint::latitude)
+     */
+    template <typename T>
+    static CoordinateView fromMembers(const T* data, std::size_t count,
+                                      double T::* x_member, double T::* y_member) {
+        if (data == nullptr || count == 0) {
+            return CoordinateView();
+        }
+        return CoordinateView(&(data->*x_member), &(data->*y_member), count, sizeof(T));
+    }
+    
+    template <typename T>
+    static CoordinateView fromMembers(const std::vector<T>& items,
+                                      double T::* x_member, double T::* y_member) {
+        return fromMembers(items.data(), items.size(), x_member, y_member);
+    }
+    
+    /**
+     * @brief Come fromMembers, usando anche un membro stringa come etichetta
+     * @param label_member Membro con il testo dell'etichetta (es. &GPSPoint::timestamp)
+     */
+    template <typename T>
+    static CoordinateView fromMembers(const std::vector<T>& items,
+                                      double T::* x_member, double T::* y_member,
+                                      std::string T::* label_member) {
+        CoordinateView view = fromMembers(items.data(), items.size(), x_member, y_member);
+        if (!items.empty()) {
+            view.withLabels(&(items.data()->*label_member), sizeof(T));
+        }
+        return view;
+    }
+    
+    /**
+     * @brief Crea una vista su coppie (x, y), es. i punti RA/Dec dei confini
+     */
+    static CoordinateView fromPairs(const std::vector<std::pair<double, double>>& points) {
+        if (points.empty()) {
+            return CoordinateView();
+        }
+        return CoordinateView(&points.front().first, &points.front().second,
+                              points.size(), sizeof(std::pair<double, double>));
+    }
+    
+    /**
+     * @brief Associa etichette indicizzate come le coordinate sorgente
+     * @param first Prima etichetta
+     * @param stride_bytes Distanza in byte tra due etichette consecutive
+     */
+    CoordinateView& withLabels(const std::string* first,
+                               std::size_t stride_bytes = sizeof(std::string)) {
+        labels_ = first;
+        label_stride_ = stride_bytes;
+        labels_by_position_ = false;
+        return *this;
+    }
+    
+    /**
+     * @brief Associa etichette indicizzate per posizione nella vista
+     * 
+     * Utile quando le etichette sono generate dal chiamante solo per
+     * il sottoinsieme selezionato con withIndices().
+     * @param first Prima di size() etichette contigue
+     */
+    CoordinateView& withPositionLabels(const std::string* first) {
+        labels_ = first;
+        label_stride_ = sizeof(std::string);
+        labels_by_position_ = true;
+        return *this;
+    }
+    
+    /**
+     * @brief Restringe la vista a un sottoinsieme di punti sorgente
+     * @param indices Indici dei punti sorgente, nell'ordine desiderato
+     * @param count Numero di indici
+     */
+    CoordinateView& withIndices(const std::size_t* indices, std::size_t count) {
+        indices_ = indices;
+        index_count_ = count;
+        return *this;
+    }
+    
+    std::size_t size() const { return indices_ ? index_count_ : count_; }
+    bool empty() const { return size() == 0; }
+    
+    double x(std::size_t i) const { return at(x_, sourceIndex(i), stride_); }
+    double y(std::size_t i) const { return at(y_, sourceIndex(i), stride_); }
+    
+    /**
+     * @brief Etichetta del punto i-esimo
+     * @return Puntatore all'etichetta, nullptr se la vista non ha etichette
+     */
+    const std::string* label(std::size_t i) const {
+        if (labels_ == nullptr) {
+            return nullptr;
+        }
+        std::size_t index = labels_by_position_ ? i : sourceIndex(i);
+        return reinterpret_cast<const std::string*>(
+            reinterpret_cast<const char*>(labels_) + index * label_stride_);
+    }
+
+private:
+    const double* x_ = nullptr;
+    const double* y_ = nullptr;
+    std::size_t count_ = 0;
+    std::size_t stride_ = sizeof(double);
+    
+    const std::string* labels_ = nullptr;
+    std::size_t label_stride_ = sizeof(std::string);
+    bool labels_by_position_ = false;
+    
+    const std::size_t* indices_ = nullptr;
+    std::size_t index_count_ = 0;
+    
+    std::size_t sourceIndex(std::size_t i) const { return indices_ ? indices_[i] : i; }
+    
+    static double at(const double* base, std::size_t index, std::size_t stride) {
+        return *reinterpret_cast<const double*>(
+            reinterpret_cast<const char*>(base) + index * stride);
+    }
+};
+
 /**
  * @brief Classe per il rendering di mappe e tracciati GPS
  * 
@@ -30,6 +195,17 @@ struct GPSPoint {
  */
 class MapPathRenderer {
 public:
+    /**
+     * @brief Una delle dimensioni prodotte da renderToOutputs()
+     */
+    struct RenderOutput {
+        unsigned int width = 0;
+        unsigned int height = 0;          // 0: proporzionale alla larghezza
+        std::string path;                 // Vuoto: solo in memoria (data)
+        std::vector<std::uint8_t> data;   // Immagine codificata se path è vuoto
+        ImageFormat format;               // Formato dell'uscita (PNG RGBA di default)
+    };
+    
     /**
      * @brief Costruttore
      * @param width Larghezza dell'immagine in pixel
@@ -42,6 +218,17 @@ public:
      */
     ~MapPathRenderer();
     
+    /**
+     * @brief Imposta la proiezione della mappa (default: longlat)
+     * 
+     * Le coordinate passate agli altri metodi restano longitudine/latitudine.
+     * Gli shapefile aggiunti dopo la chiamata usano geometrie già proiettate
+     * dalla BasemapCache; va chiamato prima di setExtent().
+     * @param projection Proiezione di destinazione
+     */
+    void setProjection(const MapProjection& projection);
+    const MapProjection& getProjection() const { return projection_; }
+    
     /**
      * @brief Imposta l'estensione geografica della mappa
      * @param min_lon Longitudine minima
@@ -51,6 +238,24 @@ public:
      */
     void setExtent(double min_lon, double min_lat, double max_lon, double max_lat);
     
+    /**
+     * @brief Imposta l'estensione direttamente nel sistema della proiezione
+     * 
+     * Per chi lavora già in coordinate proiettate (es. i box delle
+     * tile XYZ in Mercatore), evitando il campionamento di projectBox.
+     */
+    void setProjectedExtent(double min_x, double min_y, double max_x, double max_y);
+    
+    /**
+     * @brief Restituisce l'estensione effettiva della mappa
+     * 
+     * Dopo setExtent() Mapnik allarga il box per rispettare le proporzioni
+     * dell'immagine: questa è l'area che corrisponde esattamente ai pixel.
+     * Con una proiezione diversa da longlat restituisce il box geografico
+     * che contiene l'area visibile.
+     */
+    void getExtent(double& min_lon, double& min_lat, double& max_lon, double& max_lat) const;
+    
     /**
      * @brief Aggiunge uno shapefile come layer di base
      * @param shapefile_path Percorso al file .shp
@@ -68,15 +273,122 @@ public:
                     const std::string& line_color = "blue", 
                     double line_width = 2.0);
     
+    /**
+     * @brief Aggiunge un tracciato leggendo le coordinate da una vista
+     * 
+     * Evita la copia in un std::vector<GPSPoint> intermedio.
+     * @param path Vista sulle coordinate del tracciato
+     * @param line_color Colore della linea
+     * @param line_width Spessore della linea
+     */
+    void addGPSPath(const CoordinateView& path,
+                    const std::string& line_color = "blue",
+                    double line_width = 2.0);
+    
+    /**
+     * @brief Aggiunge molti tracciati come un unico layer
+     * 
+     * Ogni tracciato diventa una feature con l'attributo "name": centinaia
+     * di percorsi costano un solo datasource, un solo stile e un solo layer.
+     * @param paths Viste sui tracciati (quelli vuoti vengono ignorati)
+     * @param names Nome di ciascun tracciato (può essere più corto di paths)
+     * @param layer_name Nome univoco del layer
+     * @param line_color Colore delle linee
+     * @param line_width Spessore delle linee
+     */
+    void addPathBatch(const std::vector<CoordinateView>& paths,
+                      const std::vector<std::string>& names,
+                      const std::string& layer_name,
+                      const std::string& line_color = "blue",
+                      double line_width = 2.0);
+    
+    /**
+     * @brief Aggiunge un raster RGBA georeferenziato (es. mappe di probabilità)
+     * 
+     * Il layer viene inserito nell'ordine di chiamata: aggiungerlo prima
+     * delle linee per disegnarlo sotto di esse.
+     * @param rgba Pixel RGBA non premoltiplicati, riga superiore per prima
+     * @param width Larghezza del raster
+     * @param height Altezza del raster
+     * @param min_lon Longitudine del bordo sinistro
+     * @param min_lat Latitudine del bordo inferiore
+     * @param max_lon Longitudine del bordo destro
+     * @param max_lat Latitudine del bordo superiore
+     * @param opacity Opacità complessiva del layer (0-1)
+     */
+    void addRasterOverlay(const std::vector<uint8_t>& rgba, unsigned int width, unsigned int height,
+                          double min_lon, double min_lat, double max_lon, double max_lat,
+                          double opacity = 1.0);
+    
     /**
      * @brief Aggiunge etichette ai punti GPS
      * @param points Vector di punti GPS da etichettare
      * @param label_field Campo da usare per l'etichetta ("timestamp" o custom)
      * @param font_size Dimensione del font
+     * @param options Carattere, colori e priorità delle etichette
      */
     void addPointLabels(const std::vector<GPSPoint>& points,
                        const std::string& label_field = "timestamp",
-                       int font_size = 10);
+                       int font_size = 10,
+                       const LabelOptions& options = LabelOptions());
+    
+    /**
+     * @brief Aggiunge punti etichettati leggendo le coordinate da una vista
+     * 
+     * I marker sono disegnati da Mapnik; i testi vengono posizionati dal
+     * LabelEngine al momento del rendering, insieme a quelli degli altri
+     * insiemi di punti: le etichette con priorità più alta scelgono per
+     * prime e quelle che non trovano spazio vengono omesse.
+     * @param points Vista sui punti (le etichette sono opzionali)
+     * @param label_field Campo da usare per l'etichetta
+     * @param font_size Dimensione del font in pixel (a scala 1)
+     * @param options Carattere, colori e priorità delle etichette
+     */
+    void addPointLabels(const CoordinateView& points,
+                       const std::string& label_field = "timestamp",
+                       int font_size = 10,
+                       const LabelOptions& options = LabelOptions());
+    
+    /**
+     * @brief Assegna a un gruppo i layer aggiunti da qui in poi
+     * 
+     * I gruppi (es. "basemap", "paths", "stations") vengono disegnati
+     * nell'ordine in cui compaiono la prima volta; un layer aggiunto dopo a
+     * un gruppo precedente resta comunque sotto i gruppi successivi. I layer
+     * aggiunti prima di qualsiasi chiamata appartengono al gruppo "".
+     * @param group Nome del gruppo
+     */
+    void beginLayerGroup(const std::string& group);
+    
+    /**
+     * @brief Rimuove dalla mappa i layer e gli stili di un gruppo
+     * 
+     * Il gruppo mantiene la sua posizione nell'ordine di disegno e va
+     * ripopolato con beginLayerGroup() seguito dagli add*().
+     */
+    void clearLayerGroup(const std::string& group);
+    
+    /**
+     * @brief Rendering incrementale per gruppi di layer
+     * 
+     * Ogni gruppo viene rasterizzato da solo su sfondo trasparente e il
+     * raster resta in cache; i rendering successivi rasterizzano solo i
+     * gruppi cambiati (layer aggiunti o rimossi) e ricompongono le cache
+     * sopra lo sfondo. Un cambio di estensione, dimensione o fattore di
+     * scala invalida tutte le cache; un cambio del solo sfondo costa una
+     * composizione. Le etichette evitano le collisioni solo all'interno del
+     * proprio gruppo.
+     * @param image Immagine di destinazione, delle dimensioni della mappa
+     * @return true se il rendering è avvenuto con successo
+     */
+    bool renderLayerGroups(mapnik::image_rgba8& image);
+    
+    /**
+     * @brief Come renderLayerGroups(image) ma codifica il risultato in memoria
+     * @param data Buffer di destinazione (il contenuto viene sostituito)
+     * @param format Formato raster e compressione
+     */
+    bool renderLayerGroups(std::vector<std::uint8_t>& data, const ImageFormat& format);
     
     /**
      * @brief Imposta lo stile del background della mappa
@@ -85,11 +397,111 @@ public:
     void setBackgroundColor(const std::string& color);
     
     /**
-     * @brief Renderizza la mappa in un file PNG
-     * @param output_path Percorso del file PNG di output
+     * @brief Renderizza la mappa in un file immagine
+     * @param output_path Percorso del file di output
+     * @param format Formato e compressione (PNG RGBA di default); a fasce
+     *               è disponibile solo il PNG RGBA. Con ImageFormat::svg()
+     *               o pdf() la stessa mappa passa al renderer Cairo di
+     *               Mapnik e l'uscita è vettoriale, adatta alla stampa;
+     *               le etichette dei punti restano nelle posizioni del raster
+     * @return true se il rendering è avvenuto con successo
+     */
+    bool renderToFile(const std::string& output_path, const ImageFormat& format = ImageFormat());
+    
+    /**
+     * @brief Renderizza la mappa e la codifica in memoria nel formato dato
+     * @param data Buffer di destinazione (il contenuto viene sostituito)
+     * @param format Formato e compressione
+     * @return true se il rendering è avvenuto con successo
+     */
+    bool renderToBuffer(std::vector<std::uint8_t>& data, const ImageFormat& format);
+    
+    /**
+     * @brief Renderizza la mappa e la codifica come PNG in memoria
+     * 
+     * Nessun file temporaneo: l'immagine viene presa dal BufferPool e le
+     * righe codificate direttamente in png_data, che può essere anch'esso
+     * un buffer del pool. Rispetta setStripRendering() e setRenderThreads().
+     * @param png_data Buffer di destinazione (il contenuto viene sostituito)
+     * @param compression_level Livello zlib 0-9 (-1: predefinito di libpng)
+     * @return true se il rendering è avvenuto con successo
+     */
+    bool renderToPNG(std::vector<std::uint8_t>& png_data, int compression_level = -1);
+    
+    /**
+     * @brief Più dimensioni di uscita da un solo rendering
+     * 
+     * La mappa viene rasterizzata una volta alla dimensione piena; ogni
+     * uscita più piccola (es. miniatura e dettaglio) viene ottenuta per
+     * media d'area con ImageResampler. Riduzione e codifica delle
+     * uscite procedono in parallelo, una per thread. Le uscite non possono
+     * superare la dimensione della mappa; setStripRendering() non si
+     * applica perché serve l'immagine intera.
+     * @param outputs Dimensioni richieste; data viene riempito per le uscite senza path
+     * @return true se tutte le uscite sono state prodotte
+     */
+    bool renderToOutputs(std::vector<RenderOutput>& outputs);
+    
+    /**
+     * @brief Rendering a fasce orizzontali per immagini molto grandi
+     * 
+     * Con strip_height > 0 renderToFile() non alloca più l'immagine intera:
+     * renderizza fasce di strip_height righe (più overlap righe sopra e
+     * sotto, per simboli ed etichette a cavallo) con la stessa trasformazione
+     * della mappa completa e passa le righe al codificatore PNG man mano.
+     * La memoria è proporzionale a larghezza × (strip_height + 2·overlap).
+     * @param strip_height Righe per fascia (0: immagine intera, default)
+     * @param overlap Righe renderizzate in più sopra e sotto ogni fascia
+     */
+    void setStripRendering(unsigned int strip_height, unsigned int overlap = 64);
+    
+    /**
+     * @brief Rendering parallelo di una singola immagine
+     * 
+     * Con più di un thread l'immagine viene divisa in tile quadrate
+     * renderizzate in parallelo sulla stessa mappa (solo lettura) e poi
+     * ricomposte. Ogni tile usa la trasformazione della mappa intera tramite
+     * l'offset dell'agg_renderer e un bordo di pixel in più, quindi le
+     * giunzioni non si vedono. Vale per renderToFile(), renderToImage() e
+     * per le fasce di setStripRendering().
+     * @param threads Numero di thread (1: rendering sequenziale, default;
+     *                0: std::thread::hardware_concurrency())
+     */
+    void setRenderThreads(unsigned int threads);
+    
+    /**
+     * @brief Fattore di scala per schermi ad alta densità (es. 2 per retina)
+     * 
+     * L'immagine prodotta diventa larghezza·scala × altezza·scala con la
+     * stessa estensione geografica, e l'agg_renderer moltiplica per lo
+     * stesso fattore spessori delle linee, simboli e caratteri: i layer già
+     * aggiunti vengono riusati, non serve un secondo renderer. Anche i bordi
+     * di sovrapposizione di fasce e tile parallele vengono scalati.
+     * @param scale_factor Fattore > 0 (1: dimensione nominale, default)
+     * @return false se il fattore non è valido
+     */
+    bool setScaleFactor(double scale_factor);
+    
+    double scaleFactor() const { return scale_factor_; }
+    
+    /**
+     * @brief Renderizza la mappa in un'immagine in memoria
+     * 
+     * Permette di rendere più volte la stessa mappa (es. cambiando solo
+     * l'estensione) senza ricostruire i layer né passare da un file.
+     * @param image Immagine di destinazione, delle dimensioni della mappa
      * @return true se il rendering è avvenuto con successo
      */
-    bool renderToFile(const std::string& output_path);
+    bool renderToImage(mapnik::image_rgba8& image);
+    
+    unsigned int width() const { return width_; }
+    unsigned int height() const { return height_; }
+    
+    /**
+     * @brief Posizione in pixel di un punto geografico nell'estensione corrente
+     * @return false se il punto non è rappresentabile nella proiezione
+     */
+    bool geoToPixel(double lon, double lat, double& x, double& y) const;
     
     /**
      * @brief Calcola automaticamente l'estensione basata sui punti GPS
@@ -98,14 +510,79 @@ public:
      */
     void autoSetExtentFromPoints(const std::vector<GPSPoint>& points, 
                                   double margin_percent = 10.0);
+    
+    /**
+     * @brief Calcola automaticamente l'estensione da una vista di coordinate
+     * @param points Vista sui punti
+     * @param margin_percent Margine percentuale da aggiungere (default 10%)
+     */
+    void autoSetExtentFromPoints(const CoordinateView& points,
+                                  double margin_percent = 10.0);
 
 private:
+    /**
+     * @brief Gruppo di layer con il raster dell'ultimo rendering incrementale
+     */
+    static constexpr std::size_t kAllGroups = static_cast<std::size_t>(-1);
+    
+    struct LayerGroup {
+        std::string name;
+        bool dirty = true;               // Layer cambiati dopo l'ultima rasterizzazione
+        BufferPool::ImagePtr raster;     // Premoltiplicato, sfondo trasparente
+    };
+    
     std::unique_ptr<mapnik::Map> map_;
-    unsigned int width_;
+    MapProjection projection_;
+    unsigned int base_width_;
+    unsigned int base_height_;
+    unsigned int width_;     // Dimensioni effettive (base × scale_factor_)
     unsigned int height_;
+    double scale_factor_ = 1.0;
+    unsigned int strip_height_ = 0;
+    unsigned int strip_overlap_ = 64;
+    unsigned int render_threads_ = 1;
+    
+    // Gruppi in ordine di disegno; per ogni layer della mappa il gruppo e lo stile
+    std::vector<LayerGroup> layer_groups_;
+    std::vector<std::size_t> layer_group_of_;
+    std::vector<std::string> layer_style_of_;
+    std::size_t current_group_ = 0;
+    std::size_t next_style_id_ = 0;
+    mapnik::box2d<double> cached_extent_;   // Estensione dei raster in cache
+    
+    /**
+     * @brief Punti e testi di una chiamata ad addPointLabels()
+     */
+    struct LabelSet {
+        std::size_t group;
+        std::vector<double> lon;
+        std::vector<double> lat;
+        std::vector<std::string> texts;     // Vuoto: solo ostacolo
+        int font_size;
+        LabelOptions options;
+    };
+    std::vector<LabelSet> label_sets_;
+    
+    // Ultimo posizionamento, riusato da fasce e rendering con la stessa vista
+    mutable std::vector<LabelEngine::PlacedLabel> placed_labels_;
+    mutable bool placed_valid_ = false;
+    mutable std::size_t placed_group_ = 0;
+    mutable mapnik::box2d<double> placed_extent_;
+    mutable unsigned int placed_width_ = 0;
+    mutable unsigned int placed_height_ = 0;
     
     // Metodi helper privati
     void initializeMap();
+    void addGroupedLayer(mapnik::layer& layer, const std::string& style_prefix,
+                         const mapnik::feature_type_style& style);
+    void rasterizeLayerGroup(std::size_t group);
+    bool renderStripsToFile(const std::string& output_path, int compression_level);
+    bool renderVectorFile(const std::string& output_path, const ImageFormat& format);
+    bool encodeOutput(const mapnik::image_rgba8& image, RenderOutput& output) const;
+    bool writeStrips(PngStreamWriter& png) const;
+    void renderRegion(mapnik::image_rgba8& image, unsigned int offset_x, unsigned int offset_y,
+                      std::size_t group = kAllGroups) const;
+    const std::vector<LabelEngine::PlacedLabel>& placeLabels(std::size_t group) const;
     std::string createGeoJSONFromPoints(const std::vector<GPSPoint>& points);
 };
 
@@ -0,0 +1,99 @@
+#ifndef IOC_EARTH_MAP_PROJECTION_H
+#define IOC_EARTH_MAP_PROJECTION_H
+
+#include <string>
+
+namespace ioc_earth {
+
+/**
+ * @brief Proiezioni cartografiche disponibili per le mappe terrestri
+ */
+enum class MapProjectionType {
+    LongLat,           // Plate carrée (coordinate geografiche, default)
+    Mercator,          // Mercatore sferico
+    Orthographic,      // Globo visto dallo spazio
+    LambertConformal   // Conica conforme di Lambert (due paralleli standard)
+};
+
+/**
+ * @brief Proiezione della mappa terrestre
+ *
+ * Le proiezioni diverse da LongLat usano la sfera di raggio medio
+ * terrestre: le formule dirette e inverse di questa classe coincidono con
+ * quelle della stringa PROJ passata a Mapnik, così l'estensione e le
+ * geometrie proiettate in anticipo corrispondono esattamente a ciò che
+ * Mapnik disegna. Coordinate proiettate in metri.
+ */
+class MapProjection {
+public:
+    /// Raggio della sfera usata dalle proiezioni (m)
+    static constexpr double kSphereRadius = 6371008.8;
+
+    MapProjection() = default;
+
+    static MapProjection longLat();
+    static MapProjection mercator(double center_lon = 0.0);
+    static MapProjection orthographic(double center_lon, double center_lat);
+    static MapProjection lambertConformal(double center_lon, double center_lat,
+                                          double standard_parallel_1, double standard_parallel_2);
+
+    MapProjectionType type() const { return type_; }
+    bool isLongLat() const { return type_ == MapProjectionType::LongLat; }
+    double centerLon() const { return center_lon_; }
+    double centerLat() const { return center_lat_; }
+
+    /**
+     * @brief Stringa PROJ per Mapnik (identifica anche la proiezione nelle cache)
+     */
+    std::string proj4() const;
+
+    /**
+     * @brief Proietta un punto geografico
+     * @param x Uscita: coordinata est (m, gradi per LongLat)
+     * @param y Uscita: coordinata nord
+     * @return false se il punto non è visibile (emisfero nascosto
+     *         dell'ortografica, polo opposto della conica); x/y vengono
+     *         comunque portati sul bordo della zona proiettabile
+     */
+    bool forward(double lon, double lat, double& x, double& y) const;
+
+    /**
+     * @brief Coordinate geografiche di un punto proiettato
+     * @return false se il punto è fuori dalla zona proiettata
+     */
+    bool inverse(double x, double y, double& lon, double& lat) const;
+
+    /**
+     * @brief Box proiettato che contiene un rettangolo geografico
+     *
+     * Campiona bordi e interno del rettangolo: le linee di longitudine e
+     * latitudine costanti sono curve nelle proiezioni coniche e azimutali.
+     */
+    void projectBox(double min_lon, double min_lat, double max_lon, double max_lat,
+                    double& min_x, double& min_y, double& max_x, double& max_y) const;
+
+    /**
+     * @brief Box geografico che contiene un rettangolo proiettato (inverso di projectBox)
+     */
+    void geographicBox(double min_x, double min_y, double max_x, double max_y,
+                       double& min_lon, double& min_lat, double& max_lon, double& max_lat) const;
+
+    bool operator==(const MapProjection& other) const { return proj4() == other.proj4(); }
+    bool operator!=(const MapProjection& other) const { return !(*this == other); }
+
+private:
+    MapProjectionType type_ = MapProjectionType::LongLat;
+    double center_lon_ = 0.0;
+    double center_lat_ = 0.0;
+    double parallel_1_ = 0.0;
+    double parallel_2_ = 0.0;
+
+    // Costanti della conica di Lambert (calcolate alla creazione)
+    double lcc_n_ = 1.0;
+    double lcc_f_ = 1.0;
+    double lcc_rho0_ = 0.0;
+};
+
+} // namespace ioc_earth
+
+#endif // IOC_EARTH_MAP_PROJECTION_H
@@ -0,0 +1,117 @@
+#ifndef IOC_EARTH_NIGHT_OVERVIEW_RENDERER_H
+#define IOC_EARTH_NIGHT_OVERVIEW_RENDERER_H
+
+#include "OccultationRenderer.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ioc_earth {
+
+/**
+ * @brief Mappa riassuntiva di tutti gli eventi di una notte
+ *
+ * Disegna su un'unica mappa di base i percorsi di molti eventi (centinaia)
+ * in un intervallo di date. Le linee non diventano un layer per evento: le
+ * centrali, gli eventi evidenziati e i limiti sono uniti in pochi layer con
+ * una feature per evento (attributo "name"). Gli eventi fuori
+ * dall'estensione vengono scartati confrontando il loro box, calcolato una
+ * sola volta all'inserimento.
+ */
+class NightOverviewRenderer {
+public:
+    /**
+     * @brief Stile della mappa riassuntiva
+     */
+    struct OverviewStyle {
+        std::string background_color = "#FFFFFF";
+        std::string grid_color = "#CCCCCC";
+        bool show_grid = true;
+        double grid_step_degrees = 15.0;
+
+        std::string central_line_color = "#000000";
+        double central_line_width = 1.2;
+        std::string highlight_color = "#CC0000";        // Eventi con calo di magnitudine elevato
+        double highlight_min_drop = 1.0;                // Soglia per l'evidenziazione (mag)
+
+        bool show_sigma_limits = true;
+        std::string sigma_lines_color = "#999999";
+        double sigma_lines_width = 0.6;
+
+        bool show_labels = true;                        // Nome dell'asteroide a metà percorso
+        int label_font_size = 8;
+        double path_tolerance_pixels = 0.5;             // Densificazione geodetica (<=0: disattivata)
+    };
+
+    NightOverviewRenderer(unsigned int width, unsigned int height);
+    ~NightOverviewRenderer();
+
+    /**
+     * @brief Aggiunge un evento (dati condivisi, nessuna copia)
+     */
+    void addEvent(std::shared_ptr<const OccultationData> event);
+    void addEvents(const std::vector<std::shared_ptr<const OccultationData>>& events);
+    void clearEvents();
+    std::size_t eventCount() const { return events_.size(); }
+
+    /**
+     * @brief Limita la mappa agli eventi tra due istanti (ISO 8601 UTC)
+     *
+     * Il confronto usa OccultationData::date_time_utc. Stringhe vuote
+     * rimuovono il limite corrispondente.
+     * @return false se una delle date non è valida
+     */
+    bool setDateRange(const std::string& start_utc, const std::string& end_utc);
+
+    /**
+     * @brief Imposta un'estensione fissa (altrimenti calcolata dagli eventi)
+     */
+    void setExtent(double min_lon, double min_lat, double max_lon, double max_lat);
+    void setAutoExtent();
+
+    void setProjection(const MapProjection& projection) { projection_ = projection; }
+    void setStyle(const OverviewStyle& style) { style_ = style; }
+    OverviewStyle getStyle() const { return style_; }
+
+    /**
+     * @brief Renderizza la mappa riassuntiva
+     * @param output_path Percorso del file immagine di output
+     * @param include_shapefile Se true, include i confini geografici
+     * @param format Formato e compressione (PNG RGBA di default)
+     * @return true se il rendering è avvenuto con successo
+     */
+    bool render(const std::string& output_path, bool include_shapefile = true,
+                const ImageFormat& format = ImageFormat());
+
+    /**
+     * @brief Eventi disegnati nell'ultimo rendering (nell'intervallo e nell'estensione)
+     */
+    const std::vector<std::shared_ptr<const OccultationData>>& renderedEvents() const {
+        return rendered_events_;
+    }
+
+private:
+    struct EventEntry {
+        std::shared_ptr<const OccultationData> data;
+        double min_lon, min_lat, max_lon, max_lat;   // Box di tutte le linee
+        double jd;                                   // Istante dell'evento (0 se sconosciuto)
+    };
+
+    unsigned int width_;
+    unsigned int height_;
+    OverviewStyle style_;
+    MapProjection projection_;
+    std::vector<EventEntry> events_;
+    std::vector<std::shared_ptr<const OccultationData>> rendered_events_;
+
+    double start_jd_ = 0.0;   // 0 = nessun limite
+    double end_jd_ = 0.0;
+    bool auto_extent_ = true;
+    double extent_[4] = {-180.0, -90.0, 180.0, 90.0};
+
+    bool inDateRange(const EventEntry& entry) const;
+};
+
+} // namespace ioc_earth
+
+#endif // IOC_EARTH_NIGHT_OVERVIEW_RENDERER_H
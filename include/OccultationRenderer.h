@@ -8,6 +8,14 @@
 
 namespace ioc_earth {
 
+struct ShadowEventInput;
+struct ProbabilityMapOptions;
+class StationRegistry;
+struct DensifiedPath;
+struct TileCoord;
+class VectorTileEncoder;
+struct ShadowAnimationOptions;
+
 /**
  * @brief Struttura per rappresentare un punto sulla linea di un'occultazione
  */
@@ -31,6 +39,7 @@ struct OccultationData {
     std::string date_time_utc;      // Data e ora UTC dell'evento
     double magnitude_drop;          // Calo di magnitudine atteso
     double duration_seconds;        // Durata prevista in secondi
+    double shadow_diameter_km = 0.0; // Larghezza dell'ombra = diametro dell'asteroide (0: ignota)
     
     // Linea centrale dell'occultazione
     std::vector<OccultationPathPoint> central_line;
@@ -94,23 +103,160 @@ public:
      */
     void setOccultationData(const OccultationData& data);
     
+    /**
+     * @brief Imposta i dati di occultazione spostandoli senza copia
+     * @param data Struttura con i dati dell'occultazione (rvalue)
+     */
+    void setOccultationData(OccultationData&& data);
+    
+    /**
+     * @brief Imposta dati di occultazione condivisi (nessuna copia)
+     * 
+     * Gli stessi dati possono essere usati da più renderer contemporaneamente.
+     * @param data Dati immutabili condivisi
+     */
+    void setOccultationData(std::shared_ptr<const OccultationData> data);
+    
+    /**
+     * @brief Restituisce i dati di occultazione correnti
+     */
+    std::shared_ptr<const OccultationData> getOccultationData() const { return data_; }
+    
+    /**
+     * @brief Attiva la mappa di probabilità Monte Carlo sotto la linea centrale
+     * 
+     * Il raster viene ricalcolato a ogni rendering sull'estensione corrente.
+     * @param event Elementi besseliani e incertezze dell'evento
+     * @param options Parametri della simulazione
+     */
+    void setProbabilityMap(const ShadowEventInput& event, const ProbabilityMapOptions& options);
+    
+    /**
+     * @brief Disattiva la mappa di probabilità
+     */
+    void clearProbabilityMap();
+    
+    /**
+     * @brief Collega un registro di stazioni
+     * 
+     * A ogni rendering vengono disegnate le stazioni del registro che cadono
+     * nella fascia tra i limiti dell'ombra (più il margine), trovate con
+     * l'indice spaziale del registro.
+     * @param registry Registro condiviso (nullptr per scollegarlo)
+     * @param margin_km Margine oltre i limiti nord e sud
+     */
+    void setStationRegistry(std::shared_ptr<const StationRegistry> registry, double margin_km = 0.0);
+    
     /**
      * @brief Renderizza la mappa dell'occultazione
-     * @param output_path Percorso del file PNG di output
+     * @param output_path Percorso del file immagine di output
      * @param include_shapefile Se true, include i confini geografici
+     * @param format Formato e compressione (PNG RGBA di default; le mappe
+     *               in bianco e nero stanno bene in ImageFormat::png8())
      * @return true se il rendering è avvenuto con successo
      */
     bool renderOccultationMap(const std::string& output_path, 
-                              bool include_shapefile = true);
+                              bool include_shapefile = true,
+                              const ImageFormat& format = ImageFormat());
+    
+    /**
+     * @brief Renderizza la mappa una volta e la salva in più dimensioni
+     * 
+     * Utile per miniatura + dettaglio: la mappa viene disegnata alla
+     * dimensione del renderer e le uscite più piccole sono ridotte e
+     * codificate in parallelo (vedi MapPathRenderer::renderToOutputs).
+     * @param outputs Dimensioni e percorsi delle uscite
+     * @param include_shapefile Se true, include i confini geografici
+     * @return true se tutte le uscite sono state prodotte
+     */
+    bool renderOccultationMaps(std::vector<MapPathRenderer::RenderOutput>& outputs,
+                               bool include_shapefile = true);
+    
+    /**
+     * @brief Renderizza la stessa scena a più fattori di scala (1x, 2x, ...)
+     * 
+     * I layer vengono costruiti una sola volta, alla densità più alta
+     * richiesta; ogni uscita cambia solo il fattore di scala del renderer.
+     * Al termine viene ripristinato il fattore precedente.
+     * @param outputs Coppie (fattore di scala, percorso del file)
+     * @param include_shapefile Se true, include i confini geografici
+     * @param format Formato e compressione delle uscite
+     * @return true se tutte le uscite sono state prodotte
+     */
+    bool renderOccultationMapAtScales(const std::vector<std::pair<double, std::string>>& outputs,
+                                      bool include_shapefile = true,
+                                      const ImageFormat& format = ImageFormat());
+    
+    /**
+     * @brief Animazione dell'ombra che attraversa la mappa
+     * 
+     * La mappa (layer compresi) viene costruita e renderizzata una sola
+     * volta; i fotogrammi aggiungono solo l'impronta dell'ombra all'istante
+     * corrispondente e vengono composti e codificati in parallelo
+     * (vedi ShadowAnimation).
+     * @param output_path File APNG, o prefisso dei fotogrammi numerati
+     * @param options Fotogrammi, durata, colore e formato
+     * @param include_shapefile Se true, include i confini geografici
+     * @return true se l'animazione è stata scritta
+     */
+    bool renderShadowAnimation(const std::string& output_path, const ShadowAnimationOptions& options,
+                               bool include_shapefile = true);
     
     /**
      * @brief Renderizza la mappa e restituisce i dati PNG come buffer
      * @param png_data Vector che conterrà i dati PNG
      * @param include_shapefile Se true, include i confini geografici
+     * @param format Formato e compressione (PNG RGBA di default)
      * @return true se il rendering è avvenuto con successo
      */
     bool renderToBuffer(std::vector<uint8_t>& png_data,
-                       bool include_shapefile = true);
+                       bool include_shapefile = true,
+                       const ImageFormat& format = ImageFormat());
+    
+    /**
+     * @brief Come renderToBuffer() ma senza copie
+     * 
+     * Il PNG viene codificato in memoria in un buffer del BufferPool,
+     * condiviso con la cache dell'ultima immagine: torna al pool quando
+     * l'ultimo riferimento viene rilasciato.
+     * @param png_data Riceve il buffer PNG (immutabile)
+     * @param include_shapefile Se true, include i confini geografici
+     * @param format Formato e compressione (PNG RGBA di default)
+     * @return true se il rendering è avvenuto con successo
+     */
+    bool renderToBuffer(std::shared_ptr<const std::vector<uint8_t>>& png_data,
+                       bool include_shapefile = true,
+                       const ImageFormat& format = ImageFormat());
+    
+    /**
+     * @brief Rendering incrementale per editor interattivi
+     * 
+     * I layer sono divisi in gruppi (griglia, confini, probabilità,
+     * percorsi, marker temporali, stazioni): a ogni chiamata dati, stile,
+     * registro e mappa di probabilità vengono confrontati con quelli
+     * dell'ultimo rendering e vengono ricostruiti e rasterizzati solo i
+     * gruppi che ne dipendono; gli altri riusano il raster in cache (vedi
+     * MapPathRenderer::renderLayerGroups). Cambiare solo il colore di
+     * sfondo costa una composizione; cambiare estensione, proiezione o
+     * scala ricostruisce tutto.
+     * @param image Immagine di destinazione, delle dimensioni del renderer
+     * @param include_shapefile Se true, include i confini geografici
+     * @return true se il rendering è avvenuto con successo
+     */
+    bool renderIncremental(mapnik::image_rgba8& image, bool include_shapefile = true);
+    
+    /**
+     * @brief Come renderIncremental(image) ma codificato in un buffer del pool
+     * 
+     * Il buffer diventa anche l'ultima immagine renderizzata. Per le
+     * anteprime conviene un livello zlib basso (es. ImageFormat::png(1)).
+     * @param data Riceve il buffer codificato (immutabile)
+     * @param include_shapefile Se true, include i confini geografici
+     * @param format Formato raster e compressione
+     */
+    bool renderIncremental(std::shared_ptr<const std::vector<uint8_t>>& data,
+                           bool include_shapefile = true,
+                           const ImageFormat& format = ImageFormat());
     
     /**
      * @brief Genera una pagina HTML con la mappa dell'occultazione embedded
@@ -123,12 +269,43 @@ public:
                      bool include_shapefile = true,
                      const std::string& page_title = "Occultation Map");
     
+    /**
+     * @brief Esporta gli overlay di una tile XYZ come Mapbox Vector Tile
+     * 
+     * Layer: sigma_limits, central_line (con i dati dell'evento),
+     * time_markers, stations e registry_stations. Le geometrie sono
+     * ritagliate e quantizzate sulla tile: il client le disegna sopra una
+     * mappa di base statica, senza rendering lato server.
+     * @param tile Tile da esportare
+     * @param mvt Tile codificata (vuota se nessun overlay cade nella tile)
+     * @return true se l'esportazione è avvenuta con successo
+     */
+    bool exportVectorTile(const TileCoord& tile, std::string& mvt) const;
+    
+    /**
+     * @brief Esporta in un archivio PMTiles le vector tile toccate dal percorso
+     * @param archive_path Percorso del file .pmtiles
+     * @param min_zoom Livello minimo
+     * @param max_zoom Livello massimo
+     * @return true se l'esportazione è avvenuta con successo
+     */
+    bool exportVectorTiles(const std::string& archive_path,
+                           unsigned int min_zoom, unsigned int max_zoom) const;
+    
     /**
      * @brief Ottiene l'ultimo buffer PNG renderizzato (base64 encoded)
      * @return Stringa base64 dell'immagine PNG, vuota se nessuna immagine disponibile
      */
     std::string getLastRenderedImageBase64() const;
     
+    /**
+     * @brief Ultimo buffer PNG renderizzato, condiviso senza copia
+     * @return nullptr se nessuna immagine è disponibile
+     */
+    std::shared_ptr<const std::vector<uint8_t>> getLastRenderedBuffer() const {
+        return last_rendered_buffer_;
+    }
+    
     /**
      * @brief Configura i colori e gli stili della visualizzazione
      */
@@ -161,16 +338,46 @@ public:
         // Etichette
         bool show_time_labels = true;
         bool show_station_labels = true;
+        bool show_station_predictions = false;          // Distanza e istante centrale nelle etichette del registro
         bool show_city_names = true;
         bool show_grid = true;
         double grid_step_degrees = 5.0;                 // Griglia ogni 5 gradi
+        double path_tolerance_pixels = 0.5;             // Densificazione geodetica di centrale e limiti (<=0: disattivata)
+        
+        // Mappa di probabilità (se impostata con setProbabilityMap)
+        bool show_probability_map = true;
+        std::string probability_color = "#FF8800";      // Arancio, alfa proporzionale alla probabilità
+        double probability_max_opacity = 0.6;
         int label_font_size = 9;
         std::string label_font = "DejaVu Sans";
     };
     
     void setRenderStyle(const RenderStyle& style);
+    
+    /**
+     * @brief Imposta la proiezione della mappa (es. ortografica per percorsi ad alte latitudini)
+     */
+    void setProjection(const MapProjection& projection);
     RenderStyle getRenderStyle() const { return style_; }
     
+    /**
+     * @brief Rendering a fasce per poster più grandi della memoria disponibile
+     * @see MapPathRenderer::setStripRendering
+     */
+    void setStripRendering(unsigned int strip_height, unsigned int overlap = 64);
+    
+    /**
+     * @brief Thread usati per il rendering della mappa
+     * @see MapPathRenderer::setRenderThreads
+     */
+    void setRenderThreads(unsigned int threads);
+    
+    /**
+     * @brief Fattore di scala per schermi ad alta densità
+     * @see MapPathRenderer::setScaleFactor
+     */
+    bool setScaleFactor(double scale_factor);
+    
     /**
      * @brief Calcola automaticamente l'estensione della mappa
      * @param margin_percent Margine percentuale (default 15%)
@@ -179,21 +386,55 @@ public:
 
 private:
     std::unique_ptr<MapPathRenderer> renderer_;
-    OccultationData data_;
+    std::shared_ptr<const OccultationData> data_;  // Immutabile, eventualmente condiviso
     RenderStyle style_;
     
+    // Mappa di probabilità opzionale
+    std::shared_ptr<const ShadowEventInput> probability_event_;
+    std::shared_ptr<const ProbabilityMapOptions> probability_options_;
+    
+    // Registro di stazioni opzionale
+    std::shared_ptr<const StationRegistry> station_registry_;
+    double station_margin_km_ = 0.0;
+    
     unsigned int width_;
     unsigned int height_;
     
     // Cache dell'ultima immagine renderizzata
-    mutable std::vector<uint8_t> last_rendered_buffer_;
+    std::shared_ptr<const std::vector<uint8_t>> last_rendered_buffer_;
+    
+    // Stato dell'ultima costruzione dei layer, per il rendering incrementale
+    struct BuiltState {
+        bool valid = false;
+        bool include_shapefile = false;
+        std::shared_ptr<const OccultationData> data;
+        RenderStyle style;
+        std::shared_ptr<const ShadowEventInput> probability_event;
+        std::shared_ptr<const StationRegistry> station_registry;
+        double station_margin_km = 0.0;
+        std::string projection;
+        double min_lon = 0.0, min_lat = 0.0, max_lon = 0.0, max_lat = 0.0;
+        unsigned int width = 0, height = 0;
+    };
+    BuiltState built_;
     
     // Metodi helper privati
+    std::shared_ptr<const DensifiedPath> densifyLine(const std::vector<OccultationPathPoint>& line) const;
+    void buildOccultationMap(bool include_shapefile);
+    unsigned int changedLayerGroups(bool include_shapefile) const;
+    void rebuildLayerGroups(unsigned int groups, bool include_shapefile);
+    void updateLayerGroups(bool include_shapefile);
+    void renderGrid();
     void renderCentralLine();
     void renderSigmaLimits();
+    void renderProbabilityMap();
     void renderTimeMarkers();
     void renderObservationStations();
+    void renderRegisteredStations();
     void addMapLegend();
+    std::vector<std::size_t> registryStationsInPath() const;
+    void addVectorTileLayers(VectorTileEncoder& encoder, unsigned int zoom,
+                             const std::vector<std::size_t>& registry_indices) const;
 };
 
 } // namespace ioc_earth
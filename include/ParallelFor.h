@@ -0,0 +1,103 @@
+#ifndef IOC_EARTH_PARALLEL_FOR_H
+#define IOC_EARTH_PARALLEL_FOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace ioc_earth {
+
+/**
+ * @brief Numero di thread da usare per count lavori
+ * @param requested Thread richiesti (0 = std::thread::hardware_concurrency())
+ * @return Tra 1 e count (1 se non ci sono lavori)
+ */
+inline unsigned int parallelThreadCount(unsigned int requested, std::size_t count) {
+    const unsigned int threads = requested != 0 ? requested
+                                                : std::max(1u, std::thread::hardware_concurrency());
+    return static_cast<unsigned int>(std::min<std::size_t>(threads, std::max<std::size_t>(1, count)));
+}
+
+namespace detail {
+
+template <typename Job>
+bool invokeParallelJob(const Job& job, std::size_t index, unsigned int worker) {
+    if constexpr (std::is_invocable<const Job&, std::size_t, unsigned int>::value) {
+        if constexpr (std::is_same<decltype(job(index, worker)), bool>::value) {
+            return job(index, worker);
+        } else {
+            job(index, worker);
+            return true;
+        }
+    } else {
+        if constexpr (std::is_same<decltype(job(index)), bool>::value) {
+            return job(index);
+        } else {
+            job(index);
+            return true;
+        }
+    }
+}
+
+} // namespace detail
+
+/**
+ * @brief Esegue job per ogni indice in [0, count) su più thread
+ *
+ * Gli indici sono distribuiti dinamicamente con un contatore atomico, così
+ * lavori di durata diversa (righe, tile, eventi) bilanciano da soli il
+ * carico. Il thread chiamante partecipa come worker 0.
+ *
+ * job può essere job(i) oppure job(i, worker), con worker in
+ * [0, parallelThreadCount(threads, count)): il chiamante può così
+ * preparare uno stato per thread (buffer, renderer). Se job restituisce
+ * bool, false ferma la distribuzione. La prima eccezione ferma la
+ * distribuzione e viene rilanciata dopo il join.
+ * @param threads Thread richiesti (0 = std::thread::hardware_concurrency())
+ * @return false se un job ha restituito false
+ */
+template <typename Job>
+bool parallelFor(std::size_t count, unsigned int threads, const Job& job) {
+    threads = parallelThreadCount(threads, count);
+    std::atomic<std::size_t> next{0};
+    std::atomic<bool> stopped{false};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto worker = [&](unsigned int worker_index) {
+        try {
+            for (std::size_t i = next++; i < count && !stopped; i = next++) {
+                if (!detail::invokeParallelJob(job, i, worker_index)) {
+                    stopped = true;
+                }
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) error = std::current_exception();
+            stopped = true;
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (unsigned int i = 1; i < threads; ++i) {
+        pool.emplace_back(worker, i);
+    }
+    worker(0);
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return !stopped;
+}
+
+} // namespace ioc_earth
+
+#endif // IOC_EARTH_PARALLEL_FOR_H
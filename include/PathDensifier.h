@@ -0,0 +1,86 @@
+#ifndef IOC_EARTH_PATH_DENSIFIER_H
+#define IOC_EARTH_PATH_DENSIFIER_H
+
+#include "LruCache.h"
+#include "OccultationRenderer.h"
+#include <cstddef>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+namespace ioc_earth {
+
+/**
+ * @brief Polilinea densificata (longitudine/latitudine in gradi)
+ */
+struct DensifiedPath {
+    std::vector<double> lon;
+    std::vector<double> lat;
+
+    std::size_t size() const { return lon.size(); }
+    CoordinateView view() const {
+        return lon.empty() ? CoordinateView() : CoordinateView(lon.data(), lat.data(), lon.size());
+    }
+};
+
+using DensifiedPathPtr = std::shared_ptr<const DensifiedPath>;
+
+/**
+ * @brief Densificazione geodetica dei percorsi dell'ombra
+ *
+ * Tra due punti consecutivi il percorso segue l'arco di cerchio massimo;
+ * disegnato come segmento in longitudine/latitudine se ne discosta tanto
+ * più quanto i punti sono radi e lontani dall'equatore. Ogni segmento viene
+ * diviso ricorsivamente nel punto medio dell'arco finché lo scarto dal
+ * segmento rettilineo resta sotto la tolleranza (in unità della mappa):
+ * i tratti quasi rettilinei non aggiungono punti.
+ *
+ * I risultati sono memorizzati per (dati, linea, tolleranza): la tolleranza
+ * viene arrotondata alla potenza di due inferiore, così estensioni di scala
+ * simile riusano la stessa geometria. I metodi sono thread-safe.
+ */
+class PathDensifier {
+public:
+    /// Numero di polilinee densificate mantenute in memoria
+    static constexpr std::size_t kCacheCapacity = 32;
+
+    /// Profondità massima di suddivisione di un segmento
+    static constexpr int kMaxDepth = 16;
+
+    /**
+     * @brief Istanza condivisa usata dai renderer (cache comune al processo)
+     */
+    static PathDensifier& shared();
+
+    /**
+     * @brief Densifica una polilinea
+     * @param path Punti originali (x = longitudine, y = latitudine)
+     * @param tolerance_deg Scarto massimo ammesso dal cerchio massimo (gradi)
+     * @param out Uscita: polilinea densificata (contiene i punti originali)
+     */
+    static void densify(const CoordinateView& path, double tolerance_deg, DensifiedPath& out);
+
+    /**
+     * @brief Densifica una linea di un evento, usando la cache
+     * @param owner Dati a cui appartiene la linea (chiave della cache)
+     * @param line Linea da densificare
+     * @param tolerance_deg Tolleranza in gradi (es. mezzo pixel)
+     */
+    DensifiedPathPtr densify(const std::shared_ptr<const void>& owner,
+                             const std::vector<OccultationPathPoint>& line,
+                             double tolerance_deg);
+
+    /**
+     * @brief Svuota la cache
+     */
+    void clearCache();
+
+private:
+    // Chiave: (dati proprietari, linea, tolleranza quantizzata)
+    using CacheKey = std::tuple<std::shared_ptr<const void>, const void*, double>;
+    LruCache<CacheKey, DensifiedPathPtr> cache_{kCacheCapacity};
+};
+
+} // namespace ioc_earth
+
+#endif // IOC_EARTH_PATH_DENSIFIER_H
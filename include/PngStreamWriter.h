@@ -0,0 +1,76 @@
+#ifndef IOC_EARTH_PNG_STREAM_WRITER_H
+#define IOC_EARTH_PNG_STREAM_WRITER_H
+
+#include <mapnik/image.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+struct png_struct_def;
+struct png_info_def;
+
+namespace ioc_earth {
+
+/**
+ * @brief Scrittura di un PNG RGBA una fascia di righe alla volta
+ *
+ * L'immagine completa non esiste mai in memoria: le righe vengono passate
+ * a libpng (già dipendenza di Mapnik) man mano che le fasce sono pronte,
+ * dall'alto verso il basso. Le immagini marcate come premoltiplicate
+ * vengono riportate ad alfa non premoltiplicato come richiede il PNG.
+ */
+class PngStreamWriter {
+public:
+    PngStreamWriter();
+    ~PngStreamWriter();
+
+    PngStreamWriter(const PngStreamWriter&) = delete;
+    PngStreamWriter& operator=(const PngStreamWriter&) = delete;
+
+    /**
+     * @brief Crea il file e scrive l'header
+     * @param compression_level Livello zlib 0-9 (-1: predefinito di libpng)
+     */
+    bool open(const std::string& path, unsigned int width, unsigned int height,
+              int compression_level = -1);
+
+    /**
+     * @brief Come open(path, ...) ma accoda il PNG a un buffer in memoria
+     * @param output Buffer di destinazione, deve restare valido fino a close()
+     */
+    bool open(std::vector<std::uint8_t>& output, unsigned int width, unsigned int height,
+              int compression_level = -1);
+
+    /**
+     * @brief Accoda righe consecutive prese da un'immagine larga quanto il PNG
+     * @param image Sorgente delle righe
+     * @param first_row Prima riga dell'immagine da scrivere
+     * @param count Numero di righe
+     */
+    bool writeRows(const mapnik::image_rgba8& image, unsigned int first_row, unsigned int count);
+
+    /**
+     * @brief Completa il file; false se mancano righe o la scrittura è fallita
+     */
+    bool close();
+
+    unsigned int rowsWritten() const { return rows_written_; }
+
+private:
+    std::FILE* file_ = nullptr;
+    std::vector<std::uint8_t>* memory_ = nullptr;
+    png_struct_def* png_ = nullptr;
+    png_info_def* info_ = nullptr;
+    unsigned int width_ = 0;
+    unsigned int height_ = 0;
+    unsigned int rows_written_ = 0;
+    std::vector<std::uint8_t> row_;
+
+    void release();
+    bool begin(unsigned int width, unsigned int height, int compression_level);
+};
+
+} // namespace ioc_earth
+
+#endif // IOC_EARTH_PNG_STREAM_WRITER_H
@@ -0,0 +1,90 @@
+#ifndef IOC_EARTH_SHADOW_ANIMATION_H
+#define IOC_EARTH_SHADOW_ANIMATION_H
+
+#include "ImageFormat.h"
+#include <mapnik/image.hpp>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ioc_earth {
+
+struct OccultationData;
+
+/**
+ * @brief Parametri dell'animazione dell'ombra
+ */
+struct ShadowAnimationOptions {
+    enum class Output {
+        APNG,      // Un solo PNG animato
+        Frames     // Fotogrammi numerati <percorso>_0000.<ext>
+    };
+
+    Output output = Output::APNG;
+    unsigned int frame_count = 120;        // Fotogrammi sulla finestra temporale
+    unsigned int frame_delay_ms = 50;      // Durata di ogni fotogramma
+    unsigned int loops = 0;                // Ripetizioni APNG (0: infinite)
+    std::string shadow_color = "#d62728";  // Colore dell'impronta dell'ombra
+    double shadow_opacity = 0.55;          // Opacità dell'impronta (0-1)
+    double shadow_diameter_km = 0.0;       // Diametro (<=0: OccultationData::shadow_diameter_km)
+    unsigned int threads = 0;              // 0: std::thread::hardware_concurrency()
+    ImageFormat frame_format;              // Formato dei fotogrammi numerati (raster)
+};
+
+/**
+ * @brief Fotogrammi dell'ombra che attraversa la mappa
+ *
+ * La mappa di base (confini, limiti, linea centrale, marker) viene
+ * renderizzata una sola volta dal chiamante; ogni fotogramma è la base con
+ * sopra l'impronta dell'ombra all'istante corrispondente, disegnata
+ * direttamente in pixel con antialiasing. Il tempo viene dai timestamp
+ * della linea centrale; senza timestamp la linea è percorsa a velocità
+ * uniforme nella durata dell'evento.
+ *
+ * Nell'APNG ogni fotogramma dopo il primo contiene solo il rettangolo
+ * cambiato (impronta precedente + impronta corrente) e sostituisce quella
+ * regione del fotogramma precedente: la codifica è proporzionale
+ * all'area dell'ombra, non alla mappa. I fotogrammi sono indipendenti
+ * e vengono composti e codificati in parallelo.
+ */
+class ShadowAnimation {
+public:
+    /// Conversione da longitudine/latitudine a pixel della mappa di base
+    using PixelTransform = std::function<bool(double lon, double lat, double& x, double& y)>;
+
+    /**
+     * @brief Impronta dell'ombra in un fotogramma
+     */
+    struct Footprint {
+        double seconds = 0.0;                              // Dall'inizio della finestra
+        std::vector<std::pair<double, double>> polygon;    // Contorno in pixel
+    };
+
+    /**
+     * @brief Calcola le impronte dei fotogrammi
+     * @param data Percorso dell'occultazione
+     * @param options Numero di fotogrammi e diametro dell'ombra
+     * @param to_pixel Trasformazione della mappa di base
+     * @param footprints Uscita: options.frame_count impronte
+     * @return false se la linea centrale ha meno di due punti o se il
+     *         diametro dell'ombra non è noto né dalle opzioni né dai dati
+     */
+    static bool computeFootprints(const OccultationData& data, const ShadowAnimationOptions& options,
+                                  const PixelTransform& to_pixel, std::vector<Footprint>& footprints);
+
+    /**
+     * @brief Scrive l'animazione (APNG o fotogrammi numerati)
+     * @param base Mappa di base renderizzata una volta
+     * @param footprints Impronte da computeFootprints()
+     * @param options Uscita, colori e thread
+     * @param output_path File .png animato, o prefisso dei fotogrammi
+     * @return true se tutti i fotogrammi sono stati scritti
+     */
+    static bool write(const mapnik::image_rgba8& base, const std::vector<Footprint>& footprints,
+                      const ShadowAnimationOptions& options, const std::string& output_path);
+};
+
+} // namespace ioc_earth
+
+#endif // IOC_EARTH_SHADOW_ANIMATION_H
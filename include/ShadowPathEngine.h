@@ -0,0 +1,140 @@
+#ifndef IOC_EARTH_SHADOW_PATH_ENGINE_H
+#define IOC_EARTH_SHADOW_PATH_ENGINE_H
+
+#include "OccultationRenderer.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ioc_earth {
+
+/**
+ * @brief Elementi besseliani di un'occultazione stellare
+ *
+ * Il piano fondamentale passa per il centro della Terra ed è perpendicolare
+ * alla direzione della stella; x e y sono le coordinate dell'asse dell'ombra
+ * in raggi equatoriali terrestri, come polinomi nel tempo t (ore da t0).
+ * Per una stella l'ombra è un cilindro: la sua sezione ha il diametro
+ * dell'asteroide.
+ */
+struct BesselianElements {
+    double t0_jd = 0.0;                  // Epoca di riferimento (giorno giuliano UTC)
+    std::vector<double> x_coeffs;        // x(t) = x0 + x1 t + x2 t² + ... (raggi terrestri)
+    std::vector<double> y_coeffs;        // y(t) = y0 + y1 t + y2 t² + ...
+    double star_dec_deg = 0.0;           // Declinazione apparente della stella (d)
+    double mu0_deg = 0.0;                // Angolo orario di Greenwich della stella a t0
+    double mu1_deg_per_hour = 15.041067; // Variazione oraria di μ
+};
+
+/**
+ * @brief Dati di ingresso per il calcolo del percorso dell'ombra
+ */
+struct ShadowEventInput {
+    std::string event_id;
+    std::string asteroid_name;
+    std::string star_name;
+    double magnitude_drop = 0.0;
+
+    BesselianElements elements;
+    double asteroid_diameter_km = 0.0;   // Diametro dell'asteroide (= larghezza dell'ombra)
+    double sigma_km = 0.0;               // Incertezza 1-sigma trasversale del percorso
+
+    double start_hours = -0.1;           // Intervallo di calcolo, ore da t0
+    double end_hours = 0.1;
+    double step_seconds = 10.0;          // Passo della griglia temporale
+    double marker_interval_seconds = 60.0; // Intervallo tra i marker temporali
+};
+
+/**
+ * @brief Calcolo del percorso dell'ombra di un'occultazione
+ *
+ * Genera linea centrale, limiti 1-sigma e marker temporali a partire dagli
+ * elementi besseliani, sostituendo i percorsi precalcolati da strumenti
+ * esterni. La valutazione avviene su tutta la griglia temporale in una volta
+ * (polinomi con Horner e proiezione sulla Terra su array SoA); più eventi
+ * vengono calcolati in parallelo.
+ *
+ * La Terra è un ellissoide WGS84. I limiti sono le linee parallele alla
+ * centrale a distanza (diametro/2 + sigma) sul piano fondamentale; i punti
+ * in cui l'ombra non tocca la Terra vengono scartati.
+ */
+class ShadowPathEngine {
+public:
+    /**
+     * @brief Linee del percorso campionate sulla griglia temporale (SoA)
+     *
+     * Per ogni istante: longitudine/latitudine della centrale e dei due
+     * limiti; on_earth_* vale 0 se il punto cade fuori dalla Terra.
+     */
+    struct PathSamples {
+        std::vector<double> hours;           // Tempo da t0 (ore)
+        std::vector<double> central_lon, central_lat;
+        std::vector<double> north_lon, north_lat;
+        std::vector<double> south_lon, south_lat;
+        std::vector<std::uint8_t> on_earth_central, on_earth_north, on_earth_south;
+        double shadow_speed_km_s = 0.0;      // Velocità dell'ombra sul piano fondamentale
+        double closest_hours = 0.0;          // Istante di minima distanza dal centro della Terra
+    };
+
+    /**
+     * @brief Campiona il percorso di un evento sulla griglia temporale
+     * @param input Dati dell'evento
+     * @param samples Uscita: campioni SoA
+     * @return false se gli elementi non sono validi
+     */
+    static bool sample(const ShadowEventInput& input, PathSamples& samples);
+
+    /**
+     * @brief Calcola i dati di occultazione per un evento
+     * @param input Dati dell'evento
+     * @param data Uscita: percorso pronto per OccultationRenderer
+     * @return false se gli elementi non sono validi o l'ombra non tocca la Terra
+     */
+    static bool compute(const ShadowEventInput& input, OccultationData& data);
+
+    /**
+     * @brief Calcola più eventi in parallelo
+     *
+     * Gli eventi vengono distribuiti dinamicamente tra i thread. Gli eventi
+     * non validi producono un puntatore nullo nella posizione corrispondente.
+     * @param inputs Eventi da calcolare
+     * @param threads Numero di thread (0 = hardware_concurrency)
+     * @return Dati condivisibili con OccultationRenderer::setOccultationData()
+     */
+    static std::vector<std::shared_ptr<const OccultationData>> computeBatch(
+        const std::vector<ShadowEventInput>& inputs, unsigned int threads = 0);
+
+    /**
+     * @brief Proietta punti del piano fondamentale sulla superficie terrestre
+     *
+     * Kernel comune a sample() e agli strumenti che campionano l'ombra
+     * (es. le mappe di probabilità).
+     * @param xi Coordinate ξ sul piano fondamentale (raggi terrestri)
+     * @param eta Coordinate η sul piano fondamentale (raggi terrestri)
+     * @param mu_deg Angolo orario di Greenwich della stella per ogni punto
+     * @param count Numero di punti
+     * @param star_dec_deg Declinazione della stella
+     * @param lon Uscita: longitudine (gradi, est positiva)
+     * @param lat Uscita: latitudine geodetica (gradi)
+     * @param on_earth Uscita: 1 se il punto cade sulla Terra
+     */
+    static void fundamentalPlaneToGeographic(const double* xi, const double* eta,
+                                             const double* mu_deg, std::size_t count,
+                                             double star_dec_deg, double* lon, double* lat,
+                                             std::uint8_t* on_earth);
+
+    /**
+     * @brief Formatta un giorno giuliano come data ISO 8601 UTC
+     *        ("YYYY-MM-DDTHH:MM:SS.sssZ")
+     */
+    static std::string isoFromJulianDate(double jd);
+
+    /// Raggio equatoriale terrestre (km, WGS84)
+    static constexpr double kEarthRadiusKm = 6378.137;
+};
+
+} // namespace ioc_earth
+
+#endif // IOC_EARTH_SHADOW_PATH_ENGINE_H
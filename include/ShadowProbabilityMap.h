@@ -0,0 +1,80 @@
+#ifndef IOC_EARTH_SHADOW_PROBABILITY_MAP_H
+#define IOC_EARTH_SHADOW_PROBABILITY_MAP_H
+
+#include "ShadowPathEngine.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ioc_earth {
+
+/**
+ * @brief Parametri della simulazione Monte Carlo
+ */
+struct ProbabilityMapOptions {
+    unsigned int clones = 5000;          // Cloni dell'orbita/posizione stellare
+    double orbit_sigma_km = -1.0;        // Sigma trasversale dell'orbita (<0: usa sigma_km dell'evento)
+    double star_sigma_km = 0.0;          // Sigma della posizione stellare proiettata sul piano fondamentale
+    unsigned int seed = 1;               // Seme del generatore (mappe riproducibili)
+    unsigned int threads = 0;            // Thread per l'accumulo (0 = hardware_concurrency)
+    unsigned int raster_scale = 2;       // 1 pixel del raster ogni raster_scale pixel della mappa
+};
+
+/**
+ * @brief Mappa di probabilità di osservare l'occultazione
+ *
+ * Ogni clone sposta l'asse dell'ombra sul piano fondamentale secondo
+ * l'incertezza combinata di orbita e stella. La copertura di un punto a
+ * terra dipende solo dalla sua distanza trasversale dall'asse nominale:
+ * i cloni vengono accumulati una sola volta in un profilo di probabilità
+ * trasversale (array differenze + somma prefissa), poi per ogni pixel si
+ * calcola la distanza trasversale (iterazione di Newton sull'istante di
+ * massimo avvicinamento, su righe SoA) e si legge il profilo. Le righe del
+ * raster sono distribuite tra i thread.
+ */
+class ShadowProbabilityMap {
+public:
+    /**
+     * @brief Raster di probabilità in coordinate geografiche
+     */
+    struct Raster {
+        unsigned int width = 0;
+        unsigned int height = 0;
+        double min_lon = 0.0, min_lat = 0.0, max_lon = 0.0, max_lat = 0.0;
+        std::vector<float> probability;  // width*height, riga superiore (max_lat) per prima
+    };
+
+    /**
+     * @brief Calcola la probabilità di occultazione per ogni pixel
+     * @param event Evento (elementi besseliani, diametro, sigma)
+     * @param options Parametri Monte Carlo
+     * @param width Larghezza del raster
+     * @param height Altezza del raster
+     * @param min_lon Estensione del raster
+     * @param min_lat Estensione del raster
+     * @param max_lon Estensione del raster
+     * @param max_lat Estensione del raster
+     * @param raster Uscita
+     * @return false se l'evento non è valido
+     */
+    static bool compute(const ShadowEventInput& event, const ProbabilityMapOptions& options,
+                        unsigned int width, unsigned int height,
+                        double min_lon, double min_lat, double max_lon, double max_lat,
+                        Raster& raster);
+
+    /**
+     * @brief Converte il raster in pixel RGBA (alfa proporzionale alla probabilità)
+     * @param raster Raster di probabilità
+     * @param color Colore in una sintassi di mapnik::color ("#RRGGBB", "#rgb",
+     *              nome, rgba(...)); la sua alfa si moltiplica per max_alpha
+     * @param max_alpha Opacità per probabilità 1 (0-1)
+     * @param rgba Uscita: width*height*4 byte, non premoltiplicati
+     * @return false se il colore non è valido
+     */
+    static bool colorize(const Raster& raster, const std::string& color, double max_alpha,
+                         std::vector<uint8_t>& rgba);
+};
+
+} // namespace ioc_earth
+
+#endif // IOC_EARTH_SHADOW_PROBABILITY_MAP_H
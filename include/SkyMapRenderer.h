@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include "ImageFormat.h"
+#include "SkyProjection.h"
 
 namespace ioc_earth {
 
@@ -18,6 +20,8 @@ struct StarData {
     std::string spectral_type;   // Tipo spettrale (A, B, F, G, K, M, etc.)
     std::string flamsteed_letter;// Lettera di Flamsteed (es. "α", "β", "γ")
     std::string constellation;   // Nome della costellazione (es. "Aries")
+    double pm_ra_mas_yr = 0.0;   // Moto proprio in RA, μα·cosδ (mas/anno)
+    double pm_dec_mas_yr = 0.0;  // Moto proprio in Dec (mas/anno)
 };
 
 /**
@@ -49,6 +53,11 @@ struct TargetData {
     std::vector<std::string> trajectory_timestamps;         // Timestamp per ogni punto
 };
 
+/// Dataset immutabili condivisibili tra più renderer senza copie
+using StarCatalogPtr = std::shared_ptr<const std::vector<StarData>>;
+using ConstellationLinesPtr = std::shared_ptr<const std::vector<ConstellationLineData>>;
+using ConstellationBoundariesPtr = std::shared_ptr<const std::vector<ConstellationBoundaryData>>;
+
 /**
  * @brief Configurazione stile per le mappe celesti
  */
@@ -81,6 +90,9 @@ struct SkyMapStyle {
     double grid_step_degrees = 10.0;                        // Spaziatura griglia (5° o 10°)
     bool grid_dashed = true;                                // Linee tratteggiate
     
+    // Proiezione del cielo sul piano (stereografica: conforme sui campi ampi)
+    SkyProjectionType projection = SkyProjectionType::Stereographic;
+    
     // Visualizzazione
     bool show_grid = true;
     bool show_star_labels = true;                           // SAO numbers
@@ -138,23 +150,54 @@ public:
      */
     void addStars(const std::vector<StarData>& stars);
     
+    /**
+     * @brief Aggiunge stelle spostando il vector senza copiarlo
+     * @param stars Vector di stelle (rvalue)
+     */
+    void addStars(std::vector<StarData>&& stars);
+    
+    /**
+     * @brief Aggiunge stelle da un catalogo condiviso (nessuna copia)
+     * 
+     * Lo stesso catalogo può essere usato da più renderer contemporaneamente.
+     * @param stars Catalogo immutabile condiviso
+     */
+    void addStars(StarCatalogPtr stars);
+    
     /**
      * @brief Aggiunge linee delle costellazioni
      * @param lines Vector di linee asterismo
      */
     void addConstellationLines(const std::vector<ConstellationLineData>& lines);
+    void addConstellationLines(std::vector<ConstellationLineData>&& lines);
+    void addConstellationLines(ConstellationLinesPtr lines);
     
     /**
      * @brief Aggiunge confini delle costellazioni
      * @param boundaries Vector di confini poligonali
      */
     void addConstellationBoundaries(const std::vector<ConstellationBoundaryData>& boundaries);
+    void addConstellationBoundaries(std::vector<ConstellationBoundaryData>&& boundaries);
+    void addConstellationBoundaries(ConstellationBoundariesPtr boundaries);
+    
+    /**
+     * @brief Imposta l'epoca di osservazione delle stelle
+     * 
+     * Se impostata, al rendering il catalogo viene portato all'epoca con
+     * StarCatalogTransform::shared() (solo moto proprio: il resto della mappa
+     * è nell'equinozio J2000, quindi le stelle non vengono precesse); il
+     * risultato resta in cache per le mappe successive della stessa epoca.
+     * @param epoch_jd Giorno giuliano dell'evento (0 = posizioni del catalogo)
+     */
+    void setObservationEpoch(double epoch_jd);
     
     /**
      * @brief Imposta il target e la sua traiettoria
      * @param target Informazioni del target
      */
     void setTarget(const TargetData& target);
+    void setTarget(TargetData&& target);
+    void setTarget(std::shared_ptr<const TargetData> target);
     
     /**
      * @brief Imposta uno stile secondario per la mappa di ricerca (finder chart)
@@ -174,10 +217,25 @@ public:
     
     /**
      * @brief Renderizza la mappa celeste in PNG
-     * @param output_path Path del file PNG di output
+     * @param output_path Path del file immagine di output
+     * @param format Formato e compressione (PNG RGBA di default)
+     * @return true se il rendering è riuscito, false altrimenti
+     */
+    bool renderSkyMap(const std::string& output_path, const ImageFormat& format = ImageFormat());
+    
+    /**
+     * @brief Rendering incrementale per anteprime interattive
+     * 
+     * Griglia, costellazioni, stelle e target sono gruppi di layer
+     * separati: stile e dati vengono confrontati con l'ultimo rendering e
+     * solo i gruppi cambiati vengono ricostruiti e rasterizzati, gli altri
+     * riusano il raster in cache (vedi MapPathRenderer::renderLayerGroups).
+     * Cambiare centro, campo o proiezione ricostruisce tutto.
+     * @param data Buffer di destinazione (il contenuto viene sostituito)
+     * @param format Formato raster e compressione
      * @return true se il rendering è riuscito, false altrimenti
      */
-    bool renderSkyMap(const std::string& output_path);
+    bool renderSkyMapIncremental(std::vector<uint8_t>& data, const ImageFormat& format = ImageFormat());
     
     /**
      * @brief Ottiene l'ultima immagine renderizzata come buffer
@@ -198,13 +256,15 @@ private:
     double field_of_view_;
     double mag_limit_;
     
-    // Dati dei componenti
-    std::vector<StarData> stars_;
-    std::vector<ConstellationLineData> constellation_lines_;
-    std::vector<ConstellationBoundaryData> constellation_boundaries_;
-    TargetData target_;
+    // Dati dei componenti (immutabili, eventualmente condivisi con altri renderer)
+    StarCatalogPtr stars_;
+    ConstellationLinesPtr constellation_lines_;
+    ConstellationBoundariesPtr constellation_boundaries_;
+    std::shared_ptr<const TargetData> target_;
     SkyMapStyle style_;
     
+    double observation_epoch_jd_ = 0.0;
+    
     // Bounding box del finder chart (se impostato)
     bool has_finder_chart_bounds_ = false;
     double finder_chart_ra_;
@@ -213,6 +273,9 @@ private:
     
     // Buffer dell'ultima immagine renderizzata
     mutable std::vector<uint8_t> last_rendered_buffer_;
+    
+    void buildSkyMap(unsigned int groups);
+    unsigned int changedLayerGroups() const;
 };
 
 } // namespace ioc_earth
@@ -0,0 +1,238 @@
+#ifndef IOC_EARTH_SKY_PROJECTION_H
+#define IOC_EARTH_SKY_PROJECTION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ioc_earth {
+
+/**
+ * @brief Regione rettangolare del cielo in RA/Dec (gradi, J2000)
+ *
+ * Se min_ra > max_ra la regione attraversa RA = 0 (es. 350°..10°).
+ */
+struct SkyBox {
+    double min_ra;
+    double max_ra;
+    double min_dec;
+    double max_dec;
+
+    constexpr bool wrapsRA() const { return min_ra > max_ra; }
+
+    /**
+     * @brief Verifica se due regioni si sovrappongono (gestisce RA = 0)
+     */
+    constexpr bool intersects(const SkyBox& other) const {
+        if (max_dec < other.min_dec || min_dec > other.max_dec) {
+            return false;
+        }
+        if (wrapsRA() && other.wrapsRA()) {
+            return true;
+        }
+        if (wrapsRA()) {
+            return other.max_ra >= min_ra || other.min_ra <= max_ra;
+        }
+        if (other.wrapsRA()) {
+            return max_ra >= other.min_ra || min_ra <= other.max_ra;
+        }
+        return !(max_ra < other.min_ra || min_ra > other.max_ra);
+    }
+
+    /**
+     * @brief Regione che contiene un cerchio di raggio dato attorno a un centro
+     *
+     * Tiene conto della convergenza dei meridiani: vicino ai poli la regione
+     * copre tutte le ascensioni rette.
+     * @param center_ra_deg Ascensione retta del centro (gradi)
+     * @param center_dec_deg Declinazione del centro (gradi)
+     * @param radius_deg Raggio (gradi)
+     */
+    static SkyBox around(double center_ra_deg, double center_dec_deg, double radius_deg);
+};
+
+/**
+ * @brief Tipo di proiezione del piano tangente
+ */
+enum class SkyProjectionType {
+    Gnomonic,       // Cerchi massimi -> rette (finder chart, campi piccoli)
+    Stereographic   // Conforme, adatta a campi ampi (mappe celesti)
+};
+
+/**
+ * @brief Polilinea proiettata sul piano tangente (SoA)
+ *
+ * visible[i] vale 0 per i punti non proiettabili: la polilinea va
+ * disegnata a tratti con SkyProjection::forEachVisibleRun().
+ */
+struct ProjectedPath {
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<std::uint8_t> visible;
+
+    std::size_t size() const { return x.size(); }
+    void resize(std::size_t n) { x.resize(n); y.resize(n); visible.resize(n); }
+    void clear() { x.clear(); y.clear(); visible.clear(); }
+};
+
+/**
+ * @brief Proiezione RA/Dec -> piano tangente centrata su un punto del cielo
+ *
+ * Le coordinate del piano sono espresse in gradi (ξ, η scalati per 180/π),
+ * con l'est a sinistra come nelle carte astronomiche e il nord in alto.
+ * La trigonometria del centro è precalcolata nel costruttore; le funzioni
+ * batch lavorano su array separati (SoA) a blocchi e segnalano i punti non
+ * proiettabili nel flag visible invece di scartarli.
+ */
+class SkyProjection {
+public:
+    /**
+     * @brief Costruttore
+     * @param center_ra_deg Ascensione retta del centro (gradi)
+     * @param center_dec_deg Declinazione del centro (gradi)
+     * @param type Tipo di proiezione
+     */
+    SkyProjection(double center_ra_deg = 0.0, double center_dec_deg = 0.0,
+                  SkyProjectionType type = SkyProjectionType::Gnomonic);
+
+    double centerRA() const { return center_ra_; }
+    double centerDec() const { return center_dec_; }
+    SkyProjectionType type() const { return type_; }
+
+    /**
+     * @brief Proietta un singolo punto
+     * @param ra_deg Ascensione retta (gradi)
+     * @param dec_deg Declinazione (gradi)
+     * @param x Coordinata x sul piano (gradi, positiva verso ovest/destra)
+     * @param y Coordinata y sul piano (gradi, positiva verso nord)
+     * @return false se il punto non è proiettabile (emisfero opposto)
+     */
+    bool project(double ra_deg, double dec_deg, double& x, double& y) const;
+
+    /**
+     * @brief Distanza sul piano corrispondente a una distanza angolare dal centro
+     * @param angular_deg Distanza angolare (gradi)
+     * @return Raggio sul piano (gradi)
+     */
+    double planeRadius(double angular_deg) const;
+
+    /**
+     * @brief Proiezione inversa dal piano a RA/Dec
+     * @return false se le coordinate non corrispondono a un punto valido
+     */
+    bool unproject(double x, double y, double& ra_deg, double& dec_deg) const;
+
+    /**
+     * @brief Proietta un array di punti RA/Dec
+     *
+     * Gli ingressi possono essere campi di strutture: stride_bytes è la
+     * distanza in byte tra due elementi consecutivi (sizeof(double) per
+     * array semplici).
+     * @param ra_deg Prima ascensione retta
+     * @param dec_deg Prima declinazione
+     * @param count Numero di punti
+     * @param stride_bytes Passo in byte degli ingressi
+     * @param x Uscita: coordinate x (count elementi)
+     * @param y Uscita: coordinate y (count elementi)
+     * @param visible Uscita: 1 se il punto è proiettabile (può essere nullptr)
+     */
+    void projectBatch(const double* ra_deg, const double* dec_deg, std::size_t count,
+                      std::size_t stride_bytes, double* x, double* y,
+                      std::uint8_t* visible) const;
+
+    /**
+     * @brief Proietta vettori unitari equatoriali (nessuna trigonometria)
+     *
+     * È il kernel interno di projectBatch; utile quando il catalogo è già
+     * in forma di vettori unitari.
+     */
+    void projectUnitVectors(const double* ux, const double* uy, const double* uz,
+                            std::size_t count, double* x, double* y,
+                            std::uint8_t* visible) const;
+
+    /**
+     * @brief Proietta una polilinea RA/Dec interpolando i lati
+     *
+     * I lati più lunghi di max_step_deg vengono suddivisi linearmente in
+     * RA/Dec (arco di RA più corto), come richiesto da confini IAU e
+     * griglie che sul piano diventano curve.
+     * @param max_step_deg Passo massimo di interpolazione (0 = nessuna)
+     * @param out Polilinea proiettata (sovrascritta)
+     */
+    void projectPolyline(const double* ra_deg, const double* dec_deg, std::size_t count,
+                         std::size_t stride_bytes, double max_step_deg,
+                         ProjectedPath& out) const;
+
+    /**
+     * @brief Proietta l'arco di cerchio massimo tra due punti
+     *
+     * Nella gnomonica l'arco è un segmento e bastano gli estremi; nelle
+     * altre proiezioni è una curva e viene campionato lungo l'arco con
+     * passo angolare al più max_step_deg.
+     * @param max_step_deg Passo massimo di campionamento (0 = solo estremi)
+     * @param out Polilinea proiettata (sovrascritta)
+     */
+    void projectGreatCircle(double ra1_deg, double dec1_deg, double ra2_deg, double dec2_deg,
+                            double max_step_deg, ProjectedPath& out) const;
+
+    /**
+     * @brief Proietta un meridiano (RA costante) tra due declinazioni
+     */
+    void projectMeridian(double ra_deg, double dec_from, double dec_to, double step_deg,
+                         ProjectedPath& out) const;
+
+    /**
+     * @brief Proietta un parallelo (Dec costante) tra due ascensioni rette
+     *
+     * ra_to può superare 360 per gli intervalli a cavallo di RA = 0.
+     */
+    void projectParallel(double dec_deg, double ra_from, double ra_to, double step_deg,
+                         ProjectedPath& out) const;
+
+    /**
+     * @brief Seleziona i punti che cadono in un rettangolo del piano
+     * @param x Coordinate x proiettate
+     * @param y Coordinate y proiettate
+     * @param visible Flag di proiettabilità (può essere nullptr)
+     * @param count Numero di punti
+     * @param half_width Semi-larghezza del rettangolo (gradi)
+     * @param half_height Semi-altezza del rettangolo (gradi)
+     * @param indices Uscita: indici dei punti interni (aggiunti in coda)
+     */
+    static void cullToRect(const double* x, const double* y, const std::uint8_t* visible,
+                           std::size_t count, double half_width, double half_height,
+                           std::vector<std::size_t>& indices);
+
+    /**
+     * @brief Chiama emit(first, count) per ogni tratto contiguo di punti visibili
+     *
+     * Serve a spezzare le polilinee che escono dall'emisfero proiettabile.
+     */
+    template <typename Emit>
+    static void forEachVisibleRun(const std::uint8_t* visible, std::size_t count, Emit&& emit) {
+        std::size_t start = 0;
+        while (start < count) {
+            while (start < count && !visible[start]) ++start;
+            std::size_t end = start;
+            while (end < count && visible[end]) ++end;
+            if (end - start >= 2) {
+                emit(start, end - start);
+            }
+            start = end;
+        }
+    }
+
+private:
+    double center_ra_;
+    double center_dec_;
+    SkyProjectionType type_;
+
+    // Base del piano tangente: direzione del centro, est, nord
+    double cx_, cy_, cz_;
+    double ex_, ey_, ez_;
+    double nx_, ny_, nz_;
+};
+
+} // namespace ioc_earth
+
+#endif // IOC_EARTH_SKY_PROJECTION_H
@@ -0,0 +1,137 @@
+#ifndef IOC_EARTH_STAR_CATALOG_TRANSFORM_H
+#define IOC_EARTH_STAR_CATALOG_TRANSFORM_H
+
+#include "SkyMapRenderer.h"
+#include "FinderChartRenderer.h"
+#include "LruCache.h"
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+namespace ioc_earth {
+
+/// Giorno giuliano di J2000.0 (2000-01-01 12:00 TT)
+constexpr double kJulianDateJ2000 = 2451545.0;
+
+/**
+ * @brief Porta le posizioni di un catalogo stellare all'epoca dell'evento
+ *
+ * Applica moto proprio, precessione (IAU 1976, angoli di Lieske) e, se
+ * richiesto, aberrazione annua alle coordinate J2000 del catalogo. Il
+ * calcolo avviene su array separati (SoA) a blocchi: prima le conversioni
+ * RA/Dec -> vettori unitari, poi moto proprio, aberrazione e matrice di
+ * precessione come sole moltiplicazioni e somme. Matrice e velocità della
+ * Terra dipendono solo dall'epoca e sono calcolate una volta per catalogo.
+ *
+ * I cataloghi trasformati vengono memorizzati per (catalogo, epoca,
+ * opzioni): generare molte carte per la stessa notte non ripete il calcolo.
+ * I metodi sono thread-safe.
+ */
+class StarCatalogTransform {
+public:
+    /**
+     * @brief Correzioni da applicare
+     */
+    struct Options {
+        bool proper_motion = true;                 // Moto proprio lineare
+        bool precession = true;                    // Equinozio J2000 -> epoca
+        bool aberration = false;                   // Aberrazione annua (posizione apparente)
+        double catalog_epoch_jd = kJulianDateJ2000;// Epoca delle posizioni del catalogo
+
+        bool operator==(const Options& other) const {
+            return proper_motion == other.proper_motion && precession == other.precession &&
+                   aberration == other.aberration && catalog_epoch_jd == other.catalog_epoch_jd;
+        }
+    };
+
+    /// Numero di cataloghi trasformati mantenuti in memoria
+    static constexpr std::size_t kCacheCapacity = 8;
+
+    StarCatalogTransform();
+    explicit StarCatalogTransform(const Options& options);
+
+    void setOptions(const Options& options);
+    Options getOptions() const;
+
+    /**
+     * @brief Istanza condivisa usata dai renderer (cache comune al processo)
+     */
+    static StarCatalogTransform& shared();
+
+    /**
+     * @brief Restituisce il catalogo con le posizioni all'epoca indicata
+     *
+     * Il risultato è condiviso e immutabile: può essere passato
+     * direttamente a SkyMapRenderer::addStars().
+     * @param catalog Catalogo con posizioni J2000
+     * @param epoch_jd Epoca di osservazione (giorno giuliano TT)
+     * @return Catalogo trasformato (dalla cache se già calcolato)
+     */
+    StarCatalogPtr apply(const StarCatalogPtr& catalog, double epoch_jd);
+    SAOCatalogPtr apply(const SAOCatalogPtr& catalog, double epoch_jd);
+
+    /**
+     * @brief Come apply(catalog, epoch_jd), con correzioni indicate dal chiamante
+     *
+     * Le opzioni dell'istanza non cambiano; la cache distingue le opzioni.
+     */
+    StarCatalogPtr apply(const StarCatalogPtr& catalog, double epoch_jd, const Options& options);
+    SAOCatalogPtr apply(const SAOCatalogPtr& catalog, double epoch_jd, const Options& options);
+
+    /**
+     * @brief Svuota la cache dei cataloghi trasformati
+     */
+    void clearCache();
+
+    /**
+     * @brief Kernel di trasformazione su array
+     *
+     * Ingressi e uscite possono essere campi di strutture (stride in byte);
+     * le uscite possono coincidere con gli ingressi.
+     * @param ra_deg Ascensioni rette J2000 (gradi)
+     * @param dec_deg Declinazioni J2000 (gradi)
+     * @param pm_ra_mas_yr Moto proprio in RA (μα·cosδ, mas/anno)
+     * @param pm_dec_mas_yr Moto proprio in Dec (mas/anno)
+     * @param count Numero di stelle
+     * @param stride_bytes Passo in byte di tutti gli array
+     * @param epoch_jd Epoca di osservazione (giorno giuliano TT)
+     * @param options Correzioni da applicare
+     * @param out_ra_deg Uscita: ascensioni rette all'epoca
+     * @param out_dec_deg Uscita: declinazioni all'epoca
+     */
+    static void transformBatch(const double* ra_deg, const double* dec_deg,
+                               const double* pm_ra_mas_yr, const double* pm_dec_mas_yr,
+                               std::size_t count, std::size_t stride_bytes,
+                               double epoch_jd, const Options& options,
+                               double* out_ra_deg, double* out_dec_deg);
+
+    /**
+     * @brief Converte una data ISO 8601 UTC in giorno giuliano
+     *
+     * Accetta "YYYY-MM-DD", "YYYY-MM-DDTHH:MM[:SS[.s]]" e il suffisso "Z".
+     * La differenza TT-UTC (~1 minuto) è trascurabile per queste correzioni.
+     * @param iso_utc Data e ora
+     * @param jd Uscita: giorno giuliano
+     * @return false se la data non è valida
+     */
+    static bool julianDateFromISO(const std::string& iso_utc, double& jd);
+
+private:
+    // Chiave: (catalogo sorgente, mantenuto vivo dalla cache; epoca; opzioni)
+    using CacheKey = std::tuple<std::shared_ptr<const void>, double, Options>;
+
+    template <typename Star>
+    std::shared_ptr<const std::vector<Star>> applyCached(
+        const std::shared_ptr<const std::vector<Star>>& catalog, double epoch_jd,
+        const Options& options);
+
+    mutable std::mutex mutex_;                // Protegge options_
+    Options options_;
+    LruCache<CacheKey, std::shared_ptr<const void>> cache_{kCacheCapacity};
+};
+
+} // namespace ioc_earth
+
+#endif // IOC_EARTH_STAR_CATALOG_TRANSFORM_H
@@ -0,0 +1,90 @@
+#ifndef IOC_EARTH_STATION_CROSS_TRACK_H
+#define IOC_EARTH_STATION_CROSS_TRACK_H
+
+#include "StationRegistry.h"
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ioc_earth {
+
+/**
+ * @brief Previsione dell'occultazione per una stazione
+ */
+struct StationPrediction {
+    double cross_track_km = 0.0;   // Distanza dalla linea centrale (positiva a sinistra del moto)
+    double chord_km = 0.0;         // Corda prevista attraverso l'ombra (0 se fuori)
+    double duration_seconds = 0.0; // Durata prevista della scomparsa
+    double mid_time_jd = 0.0;      // Istante centrale (0 se i timestamp non sono disponibili)
+    std::string mid_time_utc;      // Istante centrale ISO 8601
+    std::size_t segment = 0;       // Segmento della linea centrale più vicino
+    bool in_shadow = false;        // true se la stazione cade nell'ombra nominale
+    bool shadow_known = false;     // false se il diametro dell'ombra è ignoto (corda e durata non calcolate)
+};
+
+/**
+ * @brief Distanza trasversale, corda e istante centrale per molte stazioni
+ *
+ * La linea centrale viene convertita una volta in vettori unitari con le
+ * normali dei piani dei suoi archi di cerchio massimo. Le stazioni vengono
+ * elaborate a blocchi SoA: per ogni arco il ciclo interno sui blocchi
+ * calcola solo prodotti scalari e tiene l'arco più vicino a ogni stazione.
+ * Con molte stazioni i blocchi sono distribuiti tra i thread.
+ */
+class StationCrossTrack {
+public:
+    struct Options {
+        double shadow_diameter_km = 0.0;    // Diametro dell'ombra (<=0: OccultationData::shadow_diameter_km)
+        unsigned int threads = 0;           // Thread (0 = hardware_concurrency)
+        std::size_t parallel_threshold = 4096; // Stazioni oltre le quali si usano più thread
+    };
+
+    /**
+     * @brief Calcola le previsioni per le stazioni della vista
+     *
+     * Corda, durata e in_shadow richiedono il diametro dell'ombra (dalle
+     * opzioni o dai dati): i limiti 1-sigma non ne danno la larghezza.
+     * Senza diametro vengono calcolati solo distanza e istante centrale.
+     * @param data Percorso dell'occultazione (linea centrale con timestamp)
+     * @param stations Coordinate delle stazioni (eventualmente un sottoinsieme)
+     * @param options Parametri del calcolo
+     * @param predictions Uscita: una previsione per punto della vista
+     * @return false se la linea centrale ha meno di due punti
+     */
+    static bool compute(const OccultationData& data, const CoordinateView& stations,
+                        const Options& options, std::vector<StationPrediction>& predictions);
+
+    /**
+     * @brief Calcola le previsioni per tutte le stazioni di un registro
+     */
+    static bool compute(const OccultationData& data, const StationRegistry& registry,
+                        const Options& options, std::vector<StationPrediction>& predictions);
+
+    /**
+     * @brief Scrive le previsioni come tabella CSV (RFC 4180)
+     *
+     * I nomi con virgole, virgolette o a capo vengono racchiusi tra
+     * virgolette, con le virgolette interne raddoppiate.
+     * @param predictions Previsioni calcolate con compute()
+     * @param stations Stessa vista passata a compute() (nomi dalle etichette)
+     * @param out Flusso di uscita
+     */
+    static void writeTable(const std::vector<StationPrediction>& predictions,
+                           const CoordinateView& stations, std::ostream& out);
+
+    /**
+     * @brief Etichette "Nome +12.3 km 21:34:05" per la mappa
+     *
+     * Da usare con CoordinateView::withPositionLabels() sulla stessa vista.
+     */
+    static std::vector<std::string> makeLabels(const std::vector<StationPrediction>& predictions,
+                                               const CoordinateView& stations);
+
+    /// Raggio medio terrestre usato per le distanze (km)
+    static constexpr double kMeanEarthRadiusKm = 6371.0088;
+};
+
+} // namespace ioc_earth
+
+#endif // IOC_EARTH_STATION_CROSS_TRACK_H
@@ -0,0 +1,134 @@
+#ifndef IOC_EARTH_STATION_REGISTRY_H
+#define IOC_EARTH_STATION_REGISTRY_H
+
+#include "OccultationRenderer.h"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ioc_earth {
+
+/**
+ * @brief Stazione di osservazione registrata
+ */
+struct RegisteredStation {
+    std::string name;          // Nome della stazione
+    std::string observer;      // Osservatore di riferimento
+    double longitude = 0.0;    // Longitudine in gradi (est positiva)
+    double latitude = 0.0;     // Latitudine in gradi
+    double altitude_m = 0.0;   // Quota sul livello del mare (metri)
+};
+
+/**
+ * @brief Stazione trovata da una query sul percorso
+ */
+struct StationMatch {
+    std::size_t index = 0;          // Indice nel registro
+    double distance_km = 0.0;       // Distanza con segno dalla linea (positiva a sinistra del moto)
+    std::size_t segment = 0;        // Segmento della linea più vicino
+    double segment_fraction = 0.0;  // Posizione della proiezione sul segmento (0-1)
+};
+
+/**
+ * @brief Registro persistente delle stazioni con indice spaziale
+ *
+ * Le stazioni sono indicizzate in una griglia regolare longitudine/latitudine
+ * memorizzata in forma compatta (offset per cella + indici ordinati). Una
+ * query sul percorso visita solo le celle attraversate dalla fascia attorno
+ * ai segmenti della linea, quindi il costo dipende dalle stazioni vicine e
+ * non dalla dimensione del registro. L'indice viene ricostruito alla prima
+ * query dopo una modifica; le query sono thread-safe.
+ */
+class StationRegistry {
+public:
+    /**
+     * @param cell_size_degrees Lato delle celle della griglia (gradi)
+     */
+    explicit StationRegistry(double cell_size_degrees = 0.5);
+
+    /**
+     * @brief Aggiunge una stazione
+     * @return Indice della stazione nel registro
+     */
+    std::size_t addStation(const RegisteredStation& station);
+    void addStations(const std::vector<RegisteredStation>& stations);
+    void clear();
+
+    std::size_t size() const { return stations_.size(); }
+    const RegisteredStation& station(std::size_t index) const { return stations_[index]; }
+    const std::vector<RegisteredStation>& stations() const { return stations_; }
+
+    /**
+     * @brief Carica stazioni da CSV
+     *
+     * Formato per riga: nome,latitudine,longitudine[,quota_m[,osservatore]].
+     * Le righe vuote o che iniziano con '#' vengono ignorate. I campi
+     * seguono RFC 4180: tra virgolette possono contenere virgole, a capo e
+     * virgolette raddoppiate.
+     * @return true se il file è stato letto
+     */
+    bool loadFromCSV(const std::string& csv_path);
+
+    /**
+     * @brief Salva il registro in CSV (stesso formato di loadFromCSV)
+     *
+     * Nome e osservatore vengono messi tra virgolette quando serve, così
+     * il file si ricarica senza perdite.
+     */
+    bool saveToCSV(const std::string& csv_path) const;
+
+    /**
+     * @brief Stazioni all'interno di un rettangolo geografico
+     *
+     * Con min_lon > max_lon il rettangolo attraversa l'antimeridiano.
+     * @param indices Uscita: indici delle stazioni
+     */
+    void queryBox(double min_lon, double min_lat, double max_lon, double max_lat,
+                  std::vector<std::size_t>& indices) const;
+
+    /**
+     * @brief Stazioni entro una distanza da una linea
+     * @param line Linea (es. la centrale di un'occultazione)
+     * @param max_distance_km Distanza massima dalla linea
+     * @param matches Uscita: stazioni ordinate per indice
+     */
+    void queryNearLine(const std::vector<OccultationPathPoint>& line, double max_distance_km,
+                       std::vector<StationMatch>& matches) const;
+
+    /**
+     * @brief Stazioni all'interno della fascia tra i limiti dell'ombra
+     *
+     * La semilarghezza della fascia su ciascun lato è ricavata dalla distanza
+     * dei limiti nord e sud dalla linea centrale.
+     * @param data Percorso dell'occultazione
+     * @param margin_km Margine aggiunto oltre ciascun limite
+     * @param matches Uscita: stazioni ordinate per indice
+     */
+    void queryInPath(const OccultationData& data, double margin_km,
+                     std::vector<StationMatch>& matches) const;
+
+private:
+    std::vector<RegisteredStation> stations_;
+    double cell_size_;
+    unsigned int columns_;
+    unsigned int rows_;
+
+    // Indice a griglia: stazioni della cella c in cell_items_[cell_offsets_[c] .. cell_offsets_[c+1])
+    mutable std::mutex index_mutex_;
+    mutable bool index_valid_ = false;
+    mutable std::vector<std::uint32_t> cell_offsets_;
+    mutable std::vector<std::uint32_t> cell_items_;
+
+    void ensureIndex() const;
+    unsigned int columnOf(double lon) const;
+    unsigned int rowOf(double lat) const;
+    template <typename Visit>
+    void forEachInBox(double min_lon, double min_lat, double max_lon, double max_lat,
+                      Visit&& visit) const;
+};
+
+} // namespace ioc_earth
+
+#endif // IOC_EARTH_STATION_REGISTRY_H
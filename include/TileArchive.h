@@ -0,0 +1,118 @@
+#ifndef IOC_EARTH_TILE_ARCHIVE_H
+#define IOC_EARTH_TILE_ARCHIVE_H
+
+#include "TileRenderer.h"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ioc_earth {
+
+/**
+ * @brief Archivio di tile in un solo file, formato PMTiles v3
+ *
+ * Evita centinaia di migliaia di piccoli file: le tile vengono accodate in
+ * un file temporaneo man mano che arrivano e finalize() scrive header,
+ * directory (con directory foglia se la radice supera i 16 KiB) e dati in
+ * un unico file servibile con richieste HTTP range.
+ *
+ * Le tile identiche (es. oceano vuoto) sono salvate una sola volta: il
+ * contenuto viene riconosciuto da un hash e confrontato byte per byte.
+ * Tile consecutive nell'ordine di Hilbert con lo stesso contenuto
+ * diventano un'unica voce di directory con run_length > 1.
+ *
+ * Non è thread-safe: usarlo come TileRenderer::TileSink, che serializza
+ * le chiamate.
+ */
+class TileArchive {
+public:
+    /// Tipo del contenuto delle tile (valori del formato PMTiles)
+    enum class TileType : std::uint8_t {
+        Unknown = 0,
+        MVT = 1,
+        PNG = 2,
+        JPEG = 3,
+        WebP = 4
+    };
+
+    /// Compressione delle tile (valori del formato PMTiles)
+    enum class Compression : std::uint8_t {
+        Unknown = 0,
+        None = 1,
+        Gzip = 2
+    };
+
+    struct Stats {
+        std::uint64_t addressed_tiles = 0;   // Tile aggiunte
+        std::uint64_t tile_entries = 0;      // Voci di directory (dopo il run-length)
+        std::uint64_t tile_contents = 0;     // Contenuti distinti scritti
+        std::uint64_t bytes_deduplicated = 0;
+    };
+
+    TileArchive();
+    ~TileArchive();
+
+    /**
+     * @brief Crea l'archivio (usa output_path + ".tmp" per i dati)
+     * @return false se i file non possono essere creati
+     */
+    bool open(const std::string& output_path, TileType type = TileType::PNG,
+              Compression compression = Compression::None);
+
+    /**
+     * @brief Metadati JSON e box geografico scritti nell'header
+     */
+    void setMetadata(const std::string& name, const std::string& description = "");
+    void setBounds(double min_lon, double min_lat, double max_lon, double max_lat);
+
+    /**
+     * @brief Aggiunge una tile; una tile già presente viene sostituita
+     */
+    bool addTile(const TileCoord& tile, const std::string& data);
+
+    /**
+     * @brief Scrive l'archivio definitivo e rimuove il file temporaneo
+     */
+    bool finalize();
+
+    const Stats& stats() const { return stats_; }
+
+    /**
+     * @brief Identificativo PMTiles di una tile (curva di Hilbert per livello)
+     */
+    static std::uint64_t tileId(const TileCoord& tile);
+
+private:
+    struct Entry {
+        std::uint64_t tile_id;
+        std::uint64_t offset;
+        std::uint32_t length;
+        std::uint32_t run_length;
+    };
+
+    std::string output_path_;
+    std::string temp_path_;
+    std::fstream data_;
+    std::uint64_t data_size_ = 0;
+    TileType type_ = TileType::PNG;
+    Compression compression_ = Compression::None;
+
+    std::vector<Entry> entries_;
+    std::unordered_map<std::uint64_t, std::vector<std::size_t>> contents_;   // hash -> indice in entries_
+    Stats stats_;
+
+    std::string name_;
+    std::string description_;
+    double bounds_[4] = {-180.0, -85.05112878, 180.0, 85.05112878};
+    unsigned int min_zoom_ = 0;
+    unsigned int max_zoom_ = 0;
+
+    bool sameContent(const Entry& entry, const std::string& data);
+    static std::string serializeDirectory(const std::vector<Entry>& entries);
+};
+
+} // namespace ioc_earth
+
+#endif // IOC_EARTH_TILE_ARCHIVE_H
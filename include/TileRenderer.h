@@ -0,0 +1,137 @@
+#ifndef IOC_EARTH_TILE_RENDERER_H
+#define IOC_EARTH_TILE_RENDERER_H
+
+#include "OccultationRenderer.h"
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ioc_earth {
+
+class StationRegistry;
+
+/**
+ * @brief Coordinate di una tile XYZ (schema "slippy map", y verso sud)
+ */
+struct TileCoord {
+    unsigned int z;
+    unsigned int x;
+    unsigned int y;
+};
+
+/**
+ * @brief Piramide di tile XYZ con gli overlay di un'occultazione
+ *
+ * Produce tile PNG trasparenti in Web Mercator (limiti sigma, linea
+ * centrale, marker temporali, stazioni) da sovrapporre a una mappa web.
+ * Vengono generate solo le tile toccate dal percorso e dai punti: la
+ * copertura si calcola per ogni livello di zoom sulle linee densificate.
+ *
+ * Le tile sono raggruppate in metatile (Options::metatile × metatile): ogni
+ * metatile è un solo rendering Mapnik con un bordo attorno, poi tagliato
+ * in tile. Ogni thread costruisce i layer una volta per livello di zoom e
+ * li riusa per tutti i metatile del livello cambiando solo l'estensione.
+ * Le tile completamente trasparenti non vengono scritte.
+ */
+class TileRenderer {
+public:
+    /// Livello di zoom massimo supportato
+    static constexpr unsigned int kMaxZoom = 22;
+
+    struct Options {
+        unsigned int min_zoom = 2;
+        unsigned int max_zoom = 10;
+        unsigned int tile_size = 256;        // Lato della tile in pixel
+        unsigned int metatile = 8;           // Lato del metatile in tile
+        unsigned int buffer_pixels = 32;     // Bordo attorno al metatile (simboli a cavallo delle tile)
+        unsigned int threads = 0;            // 0: std::thread::hardware_concurrency()
+        bool skip_empty = true;              // Non scrive le tile completamente trasparenti
+        bool include_shapefile = false;      // Confini e coste anche nelle tile
+        double station_margin_km = 0.0;      // Margine per le stazioni del registro
+        ImageFormat format = ImageFormat::png8(); // Tile PNG8 con palette (JPEG perde la trasparenza)
+    };
+
+    struct Stats {
+        std::size_t metatiles = 0;           // Rendering Mapnik eseguiti
+        std::size_t tiles_rendered = 0;      // Tile candidate tagliate dai metatile
+        std::size_t tiles_written = 0;       // Tile consegnate
+        std::size_t tiles_empty = 0;         // Tile trasparenti scartate
+    };
+
+    /**
+     * @brief Destinazione delle tile codificate in Options::format
+     *
+     * Le chiamate sono serializzate (mai concorrenti) ma in ordine
+     * qualsiasi. Restituire false interrompe la generazione.
+     */
+    using TileSink = std::function<bool(const TileCoord& tile, const std::string& png)>;
+
+    explicit TileRenderer(std::shared_ptr<const OccultationData> data);
+    ~TileRenderer();
+
+    void setOptions(const Options& options);
+    Options getOptions() const { return options_; }
+
+    /**
+     * @brief Colori e spessori degli overlay (stessi di OccultationRenderer)
+     */
+    void setRenderStyle(const OccultationRenderer::RenderStyle& style) { style_ = style; }
+
+    /**
+     * @brief Aggiunge alle tile le stazioni del registro nella fascia d'ombra
+     */
+    void setStationRegistry(std::shared_ptr<const StationRegistry> registry);
+
+    /**
+     * @brief Box geografico di una tile
+     */
+    static void tileBounds(const TileCoord& tile,
+                           double& min_lon, double& min_lat, double& max_lon, double& max_lat);
+
+    /**
+     * @brief Tile di un livello toccate dagli overlay, ordinate per x e y
+     */
+    std::vector<TileCoord> coveredTiles(unsigned int zoom) const;
+
+    /**
+     * @brief Genera le tile da min_zoom a max_zoom
+     * @param sink Destinazione delle tile
+     * @param stats Statistiche opzionali
+     * @return false se i dati non sono validi, un rendering fallisce o il sink si interrompe
+     */
+    bool render(const TileSink& sink, Stats* stats = nullptr);
+
+    /**
+     * @brief Genera le tile in una directory output_dir/z/x/y.png
+     */
+    bool renderToDirectory(const std::string& output_dir, Stats* stats = nullptr);
+
+    /**
+     * @brief Genera le tile in un unico archivio PMTiles (tile identiche salvate una volta)
+     */
+    bool renderToArchive(const std::string& archive_path, Stats* stats = nullptr);
+
+private:
+    struct MetaTile {
+        unsigned int z;
+        unsigned int mx, my;                  // Indice del metatile
+        std::vector<TileCoord> tiles;         // Tile candidate contenute
+    };
+
+    std::shared_ptr<const OccultationData> data_;
+    std::shared_ptr<const StationRegistry> registry_;
+    std::vector<std::size_t> registry_indices_;   // Stazioni del registro nella fascia
+    OccultationRenderer::RenderStyle style_;
+    Options options_;
+
+    void updateRegistryMatches();
+    double toleranceDegrees(unsigned int zoom) const;
+    double padTiles() const;
+    std::unique_ptr<MapPathRenderer> createRenderer(unsigned int zoom, unsigned int side_pixels) const;
+};
+
+} // namespace ioc_earth
+
+#endif // IOC_EARTH_TILE_RENDERER_H
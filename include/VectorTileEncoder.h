@@ -0,0 +1,101 @@
+#ifndef IOC_EARTH_VECTOR_TILE_ENCODER_H
+#define IOC_EARTH_VECTOR_TILE_ENCODER_H
+
+#include "MapPathRenderer.h"
+#include "TileRenderer.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace ioc_earth {
+
+/// Valore di un attributo di feature (stringa, numero reale o intero)
+using VectorTileValue = std::variant<std::string, double, std::int64_t>;
+using VectorTileProperties = std::vector<std::pair<std::string, VectorTileValue>>;
+
+/**
+ * @brief Codifica una tile XYZ nel formato Mapbox Vector Tile 2.1
+ *
+ * Le geometrie arrivano in longitudine/latitudine e vengono proiettate in
+ * Web Mercator, ritagliate sul box della tile più un bordo e quantizzate
+ * sulla griglia intera della tile (extent). I punti ripetuti dopo la
+ * quantizzazione vengono eliminati, quindi alle basse risoluzioni le linee
+ * si riducono da sole. Chiavi e valori degli attributi sono condivisi tra
+ * le feature del layer, come prevede il formato.
+ *
+ * Il protobuf è scritto a mano: nessuna dipendenza esterna.
+ */
+class VectorTileEncoder {
+public:
+    static constexpr std::uint32_t kDefaultExtent = 4096;
+    static constexpr std::uint32_t kDefaultBuffer = 64;
+
+    /**
+     * @param tile Tile da codificare
+     * @param extent Risoluzione della griglia della tile
+     * @param buffer Bordo oltre la tile (unità di extent) in cui le geometrie vengono mantenute
+     */
+    explicit VectorTileEncoder(const TileCoord& tile,
+                               std::uint32_t extent = kDefaultExtent,
+                               std::uint32_t buffer = kDefaultBuffer);
+
+    /**
+     * @brief Inizia un nuovo layer; le feature successive vi appartengono
+     */
+    void beginLayer(const std::string& name);
+
+    /**
+     * @brief Aggiunge una linea (eventualmente spezzata dal ritaglio)
+     * @return false se nessuna parte della linea cade nella tile
+     */
+    bool addLine(const CoordinateView& line, const VectorTileProperties& properties);
+
+    /**
+     * @brief Aggiunge un punto
+     * @return false se il punto è fuori dalla tile
+     */
+    bool addPoint(double lon, double lat, const VectorTileProperties& properties);
+
+    /**
+     * @brief true se nessun layer contiene feature
+     */
+    bool empty() const;
+
+    /**
+     * @brief Serializza la tile (i layer senza feature sono omessi)
+     */
+    std::string encode() const;
+
+private:
+    struct Feature {
+        std::uint64_t id;
+        std::uint32_t type;                  // 1 punto, 2 linea
+        std::vector<std::uint32_t> tags;
+        std::vector<std::uint32_t> geometry;
+    };
+
+    struct Layer {
+        std::string name;
+        std::vector<std::string> keys;
+        std::vector<VectorTileValue> values;
+        std::map<std::string, std::uint32_t> key_index;
+        std::map<VectorTileValue, std::uint32_t> value_index;
+        std::vector<Feature> features;
+    };
+
+    TileCoord tile_;
+    std::uint32_t extent_;
+    double buffer_;
+    std::vector<Layer> layers_;
+    std::uint64_t next_id_ = 1;
+
+    void toTile(double lon, double lat, double& x, double& y) const;
+    void addTags(Layer& layer, const VectorTileProperties& properties, std::vector<std::uint32_t>& tags);
+};
+
+} // namespace ioc_earth
+
+#endif // IOC_EARTH_VECTOR_TILE_ENCODER_H
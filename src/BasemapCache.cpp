@@ -0,0 +1,201 @@
+#include "BasemapCache.h"
+#include <mapnik/datasource_cache.hpp>
+#include <mapnik/memory_datasource.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/geometry.hpp>
+#include <mapnik/query.hpp>
+#include <mapnik/util/variant.hpp>
+#include <cmath>
+#include <iostream>
+
+namespace ioc_earth {
+
+namespace {
+
+// Iterazioni di bisezione per il punto di uscita dalla zona visibile
+constexpr int kEdgeIterations = 16;
+
+/**
+ * Proietta le geometrie di una feature tagliando le parti non visibili
+ *
+ * MapProjection::forward() porta i punti non visibili sul bordo della zona
+ * proiettabile (disco dell'ortografica, margine polare della conica,
+ * ±85° di Mercatore): disegnarli traccerebbe lungo il bordo le coste
+ * dell'emisfero nascosto. Le linee vengono quindi spezzate in tratti di
+ * punti visibili, chiusi sul punto in cui attraversano il bordo; i punti
+ * non visibili sono scartati. La mappa di base usa solo un line
+ * symbolizer, quindi gli anelli dei poligoni diventano linee.
+ */
+struct GeometryProjector {
+    const MapProjection& projection;
+    mapnik::geometry::multi_point<double>& points;
+    mapnik::geometry::multi_line_string<double>& lines;
+
+    void operator()(const mapnik::geometry::geometry_empty&) const {}
+
+    void operator()(const mapnik::geometry::point<double>& p) const {
+        double x, y;
+        if (projection.forward(p.x, p.y, x, y)) {
+            points.emplace_back(x, y);
+        }
+    }
+
+    void operator()(const mapnik::geometry::line_string<double>& line) const {
+        addLine(line);
+    }
+
+    void operator()(const mapnik::geometry::polygon<double>& polygon) const {
+        for (const auto& ring : polygon) {
+            addLine(ring);
+        }
+    }
+
+    void operator()(const mapnik::geometry::geometry<double>& g) const {
+        mapnik::util::apply_visitor(*this, g);
+    }
+
+    // Multi-geometrie e collezioni sono contenitori
+    template <typename Container>
+    void operator()(const Container& items) const {
+        for (const auto& item : items) {
+            (*this)(item);
+        }
+    }
+
+    template <typename Points>
+    void addLine(const Points& line) const {
+        mapnik::geometry::line_string<double> run;
+        const mapnik::geometry::point<double>* previous = nullptr;
+        bool previous_visible = false;
+        for (const auto& p : line) {
+            double x, y;
+            const bool visible = projection.forward(p.x, p.y, x, y);
+            if (previous && visible != previous_visible) {
+                // Attraversamento del bordo: il tratto si chiude (o riparte) sul bordo
+                double edge_x, edge_y;
+                if (visible) {
+                    edgePoint(p, *previous, edge_x, edge_y);
+                    run.emplace_back(edge_x, edge_y);
+                } else {
+                    edgePoint(*previous, p, edge_x, edge_y);
+                    run.emplace_back(edge_x, edge_y);
+                    flush(run);
+                }
+            }
+            if (visible) {
+                run.emplace_back(x, y);
+            }
+            previous = &p;
+            previous_visible = visible;
+        }
+        flush(run);
+    }
+
+    /**
+     * Ultimo punto visibile del lato da inside (visibile) a outside, per
+     * bisezione in coordinate geografiche
+     */
+    void edgePoint(const mapnik::geometry::point<double>& inside,
+                   const mapnik::geometry::point<double>& outside,
+                   double& x, double& y) const {
+        const double d_lon = std::remainder(outside.x - inside.x, 360.0);
+        const double d_lat = outside.y - inside.y;
+        double t_in = 0.0, t_out = 1.0;
+        for (int i = 0; i < kEdgeIterations; ++i) {
+            const double t = 0.5 * (t_in + t_out);
+            double px, py;
+            if (projection.forward(inside.x + d_lon * t, inside.y + d_lat * t, px, py)) {
+                t_in = t;
+            } else {
+                t_out = t;
+            }
+        }
+        projection.forward(inside.x + d_lon * t_in, inside.y + d_lat * t_in, x, y);
+    }
+
+    void flush(mapnik::geometry::line_string<double>& run) const {
+        if (run.size() >= 2) {
+            lines.push_back(std::move(run));
+        }
+        run = mapnik::geometry::line_string<double>();
+    }
+};
+
+} // namespace
+
+BasemapCache& BasemapCache::shared() {
+    static BasemapCache instance;
+    return instance;
+}
+
+mapnik::datasource_ptr BasemapCache::get(const std::string& shapefile_path,
+                                         const MapProjection& projection) {
+    return cache_.getOrCompute(std::make_pair(shapefile_path, projection.proj4()), [&] {
+        return build(shapefile_path, projection);
+    });
+}
+
+void BasemapCache::clear() {
+    cache_.clear();
+}
+
+mapnik::datasource_ptr BasemapCache::build(const std::string& shapefile_path,
+                                           const MapProjection& projection) {
+    try {
+        mapnik::parameters params;
+        params["type"] = "shape";
+        params["file"] = shapefile_path;
+        mapnik::datasource_ptr source = mapnik::datasource_cache::instance().create(params);
+        if (!source) {
+            return source;
+        }
+
+        mapnik::parameters memory_params;
+        memory_params["type"] = "memory";
+        auto projected = std::make_shared<mapnik::memory_datasource>(memory_params);
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+
+        // Solo la geometria serve agli stili della mappa di base
+        mapnik::query q(source->envelope());
+        mapnik::featureset_ptr features = source->features(q);
+        std::size_t count = 0;
+        while (features) {
+            mapnik::feature_ptr feature = features->next();
+            if (!feature) break;
+
+            mapnik::geometry::multi_point<double> points;
+            mapnik::geometry::multi_line_string<double> lines;
+            const GeometryProjector projector{projection, points, lines};
+            projector(feature->get_geometry());
+            if (points.empty() && lines.empty()) {
+                continue;  // Interamente fuori dalla zona visibile
+            }
+
+            mapnik::geometry::geometry<double> geometry;
+            if (points.empty()) {
+                geometry = std::move(lines);
+            } else if (lines.empty()) {
+                geometry = std::move(points);
+            } else {
+                mapnik::geometry::geometry_collection<double> collection;
+                collection.emplace_back(std::move(points));
+                collection.emplace_back(std::move(lines));
+                geometry = std::move(collection);
+            }
+
+            mapnik::feature_ptr copy = std::make_shared<mapnik::feature_impl>(ctx, feature->id());
+            copy->set_geometry(std::move(geometry));
+            projected->push(copy);
+            ++count;
+        }
+
+        std::cout << "Mappa di base proiettata: " << shapefile_path << " (" << count
+                  << " feature, " << projection.proj4() << ")" << std::endl;
+        return projected;
+    } catch (const std::exception& e) {
+        std::cerr << "Error projecting shapefile " << shapefile_path << ": " << e.what() << std::endl;
+        return mapnik::datasource_ptr();
+    }
+}
+
+} // namespace ioc_earth
@@ -0,0 +1,102 @@
+#include "BufferPool.h"
+#include <algorithm>
+
+namespace ioc_earth {
+
+namespace {
+
+inline std::size_t imageBytes(const mapnik::image_rgba8& image) {
+    return static_cast<std::size_t>(image.width()) * image.height() * sizeof(std::uint32_t);
+}
+
+} // namespace
+
+BufferPool& BufferPool::shared() {
+    // Mai distrutto: i buffer possono tornare al pool anche durante la
+    // distruzione degli oggetti statici
+    static BufferPool* instance = new BufferPool();
+    return *instance;
+}
+
+void BufferPool::ImageReturn::operator()(mapnik::image_rgba8* image) const {
+    BufferPool::shared().release(image);
+}
+
+BufferPool::ImagePtr BufferPool::acquireImage(unsigned int width, unsigned int height) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Dal fondo: le immagini restituite per ultime sono le più "calde"
+        for (auto it = images_.rbegin(); it != images_.rend(); ++it) {
+            if ((*it)->width() == width && (*it)->height() == height) {
+                mapnik::image_rgba8* image = it->release();
+                images_.erase(std::next(it).base());
+                pooled_bytes_ -= imageBytes(*image);
+                image->set_premultiplied(false);
+                return ImagePtr(image);
+            }
+        }
+    }
+    // Nessuna immagine della stessa dimensione: allocazione senza azzeramento
+    return ImagePtr(new mapnik::image_rgba8(width, height, false));
+}
+
+BufferPool::BytesPtr BufferPool::acquireBytes(std::size_t capacity) {
+    std::unique_ptr<std::vector<std::uint8_t>> bytes;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!bytes_.empty()) {
+            // Il buffer più capiente, per evitare riallocazioni
+            auto it = std::max_element(bytes_.begin(), bytes_.end(),
+                                       [](const auto& a, const auto& b) { return a->capacity() < b->capacity(); });
+            bytes = std::move(*it);
+            bytes_.erase(it);
+            pooled_bytes_ -= bytes->capacity();
+        }
+    }
+    if (!bytes) {
+        bytes = std::make_unique<std::vector<std::uint8_t>>();
+    }
+    bytes->reserve(capacity);
+    return BytesPtr(bytes.release(), [](std::vector<std::uint8_t>* b) { BufferPool::shared().release(b); });
+}
+
+void BufferPool::release(mapnik::image_rgba8* image) {
+    std::unique_ptr<mapnik::image_rgba8> owned(image);
+    if (!owned) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::size_t size = imageBytes(*owned);
+    if (pooled_bytes_ + size <= kMaxPooledBytes) {
+        pooled_bytes_ += size;
+        images_.push_back(std::move(owned));
+    }
+}
+
+void BufferPool::release(std::vector<std::uint8_t>* bytes) {
+    std::unique_ptr<std::vector<std::uint8_t>> owned(bytes);
+    if (!owned) return;
+    owned->clear();
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::size_t size = owned->capacity();
+    if (pooled_bytes_ + size <= kMaxPooledBytes) {
+        pooled_bytes_ += size;
+        bytes_.push_back(std::move(owned));
+    }
+}
+
+void BufferPool::trim() {
+    std::vector<std::unique_ptr<mapnik::image_rgba8>> images;
+    std::vector<std::unique_ptr<std::vector<std::uint8_t>>> bytes;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        images.swap(images_);
+        bytes.swap(bytes_);
+        pooled_bytes_ = 0;
+    }
+}
+
+std::size_t BufferPool::pooledBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pooled_bytes_;
+}
+
+} // namespace ioc_earth
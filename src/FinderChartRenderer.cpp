@@ -1,12 +1,31 @@
 #include "FinderChartRenderer.h"
 #include "MapPathRenderer.h"
+#include "StarCatalogTransform.h"
 #include <iostream>
 #include <cmath>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
 
 namespace ioc_earth {
 
+namespace {
+
+// Passo di campionamento delle curve di griglia, confini e asterismi (gradi)
+constexpr double kCurveSampleDegrees = 0.25;
+
+// Disegna i tratti proiettabili di una polilinea proiettata
+void addProjectedPath(MapPathRenderer& renderer, const ProjectedPath& path,
+                      const std::string& color, double width) {
+    SkyProjection::forEachVisibleRun(path.visible.data(), path.size(),
+        [&](std::size_t first, std::size_t count) {
+            renderer.addGPSPath(CoordinateView(path.x.data() + first, path.y.data() + first, count),
+                                color, width);
+        });
+}
+
+} // namespace
+
 // Implementazione usando Mapnik
 class FinderChartRenderer::Impl {
 public:
@@ -24,7 +43,12 @@ FinderChartRenderer::FinderChartRenderer(unsigned int width, unsigned int height
     , center_ra_(0.0)
     , center_dec_(0.0)
     , field_of_view_(60.0)
-    , mag_limit_(12.0) {
+    , mag_limit_(12.0)
+    , stars_(std::make_shared<const std::vector<SAOStar>>())
+    , constellation_lines_(std::make_shared<const std::vector<ConstellationLine>>())
+    , constellation_boundaries_(std::make_shared<const std::vector<ConstellationBoundary>>())
+    , target_(std::make_shared<const TargetInfo>()) {
+    updateProjection();
 }
 
 FinderChartRenderer::~FinderChartRenderer() = default;
@@ -33,6 +57,7 @@ void FinderChartRenderer::setFieldOfView(double center_ra_deg, double center_dec
     center_ra_ = center_ra_deg;
     center_dec_ = center_dec_deg;
     field_of_view_ = field_of_view_deg;
+    updateProjection();
     std::cout << "Campo visivo impostato: RA " << center_ra_ << "° Dec " << center_dec_ << "° FOV " << field_of_view_ << "°" << std::endl;
 }
 
@@ -42,46 +67,89 @@ void FinderChartRenderer::setMagnitudeLimit(double mag_limit) {
 }
 
 void FinderChartRenderer::addSAOStars(const std::vector<SAOStar>& stars) {
-    stars_ = stars;
-    std::cout << "Aggiunte " << stars_.size() << " stelle SAO" << std::endl;
+    addSAOStars(std::make_shared<const std::vector<SAOStar>>(stars));
+}
+
+void FinderChartRenderer::addSAOStars(std::vector<SAOStar>&& stars) {
+    addSAOStars(std::make_shared<const std::vector<SAOStar>>(std::move(stars)));
+}
+
+void FinderChartRenderer::addSAOStars(SAOCatalogPtr stars) {
+    stars_ = stars ? std::move(stars) : std::make_shared<const std::vector<SAOStar>>();
+    std::cout << "Aggiunte " << stars_->size() << " stelle SAO" << std::endl;
 }
 
 void FinderChartRenderer::addConstellationLines(const std::vector<ConstellationLine>& lines) {
-    constellation_lines_ = lines;
-    std::cout << "Aggiunte " << constellation_lines_.size() << " linee di costellazioni" << std::endl;
+    addConstellationLines(std::make_shared<const std::vector<ConstellationLine>>(lines));
+}
+
+void FinderChartRenderer::addConstellationLines(std::vector<ConstellationLine>&& lines) {
+    addConstellationLines(std::make_shared<const std::vector<ConstellationLine>>(std::move(lines)));
+}
+
+void FinderChartRenderer::addConstellationLines(ConstellationLineSetPtr lines) {
+    constellation_lines_ = lines ? std::move(lines)
+                                 : std::make_shared<const std::vector<ConstellationLine>>();
+    std::cout << "Aggiunte " << constellation_lines_->size() << " linee di costellazioni" << std::endl;
 }
 
 void FinderChartRenderer::addConstellationBoundaries(const std::vector<ConstellationBoundary>& boundaries) {
-    constellation_boundaries_ = boundaries;
-    std::cout << "Aggiunti " << constellation_boundaries_.size() << " confini di costellazioni" << std::endl;
+    addConstellationBoundaries(std::make_shared<const std::vector<ConstellationBoundary>>(boundaries));
+}
+
+void FinderChartRenderer::addConstellationBoundaries(std::vector<ConstellationBoundary>&& boundaries) {
+    addConstellationBoundaries(std::make_shared<const std::vector<ConstellationBoundary>>(std::move(boundaries)));
+}
+
+void FinderChartRenderer::addConstellationBoundaries(ConstellationBoundarySetPtr boundaries) {
+    constellation_boundaries_ = boundaries ? std::move(boundaries)
+                                           : std::make_shared<const std::vector<ConstellationBoundary>>();
+    std::cout << "Aggiunti " << constellation_boundaries_->size() << " confini di costellazioni" << std::endl;
+}
+
+void FinderChartRenderer::setObservationEpoch(double epoch_jd) {
+    observation_epoch_jd_ = epoch_jd;
 }
 
 void FinderChartRenderer::setTarget(const TargetInfo& target) {
-    target_ = target;
-    std::cout << "Target impostato: " << target_.name << " (RA " << target_.ra_deg << "° Dec " << target_.dec_deg << "°)" << std::endl;
+    setTarget(std::make_shared<const TargetInfo>(target));
+}
+
+void FinderChartRenderer::setTarget(TargetInfo&& target) {
+    setTarget(std::make_shared<const TargetInfo>(std::move(target)));
+}
+
+void FinderChartRenderer::setTarget(std::shared_ptr<const TargetInfo> target) {
+    if (!target) {
+        target_ = std::make_shared<const TargetInfo>();
+        return;
+    }
+    target_ = std::move(target);
+    std::cout << "Target impostato: " << target_->name << " (RA " << target_->ra_deg << "° Dec " << target_->dec_deg << "°)" << std::endl;
 }
 
 void FinderChartRenderer::setChartStyle(const ChartStyle& style) {
     style_ = style;
+    updateProjection();
 }
 
-bool FinderChartRenderer::renderFinderChart(const std::string& output_path) {
+bool FinderChartRenderer::renderFinderChart(const std::string& output_path, const ImageFormat& format) {
     try {
         std::cout << "\n=== Rendering Finder Chart ===" << std::endl;
         
         // Imposta sfondo bianco
         pImpl_->renderer->setBackgroundColor(style_.background_color);
         
-        // Imposta l'estensione (usa RA/Dec come coordinate)
-        double half_fov = field_of_view_ / 2.0;
-        pImpl_->renderer->setExtent(
-            center_ra_ - half_fov,
-            center_dec_ - half_fov,
-            center_ra_ + half_fov,
-            center_dec_ + half_fov
-        );
+        // Imposta l'estensione in coordinate del piano tangente
+        updateProjection();
+        pImpl_->renderer->setExtent(-half_width_, -half_height_, half_width_, half_height_);
         
         // Renderizza componenti
+        if (style_.show_grid) {
+            std::cout << "Rendering griglia RA/Dec..." << std::endl;
+            renderGrid();
+        }
+        
         std::cout << "Rendering confini costellazioni..." << std::endl;
         renderConstellationBoundaries();
         
@@ -95,7 +163,7 @@ bool FinderChartRenderer::renderFinderChart(const std::string& output_path) {
         renderTarget();
         
         // Renderizza
-        bool success = pImpl_->renderer->renderToFile(output_path);
+        bool success = pImpl_->renderer->renderToFile(output_path, format);
         
         if (success) {
             std::cout << "\n✓ Finder Chart generata: " << output_path << std::endl;
@@ -112,77 +180,150 @@ bool FinderChartRenderer::renderFinderChart(const std::string& output_path) {
     }
 }
 
+void FinderChartRenderer::updateProjection() {
+    projection_ = SkyProjection(center_ra_, center_dec_, style_.projection);
+    
+    // Il campo visivo si riferisce al lato più corto dell'immagine
+    double half_plane = projection_.planeRadius(field_of_view_ / 2.0);
+    double aspect = static_cast<double>(width_) / static_cast<double>(height_);
+    half_width_ = aspect >= 1.0 ? half_plane * aspect : half_plane;
+    half_height_ = aspect >= 1.0 ? half_plane : half_plane / aspect;
+}
+
+SkyBox FinderChartRenderer::fieldRegion() const {
+    // Raggio angolare che comprende gli angoli del campo
+    double radius = field_of_view_ / 2.0 * std::hypot(half_width_, half_height_) /
+                    std::min(half_width_, half_height_);
+    return SkyBox::around(center_ra_, center_dec_, radius);
+}
+
+void FinderChartRenderer::celestialToPixel(double ra, double dec, int& x, int& y) const {
+    double px = 0.0, py = 0.0;
+    if (!projection_.project(ra, dec, px, py)) {
+        x = -1;
+        y = -1;
+        return;
+    }
+    x = static_cast<int>(std::lround((px + half_width_) / (2.0 * half_width_) * width_));
+    y = static_cast<int>(std::lround((half_height_ - py) / (2.0 * half_height_) * height_));
+}
+
+void FinderChartRenderer::renderGrid() {
+    const SkyBox region = fieldRegion();
+    const double step = style_.grid_step_degrees;
+    const double sample = std::min(step, kCurveSampleDegrees);
+    const double min_ra = region.min_ra;
+    const double max_ra = region.wrapsRA() ? region.max_ra + 360.0 : region.max_ra;
+    ProjectedPath path;
+    
+    // Meridiani (AR costante)
+    for (double ra = std::ceil(min_ra / step) * step; ra <= max_ra && ra < min_ra + 360.0; ra += step) {
+        projection_.projectMeridian(ra, region.min_dec, region.max_dec, sample, path);
+        addProjectedPath(*pImpl_->renderer, path, style_.grid_color, style_.grid_line_width);
+    }
+    
+    // Paralleli (Dec costante)
+    for (double dec = std::ceil(region.min_dec / step) * step; dec <= region.max_dec; dec += step) {
+        if (std::abs(dec) >= 90.0) continue;
+        projection_.projectParallel(dec, min_ra, max_ra, sample, path);
+        addProjectedPath(*pImpl_->renderer, path, style_.grid_color, style_.grid_line_width);
+    }
+}
+
 void FinderChartRenderer::renderConstellationBoundaries() {
-    for (const auto& boundary : constellation_boundaries_) {
+    ProjectedPath path;
+    for (const auto& boundary : *constellation_boundaries_) {
         if (boundary.points.size() < 2) continue;
         
-        std::vector<GPSPoint> path;
-        for (const auto& point : boundary.points) {
-            path.emplace_back(point.first, point.second, "");
-        }
-        
-        pImpl_->renderer->addGPSPath(path, style_.constellation_boundary_color, 
-                                     style_.constellation_boundary_width);
+        projection_.projectPolyline(&boundary.points[0].first, &boundary.points[0].second,
+                                    boundary.points.size(), sizeof(boundary.points[0]),
+                                    kCurveSampleDegrees, path);
+        addProjectedPath(*pImpl_->renderer, path, style_.constellation_boundary_color,
+                         style_.constellation_boundary_width);
     }
 }
 
 void FinderChartRenderer::renderConstellationLines() {
-    for (const auto& line : constellation_lines_) {
-        std::vector<GPSPoint> path;
-        path.emplace_back(line.ra1_deg, line.dec1_deg, "");
-        path.emplace_back(line.ra2_deg, line.dec2_deg, "");
-        
-        pImpl_->renderer->addGPSPath(path, style_.constellation_line_color,
-                                     style_.constellation_line_width);
+    ProjectedPath path;
+    for (const auto& line : *constellation_lines_) {
+        projection_.projectGreatCircle(line.ra1_deg, line.dec1_deg, line.ra2_deg, line.dec2_deg,
+                                        kCurveSampleDegrees, path);
+        addProjectedPath(*pImpl_->renderer, path, style_.constellation_line_color,
+                         style_.constellation_line_width);
     }
 }
 
 void FinderChartRenderer::renderStars() {
-    std::vector<GPSPoint> star_points;
+    // Posizioni all'epoca dell'evento (calcolate una volta per epoca). Solo
+    // moto proprio: centro, target e costellazioni restano nell'equinozio J2000
+    StarCatalogTransform::Options epoch_options;
+    epoch_options.precession = false;
+    const SAOCatalogPtr stars = observation_epoch_jd_ > 0.0
+        ? StarCatalogTransform::shared().apply(stars_, observation_epoch_jd_, epoch_options)
+        : stars_;
+    if (stars->empty()) return;
+    
+    // Proiezione in blocco dell'intero catalogo, poi selezione sul piano
+    std::vector<double> star_x(stars->size());
+    std::vector<double> star_y(stars->size());
+    std::vector<std::uint8_t> projected(stars->size());
+    projection_.projectBatch(&stars->front().ra_deg, &stars->front().dec_deg, stars->size(),
+                             sizeof(SAOStar), star_x.data(), star_y.data(), projected.data());
+    
+    std::vector<std::size_t> in_field;
+    SkyProjection::cullToRect(star_x.data(), star_y.data(), projected.data(), stars->size(),
+                              half_width_, half_height_, in_field);
     
-    for (const auto& star : stars_) {
+    std::vector<std::size_t> visible_stars;
+    std::vector<std::string> star_labels;
+    for (std::size_t i : in_field) {
+        const auto& star = (*stars)[i];
         if (star.magnitude > mag_limit_) continue;
         
-        // Controlla se la stella è nel campo visivo
-        double half_fov = field_of_view_ / 2.0;
-        if (std::abs(star.ra_deg - center_ra_) > half_fov) continue;
-        if (std::abs(star.dec_deg - center_dec_) > half_fov) continue;
-        
-        std::string label;
+        visible_stars.push_back(i);
         if (style_.show_star_labels) {
-            label = "SAO " + std::to_string(star.sao_number);
+            star_labels.push_back("SAO " + std::to_string(star.sao_number));
         }
-        
-        star_points.emplace_back(star.ra_deg, star.dec_deg, label);
     }
     
-    if (!star_points.empty()) {
-        pImpl_->renderer->addPointLabels(star_points, "star", style_.label_font_size);
+    if (!visible_stars.empty()) {
+        CoordinateView star_view(star_x.data(), star_y.data(), star_x.size());
+        star_view.withIndices(visible_stars.data(), visible_stars.size());
+        if (!star_labels.empty()) {
+            star_view.withPositionLabels(star_labels.data());
+        }
+        LabelOptions options;
+        options.priorities.reserve(visible_stars.size());
+        for (std::size_t i : visible_stars) {
+            options.priorities.push_back(-(*stars)[i].magnitude);
+        }
+        pImpl_->renderer->addPointLabels(star_view, "star", style_.label_font_size, options);
     }
 }
 
 void FinderChartRenderer::renderTarget() {
-    if (target_.name.empty()) return;
+    if (target_->name.empty()) return;
     
     // Renderizza il target
-    std::vector<GPSPoint> target_point;
-    target_point.emplace_back(target_.ra_deg, target_.dec_deg, target_.name);
-    pImpl_->renderer->addPointLabels(target_point, "target", style_.label_font_size + 2);
+    double target_x = 0.0, target_y = 0.0;
+    if (projection_.project(target_->ra_deg, target_->dec_deg, target_x, target_y)) {
+        CoordinateView target_point(&target_x, &target_y, 1);
+        target_point.withLabels(&target_->name);
+        LabelOptions options;
+        options.color = style_.target_color;
+        options.priority = 1000.0;
+        pImpl_->renderer->addPointLabels(target_point, "target", style_.label_font_size + 2, options);
+    }
     
     // Renderizza la traiettoria se presente
-    if (!target_.trajectory.empty()) {
-        std::vector<GPSPoint> trajectory;
-        for (size_t i = 0; i < target_.trajectory.size(); ++i) {
-            std::string label = i < target_.trajectory_times.size() ? 
-                              target_.trajectory_times[i] : "";
-            trajectory.emplace_back(target_.trajectory[i].first,
-                                  target_.trajectory[i].second,
-                                  label);
-        }
-        pImpl_->renderer->addGPSPath(trajectory, style_.trajectory_color, 2.0);
+    if (!target_->trajectory.empty()) {
+        const auto& trajectory = target_->trajectory;
+        ProjectedPath path;
+        projection_.projectPolyline(&trajectory[0].first, &trajectory[0].second,
+                                    trajectory.size(), sizeof(trajectory[0]), 0.0, path);
+        addProjectedPath(*pImpl_->renderer, path, style_.trajectory_color, 2.0);
     }
 }
-void FinderChartRenderer::renderGrid() { }
 void FinderChartRenderer::renderLabels() { }
 
 bool FinderChartRenderer::exportToHTML(const std::string& output_html_path, const std::string& page_title) {
@@ -0,0 +1,173 @@
+#include "GlyphCache.h"
+#include <mapnik/font_engine_freetype.hpp>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace ioc_earth {
+
+namespace {
+
+// Decodifica il prossimo carattere UTF-8 (sequenze non valide: U+FFFD)
+char32_t nextCodePoint(const std::string& text, std::size_t& i) {
+    const unsigned char lead = static_cast<unsigned char>(text[i++]);
+    if (lead < 0x80) return lead;
+    int extra = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : -1;
+    if (extra < 0) return 0xFFFD;
+    char32_t code = lead & (0x3F >> extra);
+    for (; extra > 0; --extra) {
+        if (i >= text.size() || (static_cast<unsigned char>(text[i]) & 0xC0) != 0x80) return 0xFFFD;
+        code = (code << 6) | (static_cast<unsigned char>(text[i++]) & 0x3F);
+    }
+    return code;
+}
+
+// File del carattere registrato in Mapnik: nome esatto, poi stile regolare
+bool findFontFile(const std::string& face_name, std::string& file, int& index) {
+    const auto& mapping = mapnik::freetype_engine::get_mapping();
+    for (const char* suffix : {"", " Book", " Regular", " Roman"}) {
+        auto it = mapping.find(face_name + suffix);
+        if (it != mapping.end()) {
+            index = it->second.first;
+            file = it->second.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Creazione e chiusura delle facce modificano la FT_Library condivisa e
+// vanno serializzate; un Font può essere distrutto da qualunque thread
+std::mutex& faceMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+} // namespace
+
+GlyphCache::Font::~Font() {
+    if (face_) {
+        std::lock_guard<std::mutex> lock(faceMutex());
+        FT_Done_Face(face_);
+    }
+}
+
+GlyphCache& GlyphCache::shared() {
+    // Mai distrutto: i Font ancora in uso restano validi anche durante la
+    // distruzione degli oggetti statici
+    static GlyphCache* instance = new GlyphCache();
+    return *instance;
+}
+
+std::shared_ptr<const GlyphCache::Font> GlyphCache::font(const std::string& face_name,
+                                                         unsigned int pixel_size,
+                                                         unsigned int halo_radius) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const FontKey key(face_name, std::make_pair(pixel_size, halo_radius));
+    std::shared_ptr<Font> font;
+    if (fonts_.find(key, font)) {
+        return font;
+    }
+
+    // I caratteri non disponibili vengono ricordati per nome: un solo avviso
+    if (missing_faces_.count(face_name) != 0) {
+        return nullptr;
+    }
+    std::string file;
+    int index = 0;
+    if (!findFontFile(face_name, file, index)) {
+        std::cerr << "Warning: carattere non registrato: " << face_name << std::endl;
+        missing_faces_.insert(face_name);
+        return nullptr;
+    }
+
+    FT_Face face = nullptr;
+    {
+        std::lock_guard<std::mutex> face_lock(faceMutex());
+        if (!library_ && FT_Init_FreeType(&library_) != 0) {
+            library_ = nullptr;
+            std::cerr << "Error: inizializzazione di FreeType fallita" << std::endl;
+            return nullptr;
+        }
+        if (FT_New_Face(library_, file.c_str(), index, &face) != 0 ||
+            FT_Set_Pixel_Sizes(face, 0, std::max(1u, pixel_size)) != 0) {
+            if (face) FT_Done_Face(face);
+            std::cerr << "Warning: impossibile caricare " << file << std::endl;
+            missing_faces_.insert(face_name);
+            return nullptr;
+        }
+    }
+
+    font = std::make_shared<Font>();
+    font->face_ = face;
+    font->ascender_ = face->size->metrics.ascender / 64.0;
+    font->line_height_ = face->size->metrics.height / 64.0;
+    font->halo_radius_ = halo_radius;
+    return fonts_.insert(key, std::move(font));
+}
+
+void GlyphCache::glyphs(const Font& font, const std::string& text, std::vector<const Glyph*>& glyphs) {
+    glyphs.clear();
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (std::size_t i = 0; i < text.size();) {
+        const char32_t code = nextCodePoint(text, i);
+        if (code == U'\n') {
+            glyphs.push_back(nullptr);
+            continue;
+        }
+        auto it = font.glyphs_.find(code);
+        const Glyph* glyph = it != font.glyphs_.end() ? it->second.get() : rasterize(font, code);
+        if (glyph) {
+            glyphs.push_back(glyph);
+        }
+    }
+}
+
+const GlyphCache::Glyph* GlyphCache::rasterize(const Font& font, char32_t code) {
+    std::unique_ptr<Glyph>& entry = font.glyphs_[code];
+    if (FT_Load_Char(font.face_, code, FT_LOAD_RENDER) != 0) {
+        return nullptr;
+    }
+    const FT_GlyphSlot slot = font.face_->glyph;
+    const FT_Bitmap& bitmap = slot->bitmap;
+
+    entry = std::make_unique<Glyph>();
+    Glyph& glyph = *entry;
+    glyph.left = slot->bitmap_left;
+    glyph.top = slot->bitmap_top;
+    glyph.width = static_cast<int>(bitmap.width);
+    glyph.height = static_cast<int>(bitmap.rows);
+    glyph.advance = slot->advance.x / 64.0;
+    glyph.coverage.resize(static_cast<std::size_t>(glyph.width) * glyph.height);
+    for (int y = 0; y < glyph.height; ++y) {
+        std::memcpy(glyph.coverage.data() + static_cast<std::size_t>(y) * glyph.width,
+                    bitmap.buffer + static_cast<std::ptrdiff_t>(y) * bitmap.pitch, glyph.width);
+    }
+
+    // Alone: copertura dilatata su un disco di raggio r
+    const int r = static_cast<int>(font.halo_radius_);
+    if (r > 0) {
+        const int halo_width = glyph.width + 2 * r;
+        const int halo_height = glyph.height + 2 * r;
+        glyph.halo.assign(static_cast<std::size_t>(halo_width) * halo_height, 0);
+        for (int y = 0; y < glyph.height; ++y) {
+            for (int x = 0; x < glyph.width; ++x) {
+                const std::uint8_t value = glyph.coverage[static_cast<std::size_t>(y) * glyph.width + x];
+                if (value == 0) continue;
+                for (int dy = -r; dy <= r; ++dy) {
+                    for (int dx = -r; dx <= r; ++dx) {
+                        if (dx * dx + dy * dy > r * r + r) continue;
+                        std::uint8_t& target =
+                            glyph.halo[static_cast<std::size_t>(y + r + dy) * halo_width + (x + r + dx)];
+                        target = std::max(target, value);
+                    }
+                }
+            }
+        }
+    }
+    return entry.get();
+}
+
+} // namespace ioc_earth
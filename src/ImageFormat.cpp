@@ -0,0 +1,121 @@
+#include "ImageFormat.h"
+#include <algorithm>
+#include <cctype>
+
+namespace ioc_earth {
+
+ImageFormat ImageFormat::png(int compression_level) {
+    ImageFormat format;
+    format.compression_level = compression_level;
+    return format;
+}
+
+ImageFormat ImageFormat::png8(unsigned int colors, int compression_level) {
+    ImageFormat format;
+    format.type = Type::PNG8;
+    format.colors = colors;
+    format.compression_level = compression_level;
+    return format;
+}
+
+ImageFormat ImageFormat::jpeg(int quality) {
+    ImageFormat format;
+    format.type = Type::JPEG;
+    format.quality = quality;
+    return format;
+}
+
+ImageFormat ImageFormat::webp(int quality) {
+    ImageFormat format;
+    format.type = Type::WebP;
+    format.quality = quality;
+    return format;
+}
+
+ImageFormat ImageFormat::svg() {
+    ImageFormat format;
+    format.type = Type::SVG;
+    return format;
+}
+
+ImageFormat ImageFormat::pdf() {
+    ImageFormat format;
+    format.type = Type::PDF;
+    return format;
+}
+
+bool ImageFormat::fromName(const std::string& name, ImageFormat& format) {
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (lower == "png" || lower == "png32") {
+        format = png();
+    } else if (lower == "png8") {
+        format = png8();
+    } else if (lower == "jpeg" || lower == "jpg") {
+        format = jpeg();
+    } else if (lower == "webp") {
+        format = webp();
+    } else if (lower == "svg") {
+        format = svg();
+    } else if (lower == "pdf") {
+        format = pdf();
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool ImageFormat::isPlainPNG() const {
+    return type == Type::PNG && strategy == Strategy::Default && alpha;
+}
+
+std::string ImageFormat::mapnikFormat() const {
+    const int clamped_quality = std::max(0, std::min(100, quality));
+    switch (type) {
+    case Type::JPEG:
+        return "jpeg" + std::to_string(clamped_quality);
+    case Type::WebP:
+        return "webp:quality=" + std::to_string(clamped_quality);
+    case Type::SVG:
+        return "svg";
+    case Type::PDF:
+        return "pdf";
+    case Type::PNG:
+    case Type::PNG8:
+        break;
+    }
+
+    std::string result;
+    if (type == Type::PNG8) {
+        // m=h: quantizzazione hextree, migliore dell'octree per pochi colori
+        result = "png8:m=h:c=" + std::to_string(std::max(2u, std::min(256u, colors)));
+    } else {
+        result = "png32";
+    }
+    if (compression_level >= 0) {
+        result += ":z=" + std::to_string(std::min(9, compression_level));
+    }
+    switch (strategy) {
+    case Strategy::Filtered:    result += ":s=filtered"; break;
+    case Strategy::HuffmanOnly: result += ":s=huff"; break;
+    case Strategy::RLE:         result += ":s=rle"; break;
+    case Strategy::Default:     break;
+    }
+    if (!alpha) {
+        result += ":t=0";
+    }
+    return result;
+}
+
+std::string ImageFormat::extension() const {
+    switch (type) {
+    case Type::JPEG: return "jpg";
+    case Type::WebP: return "webp";
+    case Type::SVG:  return "svg";
+    case Type::PDF:  return "pdf";
+    default:         return "png";
+    }
+}
+
+} // namespace ioc_earth
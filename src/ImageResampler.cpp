@@ -0,0 +1,127 @@
+#include "ImageResampler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace ioc_earth {
+
+namespace {
+
+/**
+ * @brief Contributo di un pixel sorgente a un pixel di destinazione
+ */
+struct Contribution {
+    unsigned int index;
+    float weight;
+};
+
+/**
+ * @brief Pesi del filtro box lungo un asse
+ *
+ * Il pixel di destinazione d copre [d·scale, (d+1)·scale) in coordinate
+ * sorgente; i pesi sono le frazioni di copertura normalizzate.
+ * @param first Uscita: primo contributo di ogni pixel (size target+1)
+ */
+void boxWeights(unsigned int source, unsigned int target,
+                std::vector<Contribution>& weights, std::vector<std::size_t>& first) {
+    const double scale = static_cast<double>(source) / target;
+    weights.clear();
+    first.assign(target + 1, 0);
+    for (unsigned int d = 0; d < target; ++d) {
+        first[d] = weights.size();
+        const double lo = d * scale;
+        const double hi = std::min(static_cast<double>(source), (d + 1) * scale);
+        for (unsigned int s = static_cast<unsigned int>(lo); s < source && s < hi; ++s) {
+            const double coverage = std::min(hi, s + 1.0) - std::max(lo, static_cast<double>(s));
+            if (coverage > 1e-9) {
+                weights.push_back({s, static_cast<float>(coverage / scale)});
+            }
+        }
+    }
+    first[target] = weights.size();
+}
+
+inline std::uint8_t toChannel(float value) {
+    return static_cast<std::uint8_t>(std::min(255.0f, std::max(0.0f, value + 0.5f)));
+}
+
+} // namespace
+
+bool ImageResampler::downsample(const mapnik::image_rgba8& source, mapnik::image_rgba8& target) {
+    const unsigned int src_w = source.width(), src_h = source.height();
+    const unsigned int dst_w = target.width(), dst_h = target.height();
+    if (dst_w == 0 || dst_h == 0 || dst_w > src_w || dst_h > src_h) {
+        std::cerr << "Error: riduzione da " << src_w << "x" << src_h
+                  << " a " << dst_w << "x" << dst_h << " non valida" << std::endl;
+        return false;
+    }
+    target.set_premultiplied(source.get_premultiplied());
+    if (dst_w == src_w && dst_h == src_h) {
+        for (unsigned int y = 0; y < src_h; ++y) {
+            std::memcpy(target.get_row(y), source.get_row(y), src_w * sizeof(std::uint32_t));
+        }
+        return true;
+    }
+
+    std::vector<Contribution> x_weights, y_weights;
+    std::vector<std::size_t> x_first, y_first;
+    boxWeights(src_w, dst_w, x_weights, x_first);
+    boxWeights(src_h, dst_h, y_weights, y_first);
+
+    // Riga intermedia: canali RGBA sorgente mediati in verticale, premoltiplicati
+    const bool premultiplied = source.get_premultiplied();
+    const std::size_t channels = static_cast<std::size_t>(src_w) * 4;
+    std::vector<float> column_sum(channels);
+
+    for (unsigned int y = 0; y < dst_h; ++y) {
+        std::fill(column_sum.begin(), column_sum.end(), 0.0f);
+        for (std::size_t k = y_first[y]; k < y_first[y + 1]; ++k) {
+            const std::uint8_t* row = reinterpret_cast<const std::uint8_t*>(source.get_row(y_weights[k].index));
+            const float weight = y_weights[k].weight;
+            float* sum = column_sum.data();
+            if (premultiplied) {
+                for (std::size_t i = 0; i < channels; ++i) {
+                    sum[i] += weight * row[i];
+                }
+            } else {
+                for (std::size_t i = 0; i < channels; i += 4) {
+                    const float color_weight = weight * row[i + 3] * (1.0f / 255.0f);
+                    sum[i + 0] += color_weight * row[i + 0];
+                    sum[i + 1] += color_weight * row[i + 1];
+                    sum[i + 2] += color_weight * row[i + 2];
+                    sum[i + 3] += weight * row[i + 3];
+                }
+            }
+        }
+
+        std::uint8_t* out = reinterpret_cast<std::uint8_t*>(target.get_row(y));
+        for (unsigned int x = 0; x < dst_w; ++x) {
+            float r = 0.0f, g = 0.0f, b = 0.0f, a = 0.0f;
+            for (std::size_t k = x_first[x]; k < x_first[x + 1]; ++k) {
+                const float* pixel = &column_sum[static_cast<std::size_t>(x_weights[k].index) * 4];
+                const float weight = x_weights[k].weight;
+                r += weight * pixel[0];
+                g += weight * pixel[1];
+                b += weight * pixel[2];
+                a += weight * pixel[3];
+            }
+            if (!premultiplied) {
+                // Ritorno ai colori diretti; i pixel trasparenti restano neri
+                const float unpremultiply = a > 0.0f ? 255.0f / a : 0.0f;
+                r *= unpremultiply;
+                g *= unpremultiply;
+                b *= unpremultiply;
+            }
+            out[4 * x + 0] = toChannel(r);
+            out[4 * x + 1] = toChannel(g);
+            out[4 * x + 2] = toChannel(b);
+            out[4 * x + 3] = toChannel(a);
+        }
+    }
+    return true;
+}
+
+} // namespace ioc_earth
@@ -0,0 +1,248 @@
+#include "LabelEngine.h"
+#include <mapnik/color.hpp>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace ioc_earth {
+
+namespace {
+
+// Diagonali: scostamento lungo ciascun asse per stare alla stessa distanza dal punto
+constexpr double kDiagonal = 0.7071;
+
+void toBytes(const mapnik::color& color, std::uint8_t bytes[4]) {
+    bytes[0] = static_cast<std::uint8_t>(color.red());
+    bytes[1] = static_cast<std::uint8_t>(color.green());
+    bytes[2] = static_cast<std::uint8_t>(color.blue());
+    bytes[3] = static_cast<std::uint8_t>(color.alpha());
+}
+
+// Fonde un colore con una maschera di copertura, tagliata ai bordi dell'immagine
+void blendMask(mapnik::image_rgba8& image, const std::uint8_t* mask, int mask_width, int mask_height,
+               int left, int top, const std::uint8_t color[4]) {
+    const bool premultiplied = image.get_premultiplied();
+    const int x0 = std::max(0, -left);
+    const int y0 = std::max(0, -top);
+    const int x1 = std::min(mask_width, static_cast<int>(image.width()) - left);
+    const int y1 = std::min(mask_height, static_cast<int>(image.height()) - top);
+    for (int y = y0; y < y1; ++y) {
+        std::uint8_t* row = reinterpret_cast<std::uint8_t*>(image.get_row(top + y));
+        const std::uint8_t* coverage = mask + static_cast<std::size_t>(y) * mask_width;
+        for (int x = x0; x < x1; ++x) {
+            const unsigned int alpha = (color[3] * coverage[x] + 127) / 255;
+            if (alpha == 0) continue;
+            std::uint8_t* pixel = row + 4 * (left + x);
+            const unsigned int inverse = 255 - alpha;
+            if (premultiplied) {
+                for (int c = 0; c < 3; ++c) {
+                    pixel[c] = static_cast<std::uint8_t>((color[c] * alpha + pixel[c] * inverse + 127) / 255);
+                }
+                pixel[3] = static_cast<std::uint8_t>(alpha + (pixel[3] * inverse + 127) / 255);
+            } else {
+                // Alfa non premoltiplicato: media pesata sulle due opacità
+                const unsigned int below = pixel[3] * inverse;
+                const unsigned int total = alpha * 255 + below;
+                for (int c = 0; c < 3; ++c) {
+                    pixel[c] = static_cast<std::uint8_t>(
+                        (color[c] * alpha * 255 + pixel[c] * below + total / 2) / total);
+                }
+                pixel[3] = static_cast<std::uint8_t>((total + 127) / 255);
+            }
+        }
+    }
+}
+
+} // namespace
+
+LabelCollisionIndex::LabelCollisionIndex(double width, double height, double cell_size)
+    : cell_size_(cell_size),
+      columns_(std::max(1, static_cast<int>(std::ceil(width / cell_size)))),
+      rows_(std::max(1, static_cast<int>(std::ceil(height / cell_size)))),
+      cells_(static_cast<std::size_t>(columns_) * rows_) {
+}
+
+bool LabelCollisionIndex::cellRange(const Box& box, int& x0, int& y0, int& x1, int& y1) const {
+    x0 = std::max(0, static_cast<int>(std::floor(box.min_x / cell_size_)));
+    y0 = std::max(0, static_cast<int>(std::floor(box.min_y / cell_size_)));
+    x1 = std::min(columns_ - 1, static_cast<int>(std::floor(box.max_x / cell_size_)));
+    y1 = std::min(rows_ - 1, static_cast<int>(std::floor(box.max_y / cell_size_)));
+    return x0 <= x1 && y0 <= y1;
+}
+
+bool LabelCollisionIndex::intersects(const Box& box) const {
+    int x0, y0, x1, y1;
+    if (!cellRange(box, x0, y0, x1, y1)) {
+        return false;
+    }
+    for (int cy = y0; cy <= y1; ++cy) {
+        for (int cx = x0; cx <= x1; ++cx) {
+            for (std::uint32_t i : cells_[static_cast<std::size_t>(cy) * columns_ + cx]) {
+                const Box& other = boxes_[i];
+                if (box.min_x < other.max_x && other.min_x < box.max_x &&
+                    box.min_y < other.max_y && other.min_y < box.max_y) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+void LabelCollisionIndex::insert(const Box& box) {
+    int x0, y0, x1, y1;
+    if (!cellRange(box, x0, y0, x1, y1)) {
+        return;
+    }
+    const std::uint32_t index = static_cast<std::uint32_t>(boxes_.size());
+    boxes_.push_back(box);
+    for (int cy = y0; cy <= y1; ++cy) {
+        for (int cx = x0; cx <= x1; ++cx) {
+            cells_[static_cast<std::size_t>(cy) * columns_ + cx].push_back(index);
+        }
+    }
+}
+
+LabelEngine::LabelEngine(unsigned int width, unsigned int height)
+    : width_(width), height_(height), index_(width, height) {
+}
+
+int LabelEngine::addStyle(const LabelOptions& options, unsigned int pixel_size, double scale_factor) {
+    const unsigned int halo = static_cast<unsigned int>(std::lround(options.halo_radius * scale_factor));
+    Style style;
+    style.font = GlyphCache::shared().font(options.font, pixel_size, halo);
+    if (!style.font) {
+        return -1;
+    }
+    toBytes(mapnik::color(options.color), style.color);
+    toBytes(mapnik::color(options.halo_color), style.halo_color);
+    styles_.push_back(std::move(style));
+    return static_cast<int>(styles_.size()) - 1;
+}
+
+void LabelEngine::addObstacle(double x, double y, double radius) {
+    index_.insert({x - radius, y - radius, x + radius, y + radius});
+}
+
+void LabelEngine::addLabel(double x, double y, double priority, const std::string& text, int style,
+                           double marker_radius) {
+    if (style < 0 || text.empty()) {
+        return;
+    }
+    candidates_.push_back({x, y, priority, &text, style, marker_radius});
+}
+
+void LabelEngine::place(std::vector<PlacedLabel>& placed) {
+    placed.clear();
+    
+    // Priorità decrescente; a parità resta l'ordine di inserimento
+    std::vector<std::size_t> order(candidates_.size());
+    std::iota(order.begin(), order.end(), std::size_t(0));
+    std::stable_sort(order.begin(), order.end(), [this](std::size_t a, std::size_t b) {
+        return candidates_[a].priority > candidates_[b].priority;
+    });
+    
+    std::vector<const GlyphCache::Glyph*> glyphs;
+    std::vector<PlacedGlyph> layout;
+    for (std::size_t index : order) {
+        const Candidate& candidate = candidates_[index];
+        const Style& style = styles_[candidate.style];
+        const GlyphCache::Font& font = *style.font;
+        GlyphCache::shared().glyphs(font, *candidate.text, glyphs);
+        
+        // Righe allineate a sinistra, coordinate relative all'angolo del testo
+        layout.clear();
+        double pen = 0.0;
+        double baseline = font.ascender();
+        double text_width = 0.0;
+        for (const GlyphCache::Glyph* glyph : glyphs) {
+            if (!glyph) {
+                pen = 0.0;
+                baseline += font.lineHeight();
+                continue;
+            }
+            layout.push_back({glyph, static_cast<int>(std::lround(pen)) + glyph->left,
+                              static_cast<int>(std::lround(baseline)) - glyph->top});
+            pen += glyph->advance;
+            text_width = std::max(text_width, pen);
+        }
+        if (layout.empty()) continue;
+        
+        const double pad = font.haloRadius();
+        const double width = std::ceil(text_width) + 2 * pad;
+        const double height = std::ceil(baseline - font.ascender() + font.lineHeight()) + 2 * pad;
+        const double gap = candidate.marker_radius + 1.0;
+        const double diagonal = gap * kDiagonal;
+        const double x = candidate.x;
+        const double y = candidate.y;
+        const double corners[8][2] = {
+            {x + gap, y - height / 2},                        // Destra
+            {x - gap - width, y - height / 2},                // Sinistra
+            {x - width / 2, y - gap - height},                // Sopra
+            {x - width / 2, y + gap},                         // Sotto
+            {x + diagonal, y - diagonal - height},            // Sopra a destra
+            {x - diagonal - width, y - diagonal - height},    // Sopra a sinistra
+            {x + diagonal, y + diagonal},                     // Sotto a destra
+            {x - diagonal - width, y + diagonal}              // Sotto a sinistra
+        };
+        
+        for (const auto& corner : corners) {
+            const double left = std::round(corner[0]);
+            const double top = std::round(corner[1]);
+            const LabelCollisionIndex::Box box{left, top, left + width, top + height};
+            if (box.min_x < 0 || box.min_y < 0 || box.max_x > width_ || box.max_y > height_ ||
+                index_.intersects(box)) {
+                continue;
+            }
+            index_.insert(box);
+            
+            PlacedLabel label;
+            label.box = box;
+            label.font = style.font;
+            label.halo_radius = static_cast<int>(font.haloRadius());
+            std::copy(style.color, style.color + 4, label.color);
+            std::copy(style.halo_color, style.halo_color + 4, label.halo_color);
+            label.glyphs = layout;
+            const int origin_x = static_cast<int>(left + pad);
+            const int origin_y = static_cast<int>(top + pad);
+            for (PlacedGlyph& glyph : label.glyphs) {
+                glyph.x += origin_x;
+                glyph.y += origin_y;
+            }
+            placed.push_back(std::move(label));
+            break;
+        }
+    }
+}
+
+void LabelEngine::draw(const std::vector<PlacedLabel>& labels, mapnik::image_rgba8& image,
+                       unsigned int offset_x, unsigned int offset_y) {
+    const double region_right = static_cast<double>(offset_x) + image.width();
+    const double region_bottom = static_cast<double>(offset_y) + image.height();
+    const int ox = static_cast<int>(offset_x);
+    const int oy = static_cast<int>(offset_y);
+    for (const PlacedLabel& label : labels) {
+        if (label.box.max_x <= offset_x || label.box.min_x >= region_right ||
+            label.box.max_y <= offset_y || label.box.min_y >= region_bottom) {
+            continue;
+        }
+        // Prima l'alone di tutta l'etichetta, poi il testo sopra
+        const int r = label.halo_radius;
+        if (r > 0 && label.halo_color[3] > 0) {
+            for (const PlacedGlyph& placed : label.glyphs) {
+                const GlyphCache::Glyph& glyph = *placed.glyph;
+                if (glyph.halo.empty()) continue;
+                blendMask(image, glyph.halo.data(), glyph.width + 2 * r, glyph.height + 2 * r,
+                          placed.x - r - ox, placed.y - r - oy, label.halo_color);
+            }
+        }
+        for (const PlacedGlyph& placed : label.glyphs) {
+            const GlyphCache::Glyph& glyph = *placed.glyph;
+            if (glyph.coverage.empty()) continue;
+            blendMask(image, glyph.coverage.data(), glyph.width, glyph.height,
+                      placed.x - ox, placed.y - oy, label.color);
+        }
+    }
+}
+
+} // namespace ioc_earth
@@ -1,4 +1,9 @@
 #include "MapPathRenderer.h"
+#include "BasemapCache.h"
+#include "BufferPool.h"
+#include "ImageResampler.h"
+#include "ParallelFor.h"
+#include "PngStreamWriter.h"
 #include <mapnik/layer.hpp>
 #include <mapnik/rule.hpp>
 #include <mapnik/feature_type_style.hpp>
@@ -14,16 +19,115 @@
 #include <mapnik/feature.hpp>
 #include <mapnik/geometry.hpp>
 #include <mapnik/value.hpp>
+#include <mapnik/raster.hpp>
+#if defined(HAVE_CAIRO)
+#include <mapnik/cairo/cairo_context.hpp>
+#include <mapnik/cairo/cairo_renderer.hpp>
+#include <cairo.h>
+#if defined(CAIRO_HAS_PDF_SURFACE)
+#include <cairo-pdf.h>
+#endif
+#if defined(CAIRO_HAS_SVG_SURFACE)
+#include <cairo-svg.h>
+#endif
+#include <unordered_map>
+#endif
+#include <cstring>
 #include <sstream>
 #include <algorithm>
 #include <limits>
 #include <cmath>
 #include <iostream>
+#include <atomic>
 
 namespace ioc_earth {
 
+namespace {
+
+// Rendering parallelo: lato delle tile e bordo renderizzato attorno a ciascuna
+constexpr unsigned int kParallelTileSize = 512;
+constexpr unsigned int kParallelTileOverlap = 32;
+
+// Composizione "sopra" in alfa premoltiplicato: target premoltiplicato,
+// layer premoltiplicato o meno secondo il suo flag
+void compositeOver(mapnik::image_rgba8& target, const mapnik::image_rgba8& layer) {
+    const bool premultiplied = layer.get_premultiplied();
+    const unsigned int width = target.width();
+    for (unsigned int y = 0; y < target.height(); ++y) {
+        std::uint8_t* dst = reinterpret_cast<std::uint8_t*>(target.get_row(y));
+        const std::uint8_t* src = reinterpret_cast<const std::uint8_t*>(layer.get_row(y));
+        for (unsigned int x = 0; x < width; ++x, dst += 4, src += 4) {
+            const unsigned int alpha = src[3];
+            if (alpha == 0) continue;
+            const unsigned int inverse = 255 - alpha;
+            for (unsigned int c = 0; c < 3; ++c) {
+                const unsigned int color = premultiplied ? src[c] : (src[c] * alpha + 127) / 255;
+                dst[c] = static_cast<std::uint8_t>(color + (dst[c] * inverse + 127) / 255);
+            }
+            dst[3] = static_cast<std::uint8_t>(alpha + (dst[3] * inverse + 127) / 255);
+        }
+    }
+}
+
+#if defined(HAVE_CAIRO)
+// Maschera di copertura di un glifo come superficie A8 (righe allineate allo stride di Cairo)
+mapnik::cairo_surface_ptr maskSurface(const std::vector<std::uint8_t>& mask, int width, int height) {
+    mapnik::cairo_surface_ptr surface(cairo_image_surface_create(CAIRO_FORMAT_A8, width, height),
+                                      mapnik::cairo_surface_closer());
+    cairo_surface_flush(surface.get());
+    unsigned char* data = cairo_image_surface_get_data(surface.get());
+    const int stride = cairo_image_surface_get_stride(surface.get());
+    for (int y = 0; y < height; ++y) {
+        std::memcpy(data + static_cast<std::size_t>(y) * stride,
+                    mask.data() + static_cast<std::size_t>(y) * width, width);
+    }
+    cairo_surface_mark_dirty(surface.get());
+    return surface;
+}
+
+// Etichette del LabelEngine sulla pagina Cairo, con le stesse maschere e
+// posizioni del raster; una superficie per glifo, riusata da tutte le
+// etichette che lo contengono
+void drawCairoLabels(const std::vector<LabelEngine::PlacedLabel>& labels, cairo_t* context) {
+    std::unordered_map<const std::uint8_t*, mapnik::cairo_surface_ptr> surfaces;
+    auto fill = [&](const std::vector<std::uint8_t>& mask, int width, int height, int x, int y,
+                    const std::uint8_t color[4]) {
+        mapnik::cairo_surface_ptr& surface = surfaces[mask.data()];
+        if (!surface) {
+            surface = maskSurface(mask, width, height);
+        }
+        cairo_set_source_rgba(context, color[0] / 255.0, color[1] / 255.0, color[2] / 255.0,
+                              color[3] / 255.0);
+        cairo_mask_surface(context, surface.get(), x, y);
+    };
+    
+    cairo_save(context);
+    cairo_identity_matrix(context);
+    for (const LabelEngine::PlacedLabel& label : labels) {
+        // Prima l'alone di tutta l'etichetta, poi il testo sopra
+        const int r = label.halo_radius;
+        if (r > 0 && label.halo_color[3] > 0) {
+            for (const LabelEngine::PlacedGlyph& placed : label.glyphs) {
+                const GlyphCache::Glyph& glyph = *placed.glyph;
+                if (glyph.halo.empty()) continue;
+                fill(glyph.halo, glyph.width + 2 * r, glyph.height + 2 * r, placed.x - r, placed.y - r,
+                     label.halo_color);
+            }
+        }
+        for (const LabelEngine::PlacedGlyph& placed : label.glyphs) {
+            const GlyphCache::Glyph& glyph = *placed.glyph;
+            if (glyph.coverage.empty()) continue;
+            fill(glyph.coverage, glyph.width, glyph.height, placed.x, placed.y, label.color);
+        }
+    }
+    cairo_restore(context);
+}
+#endif
+
+} // namespace
+
 MapPathRenderer::MapPathRenderer(unsigned int width, unsigned int height)
-    : width_(width), height_(height) {
+    : base_width_(width), base_height_(height), width_(width), height_(height) {
     initializeMap();
 }
 
@@ -50,24 +154,66 @@ void MapPathRenderer::initializeMap() {
     
     // Imposta il sistema di proiezione (WGS84)
     map_->set_srs("+proj=longlat +datum=WGS84 +no_defs");
+    
+    // Gruppo predefinito per i layer aggiunti senza beginLayerGroup()
+    layer_groups_.emplace_back();
+}
+
+void MapPathRenderer::setProjection(const MapProjection& projection) {
+    projection_ = projection;
+    map_->set_srs(projection_.proj4());
 }
 
 void MapPathRenderer::setExtent(double min_lon, double min_lat, double max_lon, double max_lat) {
-    mapnik::box2d<double> bbox(min_lon, min_lat, max_lon, max_lat);
+    double min_x, min_y, max_x, max_y;
+    projection_.projectBox(min_lon, min_lat, max_lon, max_lat, min_x, min_y, max_x, max_y);
+    mapnik::box2d<double> bbox(min_x, min_y, max_x, max_y);
     map_->zoom_to_box(bbox);
 }
 
+void MapPathRenderer::setProjectedExtent(double min_x, double min_y, double max_x, double max_y) {
+    map_->zoom_to_box(mapnik::box2d<double>(min_x, min_y, max_x, max_y));
+}
+
+void MapPathRenderer::getExtent(double& min_lon, double& min_lat,
+                                double& max_lon, double& max_lat) const {
+    const mapnik::box2d<double>& extent = map_->get_current_extent();
+    projection_.geographicBox(extent.minx(), extent.miny(), extent.maxx(), extent.maxy(),
+                              min_lon, min_lat, max_lon, max_lat);
+}
+
+bool MapPathRenderer::geoToPixel(double lon, double lat, double& x, double& y) const {
+    double px, py;
+    if (!projection_.forward(lon, lat, px, py)) {
+        return false;
+    }
+    // Stessa trasformazione del view_transform di Mapnik
+    const mapnik::box2d<double>& extent = map_->get_current_extent();
+    x = (px - extent.minx()) / (extent.maxx() - extent.minx()) * width_;
+    y = (extent.maxy() - py) / (extent.maxy() - extent.miny()) * height_;
+    return true;
+}
+
 void MapPathRenderer::addShapefileLayer(const std::string& shapefile_path, const std::string& layer_name) {
     try {
-        // Configura i parametri del datasource
-        mapnik::parameters params;
-        params["type"] = "shape";
-        params["file"] = shapefile_path;
-        
-        // Crea il layer
         mapnik::layer lyr(layer_name);
-        lyr.set_datasource(mapnik::datasource_cache::instance().create(params));
-        lyr.set_srs("+proj=longlat +datum=WGS84 +no_defs");
+        if (projection_.isLongLat()) {
+            // Configura i parametri del datasource
+            mapnik::parameters params;
+            params["type"] = "shape";
+            params["file"] = shapefile_path;
+            lyr.set_datasource(mapnik::datasource_cache::instance().create(params));
+            lyr.set_srs("+proj=longlat +datum=WGS84 +no_defs");
+        } else {
+            // Geometrie già nel sistema della mappa: Mapnik non riproietta
+            mapnik::datasource_ptr ds = BasemapCache::shared().get(shapefile_path, projection_);
+            if (!ds) {
+                std::cerr << "Error adding shapefile layer: cannot load " << shapefile_path << std::endl;
+                return;
+            }
+            lyr.set_datasource(ds);
+            lyr.set_srs(projection_.proj4());
+        }
         
         // Crea uno stile semplice per il layer
         mapnik::feature_type_style style;
@@ -82,9 +228,7 @@ void MapPathRenderer::addShapefileLayer(const std::string& shapefile_path, const
         style.add_rule(std::move(r));
         
         // Aggiungi lo stile e il layer alla mappa
-        map_->insert_style(layer_name + "_style", style);
-        lyr.add_style(layer_name + "_style");
-        map_->add_layer(lyr);
+        addGroupedLayer(lyr, layer_name, style);
     } catch (const std::exception& e) {
         std::cerr << "Error adding shapefile layer: " << e.what() << std::endl;
     }
@@ -93,6 +237,13 @@ void MapPathRenderer::addShapefileLayer(const std::string& shapefile_path, const
 void MapPathRenderer::addGPSPath(const std::vector<GPSPoint>& points,
                                  const std::string& line_color,
                                  double line_width) {
+    addGPSPath(CoordinateView::fromMembers(points, &GPSPoint::longitude, &GPSPoint::latitude),
+               line_color, line_width);
+}
+
+void MapPathRenderer::addGPSPath(const CoordinateView& points,
+                                 const std::string& line_color,
+                                 double line_width) {
     if (points.empty()) {
         return;
     }
@@ -105,8 +256,9 @@ void MapPathRenderer::addGPSPath(const std::vector<GPSPoint>& points,
         
         // Crea una geometria linestring usando l'API corretta di Mapnik 4
         mapnik::geometry::line_string<double> line;
-        for (const auto& point : points) {
-            line.emplace_back(point.longitude, point.latitude);
+        line.reserve(points.size());
+        for (std::size_t i = 0; i < points.size(); ++i) {
+            line.emplace_back(points.x(i), points.y(i));
         }
         
         // Crea una feature e aggiungi la geometria
@@ -133,17 +285,119 @@ void MapPathRenderer::addGPSPath(const std::vector<GPSPoint>& points,
         style.add_rule(std::move(r));
         
         // Aggiungi alla mappa
-        map_->insert_style("gps_path_style", style);
-        lyr.add_style("gps_path_style");
-        map_->add_layer(lyr);
+        addGroupedLayer(lyr, "gps_path", style);
     } catch (const std::exception& e) {
         std::cerr << "Error adding GPS path: " << e.what() << std::endl;
     }
 }
 
+void MapPathRenderer::addPathBatch(const std::vector<CoordinateView>& paths,
+                                   const std::vector<std::string>& names,
+                                   const std::string& layer_name,
+                                   const std::string& line_color,
+                                   double line_width) {
+    try {
+        mapnik::parameters params;
+        params["type"] = "memory";
+        auto ds = std::make_shared<mapnik::memory_datasource>(params);
+        
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        ctx->push("name");
+        
+        // Una feature per tracciato, tutte nello stesso datasource
+        int feature_id = 1;
+        for (std::size_t p = 0; p < paths.size(); ++p) {
+            const CoordinateView& path = paths[p];
+            if (path.size() < 2) continue;
+            
+            mapnik::geometry::line_string<double> line;
+            line.reserve(path.size());
+            for (std::size_t i = 0; i < path.size(); ++i) {
+                line.emplace_back(path.x(i), path.y(i));
+            }
+            
+            mapnik::feature_ptr feature = std::make_shared<mapnik::feature_impl>(ctx, feature_id++);
+            feature->set_geometry(mapnik::geometry::geometry<double>(std::move(line)));
+            if (p < names.size()) {
+                feature->put("name", mapnik::value_unicode_string(names[p].c_str()));
+            }
+            ds->push(feature);
+        }
+        if (feature_id == 1) return;
+        
+        mapnik::layer lyr(layer_name);
+        lyr.set_datasource(ds);
+        lyr.set_srs("+proj=longlat +datum=WGS84 +no_defs");
+        
+        mapnik::feature_type_style style;
+        mapnik::rule r;
+        mapnik::line_symbolizer line_sym;
+        mapnik::put(line_sym, mapnik::keys::stroke, mapnik::color(line_color));
+        mapnik::put(line_sym, mapnik::keys::stroke_width, line_width);
+        r.append(std::move(line_sym));
+        style.add_rule(std::move(r));
+        
+        addGroupedLayer(lyr, layer_name, style);
+    } catch (const std::exception& e) {
+        std::cerr << "Error adding path batch: " << e.what() << std::endl;
+    }
+}
+
+void MapPathRenderer::addRasterOverlay(const std::vector<uint8_t>& rgba,
+                                       unsigned int width, unsigned int height,
+                                       double min_lon, double min_lat,
+                                       double max_lon, double max_lat,
+                                       double opacity) {
+    if (width == 0 || height == 0 || rgba.size() < static_cast<std::size_t>(width) * height * 4) {
+        std::cerr << "Error adding raster overlay: invalid buffer" << std::endl;
+        return;
+    }
+    
+    try {
+        mapnik::image_rgba8 image(width, height, true, false);
+        std::memcpy(image.bytes(), rgba.data(), static_cast<std::size_t>(width) * height * 4);
+        
+        // Il memory datasource diventa di tipo raster con una feature raster
+        mapnik::parameters params;
+        params["type"] = "memory";
+        auto ds = std::make_shared<mapnik::memory_datasource>(params);
+        
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        mapnik::feature_ptr feature = std::make_shared<mapnik::feature_impl>(ctx, 1);
+        mapnik::box2d<double> bbox(min_lon, min_lat, max_lon, max_lat);
+        feature->set_raster(std::make_shared<mapnik::raster>(bbox, std::move(image), 1.0));
+        ds->push(feature);
+        
+        mapnik::layer lyr("raster_overlay");
+        lyr.set_datasource(ds);
+        lyr.set_srs("+proj=longlat +datum=WGS84 +no_defs");
+        
+        mapnik::feature_type_style style;
+        mapnik::rule r;
+        mapnik::raster_symbolizer raster_sym;
+        mapnik::put(raster_sym, mapnik::keys::opacity, opacity);
+        r.append(std::move(raster_sym));
+        style.add_rule(std::move(r));
+        
+        addGroupedLayer(lyr, "raster_overlay", style);
+    } catch (const std::exception& e) {
+        std::cerr << "Error adding raster overlay: " << e.what() << std::endl;
+    }
+}
+
 void MapPathRenderer::addPointLabels(const std::vector<GPSPoint>& points,
                                      const std::string& label_field,
-                                     int font_size) {
+                                     int font_size,
+                                     const LabelOptions& options) {
+    addPointLabels(CoordinateView::fromMembers(points, &GPSPoint::longitude,
+                                               &GPSPoint::latitude, &GPSPoint::timestamp),
+                   label_field, font_size, options);
+}
+
+void MapPathRenderer::addPointLabels(const CoordinateView& points,
+                                     const std::string& label_field,
+                                     int font_size,
+                                     const LabelOptions& options) {
     if (points.empty()) {
         return;
     }
@@ -160,16 +414,17 @@ void MapPathRenderer::addPointLabels(const std::vector<GPSPoint>& points,
         
         // Aggiungi i punti
         int feature_id = 1;
-        for (const auto& point : points) {
+        for (std::size_t i = 0; i < points.size(); ++i) {
             mapnik::feature_ptr feature = std::make_shared<mapnik::feature_impl>(ctx, feature_id++);
             
             // Crea la geometria del punto
-            mapnik::geometry::point<double> pt(point.longitude, point.latitude);
+            mapnik::geometry::point<double> pt(points.x(i), points.y(i));
             feature->set_geometry(mapnik::geometry::geometry<double>(pt));
             
             // Imposta l'etichetta usando UnicodeString
-            if (!point.timestamp.empty()) {
-                feature->put("label", mapnik::value_unicode_string(point.timestamp.c_str()));
+            const std::string* label = points.label(i);
+            if (label != nullptr && !label->empty()) {
+                feature->put("label", mapnik::value_unicode_string(label->c_str()));
             }
             
             ds->push(feature);
@@ -191,36 +446,110 @@ void MapPathRenderer::addPointLabels(const std::vector<GPSPoint>& points,
         mapnik::put(marker_sym, mapnik::keys::height, mapnik::value_double(8.0));
         r.append(std::move(marker_sym));
         
-        // Nota: Text symbolizer in Mapnik 4 ha un'API complessa
-        // Per ora usiamo solo i markers. Il text symbolizer richiede
-        // una configurazione più avanzata che dipende dalla versione specifica
-        
         style.add_rule(std::move(r));
         
         // Aggiungi alla mappa
-        map_->insert_style("gps_points_style", style);
-        lyr.add_style("gps_points_style");
-        map_->add_layer(lyr);
+        addGroupedLayer(lyr, "gps_points", style);
+        
+        // I testi non passano dal text symbolizer: li posiziona il
+        // LabelEngine insieme a quelli degli altri insiemi di punti
+        LabelSet labels;
+        labels.group = current_group_;
+        labels.lon.reserve(points.size());
+        labels.lat.reserve(points.size());
+        labels.texts.reserve(points.size());
+        for (std::size_t i = 0; i < points.size(); ++i) {
+            const std::string* label = points.label(i);
+            labels.lon.push_back(points.x(i));
+            labels.lat.push_back(points.y(i));
+            labels.texts.push_back(label != nullptr ? *label : std::string());
+        }
+        labels.font_size = font_size;
+        labels.options = options;
+        label_sets_.push_back(std::move(labels));
+        placed_valid_ = false;
     } catch (const std::exception& e) {
         std::cerr << "Error adding point labels: " << e.what() << std::endl;
     }
 }
 
+void MapPathRenderer::addGroupedLayer(mapnik::layer& layer, const std::string& style_prefix,
+                                      const mapnik::feature_type_style& style) {
+    // Uno stile per layer con nome univoco: insert_style non sostituisce
+    // uno stile esistente e un gruppo può essere rimosso senza toccare gli altri
+    const std::string style_name = style_prefix + "_style_" + std::to_string(next_style_id_++);
+    map_->insert_style(style_name, style);
+    layer.add_style(style_name);
+    
+    // In fondo al gruppo corrente, sotto i layer dei gruppi successivi
+    const auto position = std::upper_bound(layer_group_of_.begin(), layer_group_of_.end(), current_group_);
+    const std::size_t index = static_cast<std::size_t>(position - layer_group_of_.begin());
+    map_->insert_layer(layer, index);
+    layer_group_of_.insert(position, current_group_);
+    layer_style_of_.insert(layer_style_of_.begin() + index, style_name);
+    layer_groups_[current_group_].dirty = true;
+}
+
+void MapPathRenderer::beginLayerGroup(const std::string& group) {
+    for (std::size_t g = 0; g < layer_groups_.size(); ++g) {
+        if (layer_groups_[g].name == group) {
+            current_group_ = g;
+            return;
+        }
+    }
+    layer_groups_.emplace_back();
+    layer_groups_.back().name = group;
+    current_group_ = layer_groups_.size() - 1;
+}
+
+void MapPathRenderer::clearLayerGroup(const std::string& group) {
+    for (std::size_t g = 0; g < layer_groups_.size(); ++g) {
+        if (layer_groups_[g].name != group) continue;
+        for (std::size_t i = layer_group_of_.size(); i-- > 0;) {
+            if (layer_group_of_[i] != g) continue;
+            map_->remove_layer(i);
+            map_->remove_style(layer_style_of_[i]);
+            layer_group_of_.erase(layer_group_of_.begin() + i);
+            layer_style_of_.erase(layer_style_of_.begin() + i);
+        }
+        label_sets_.erase(std::remove_if(label_sets_.begin(), label_sets_.end(),
+                                         [g](const LabelSet& labels) { return labels.group == g; }),
+                          label_sets_.end());
+        placed_valid_ = false;
+        layer_groups_[g].dirty = true;
+        return;
+    }
+}
+
 void MapPathRenderer::setBackgroundColor(const std::string& color) {
     map_->set_background(mapnik::color(color));
 }
 
-bool MapPathRenderer::renderToFile(const std::string& output_path) {
+void MapPathRenderer::setStripRendering(unsigned int strip_height, unsigned int overlap) {
+    strip_height_ = strip_height;
+    strip_overlap_ = overlap;
+}
+
+bool MapPathRenderer::renderToFile(const std::string& output_path, const ImageFormat& format) {
+    if (format.isVector()) {
+        return renderVectorFile(output_path, format);
+    }
+    if (strip_height_ > 0 && strip_height_ < height_) {
+        if (!format.isPlainPNG()) {
+            std::cerr << "Error: il rendering a fasce supporta solo PNG RGBA" << std::endl;
+            return false;
+        }
+        return renderStripsToFile(output_path, format.compression_level);
+    }
     try {
-        // Crea l'immagine
-        mapnik::image_rgba8 img(width_, height_);
+        // Crea l'immagine (riusata dal pool tra un rendering e l'altro)
+        BufferPool::ImagePtr img = BufferPool::shared().acquireImage(width_, height_);
         
         // Renderizza
-        mapnik::agg_renderer<mapnik::image_rgba8> renderer(*map_, img);
-        renderer.apply();
+        renderRegion(*img, 0, 0);
         
         // Salva su file
-        mapnik::save_to_file(img, output_path, "png");
+        mapnik::save_to_file(*img, output_path, format.mapnikFormat());
         
         return true;
     } catch (const std::exception& e) {
@@ -229,8 +558,455 @@ bool MapPathRenderer::renderToFile(const std::string& output_path) {
     }
 }
 
+bool MapPathRenderer::renderStripsToFile(const std::string& output_path, int compression_level) {
+    try {
+        PngStreamWriter png;
+        if (!png.open(output_path, width_, height_, compression_level)) {
+            return false;
+        }
+        return writeStrips(png) && png.close();
+    } catch (const std::exception& e) {
+        std::cerr << "Error rendering strips to file: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool MapPathRenderer::writeStrips(PngStreamWriter& png) const {
+    // Una sola fascia riusata; l'offset verticale dell'agg_renderer
+    // mantiene la trasformazione della mappa intera (bordi senza giunte)
+    const unsigned int overlap = static_cast<unsigned int>(std::ceil(strip_overlap_ * scale_factor_));
+    const unsigned int band_height = std::min(height_, strip_height_ + 2 * overlap);
+    BufferPool::ImagePtr band = BufferPool::shared().acquireImage(width_, band_height);
+    for (unsigned int y0 = 0; y0 < height_; y0 += strip_height_) {
+        const unsigned int rows = std::min(strip_height_, height_ - y0);
+        const unsigned int top = std::min(y0 > overlap ? y0 - overlap : 0u,
+                                          height_ - band_height);
+        renderRegion(*band, 0, top);
+        if (!png.writeRows(*band, y0 - top, rows)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MapPathRenderer::renderToPNG(std::vector<std::uint8_t>& png_data, int compression_level) {
+    try {
+        png_data.clear();
+        PngStreamWriter png;
+        if (!png.open(png_data, width_, height_, compression_level)) {
+            return false;
+        }
+        if (strip_height_ > 0 && strip_height_ < height_) {
+            if (!writeStrips(png)) {
+                return false;
+            }
+        } else {
+            BufferPool::ImagePtr img = BufferPool::shared().acquireImage(width_, height_);
+            renderRegion(*img, 0, 0);
+            if (!png.writeRows(*img, 0, height_)) {
+                return false;
+            }
+        }
+        return png.close();
+    } catch (const std::exception& e) {
+        std::cerr << "Error rendering to PNG buffer: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool MapPathRenderer::renderVectorFile(const std::string& output_path, const ImageFormat& format) {
+#if defined(HAVE_CAIRO)
+    try {
+        // Stessa mappa del raster: il renderer Cairo disegna gli stessi layer
+        // e simboli come tracciati vettoriali, una pagina width × height punti
+        mapnik::cairo_surface_ptr surface;
+        if (format.type == ImageFormat::Type::PDF) {
+#if defined(CAIRO_HAS_PDF_SURFACE)
+            surface.reset(cairo_pdf_surface_create(output_path.c_str(), width_, height_),
+                          mapnik::cairo_surface_closer());
+#endif
+        } else {
+#if defined(CAIRO_HAS_SVG_SURFACE)
+            surface.reset(cairo_svg_surface_create(output_path.c_str(), width_, height_),
+                          mapnik::cairo_surface_closer());
+#endif
+        }
+        if (!surface) {
+            std::cerr << "Error: Cairo è stato compilato senza " << format.extension() << std::endl;
+            return false;
+        }
+        if (cairo_surface_status(surface.get()) != CAIRO_STATUS_SUCCESS) {
+            std::cerr << "Error: impossibile creare " << output_path << ": "
+                      << cairo_status_to_string(cairo_surface_status(surface.get())) << std::endl;
+            return false;
+        }
+        
+        mapnik::cairo_ptr context = mapnik::create_context(surface);
+        mapnik::cairo_renderer<mapnik::cairo_ptr> renderer(*map_, context, scale_factor_);
+        renderer.apply();
+        
+        // Le etichette non passano dai simboli di Mapnik: stesse posizioni del raster
+        if (!label_sets_.empty()) {
+            drawCairoLabels(placeLabels(kAllGroups), context.get());
+        }
+        
+        cairo_surface_finish(surface.get());
+        if (cairo_surface_status(surface.get()) != CAIRO_STATUS_SUCCESS) {
+            std::cerr << "Error writing " << output_path << ": "
+                      << cairo_status_to_string(cairo_surface_status(surface.get())) << std::endl;
+            return false;
+        }
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error rendering vector file: " << e.what() << std::endl;
+        return false;
+    }
+#else
+    (void)output_path;
+    std::cerr << "Error: Mapnik è stato compilato senza Cairo, " << format.extension()
+              << " non disponibile" << std::endl;
+    return false;
+#endif
+}
+
+bool MapPathRenderer::renderToBuffer(std::vector<std::uint8_t>& data, const ImageFormat& format) {
+    if (format.isPlainPNG()) {
+        return renderToPNG(data, format.compression_level);
+    }
+    if (format.isVector()) {
+        std::cerr << "Error: SVG e PDF sono disponibili solo su file" << std::endl;
+        return false;
+    }
+    try {
+        BufferPool::ImagePtr img = BufferPool::shared().acquireImage(width_, height_);
+        renderRegion(*img, 0, 0);
+        const std::string encoded = mapnik::save_to_string(*img, format.mapnikFormat());
+        data.assign(encoded.begin(), encoded.end());
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error rendering to buffer: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool MapPathRenderer::renderToImage(mapnik::image_rgba8& image) {
+    try {
+        if (image.width() != width_ || image.height() != height_) {
+            image = mapnik::image_rgba8(width_, height_);
+        }
+        renderRegion(image, 0, 0);
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error rendering to image: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool MapPathRenderer::renderToOutputs(std::vector<RenderOutput>& outputs) {
+    for (RenderOutput& output : outputs) {
+        if (output.height == 0 && output.width > 0) {
+            output.height = std::max(1u, static_cast<unsigned int>(
+                std::lround(static_cast<double>(output.width) * height_ / width_)));
+        }
+        if (output.width == 0 || output.width > width_ || output.height > height_ ||
+            output.format.isVector()) {
+            std::cerr << "Error: uscita " << output.width << "x" << output.height
+                      << " non valida per una mappa " << width_ << "x" << height_ << std::endl;
+            return false;
+        }
+    }
+    
+    try {
+        // Unica rasterizzazione, alla dimensione piena
+        BufferPool::ImagePtr full = BufferPool::shared().acquireImage(width_, height_);
+        renderRegion(*full, 0, 0);
+        
+        // Ridimensionamento e codifica delle uscite in parallelo
+        return parallelFor(outputs.size(), 0, [&](std::size_t i) {
+            RenderOutput& output = outputs[i];
+            try {
+                BufferPool::ImagePtr scaled;
+                const mapnik::image_rgba8* image = full.get();
+                if (output.width != width_ || output.height != height_) {
+                    scaled = BufferPool::shared().acquireImage(output.width, output.height);
+                    if (!ImageResampler::downsample(*full, *scaled)) {
+                        return false;
+                    }
+                    image = scaled.get();
+                }
+                return encodeOutput(*image, output);
+            } catch (const std::exception& e) {
+                std::cerr << "Error encoding output: " << e.what() << std::endl;
+                return false;
+            }
+        });
+    } catch (const std::exception& e) {
+        std::cerr << "Error rendering outputs: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool MapPathRenderer::encodeOutput(const mapnik::image_rgba8& image, RenderOutput& output) const {
+    output.data.clear();
+    if (output.format.isVector()) {
+        std::cerr << "Error: le uscite ridotte non possono essere vettoriali" << std::endl;
+        return false;
+    }
+    if (!output.format.isPlainPNG()) {
+        // Formati di Mapnik (PNG8, JPEG, WebP, PNG con opzioni zlib)
+        if (output.path.empty()) {
+            const std::string encoded = mapnik::save_to_string(image, output.format.mapnikFormat());
+            output.data.assign(encoded.begin(), encoded.end());
+        } else {
+            mapnik::save_to_file(image, output.path, output.format.mapnikFormat());
+        }
+        return true;
+    }
+    
+    PngStreamWriter png;
+    const int level = output.format.compression_level;
+    const bool opened = output.path.empty()
+        ? png.open(output.data, output.width, output.height, level)
+        : png.open(output.path, output.width, output.height, level);
+    return opened && png.writeRows(image, 0, output.height) && png.close();
+}
+
+bool MapPathRenderer::renderLayerGroups(mapnik::image_rgba8& image) {
+    try {
+        if (image.width() != width_ || image.height() != height_) {
+            image = mapnik::image_rgba8(width_, height_);
+        }
+        
+        // Nuova estensione: tutte le cache sono da rifare
+        const mapnik::box2d<double>& extent = map_->get_current_extent();
+        if (extent.minx() != cached_extent_.minx() || extent.miny() != cached_extent_.miny() ||
+            extent.maxx() != cached_extent_.maxx() || extent.maxy() != cached_extent_.maxy()) {
+            for (LayerGroup& group : layer_groups_) {
+                group.dirty = true;
+            }
+            cached_extent_ = extent;
+        }
+        
+        std::vector<bool> has_layers(layer_groups_.size(), false);
+        for (std::size_t g : layer_group_of_) {
+            has_layers[g] = true;
+        }
+        for (std::size_t g = 0; g < layer_groups_.size(); ++g) {
+            LayerGroup& group = layer_groups_[g];
+            if (!has_layers[g]) {
+                group.raster.reset();
+                group.dirty = false;
+            } else if (group.dirty || !group.raster || group.raster->width() != width_ ||
+                       group.raster->height() != height_) {
+                rasterizeLayerGroup(g);
+            }
+        }
+        
+        // Sfondo (premoltiplicato) e raster dei gruppi nell'ordine di disegno
+        std::uint32_t background = 0;
+        if (const auto& color = map_->background()) {
+            const unsigned int alpha = color->alpha();
+            background = ((color->red() * alpha + 127) / 255) |
+                         (((color->green() * alpha + 127) / 255) << 8) |
+                         (((color->blue() * alpha + 127) / 255) << 16) |
+                         (alpha << 24);
+        }
+        image.set(background);
+        for (const LayerGroup& group : layer_groups_) {
+            if (group.raster) {
+                compositeOver(image, *group.raster);
+            }
+        }
+        image.set_premultiplied(true);
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error rendering layer groups: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool MapPathRenderer::renderLayerGroups(std::vector<std::uint8_t>& data, const ImageFormat& format) {
+    if (format.isVector()) {
+        std::cerr << "Error: SVG e PDF sono disponibili solo su file" << std::endl;
+        return false;
+    }
+    BufferPool::ImagePtr image = BufferPool::shared().acquireImage(width_, height_);
+    if (!renderLayerGroups(*image)) {
+        return false;
+    }
+    try {
+        // Il buffer del chiamante viene riusato (capacità compresa)
+        RenderOutput output;
+        output.width = width_;
+        output.height = height_;
+        output.format = format;
+        output.data.swap(data);
+        const bool success = encodeOutput(*image, output);
+        data.swap(output.data);
+        return success;
+    } catch (const std::exception& e) {
+        std::cerr << "Error encoding layer groups: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+void MapPathRenderer::rasterizeLayerGroup(std::size_t group) {
+    LayerGroup& entry = layer_groups_[group];
+    if (!entry.raster || entry.raster->width() != width_ || entry.raster->height() != height_) {
+        entry.raster = BufferPool::shared().acquireImage(width_, height_);
+    }
+    
+    // Solo i layer del gruppo, su sfondo trasparente (il raster del pool
+    // non è azzerato: lo sfondo trasparente lo ripulisce)
+    std::vector<mapnik::layer>& layers = map_->layers();
+    std::vector<bool> was_active(layers.size());
+    for (std::size_t i = 0; i < layers.size(); ++i) {
+        was_active[i] = layers[i].active();
+        layers[i].set_active(was_active[i] && layer_group_of_[i] == group);
+    }
+    const auto background = map_->background();
+    map_->set_background(mapnik::color(0, 0, 0, 0));
+    
+    auto restore = [&]() {
+        for (std::size_t i = 0; i < layers.size(); ++i) {
+            layers[i].set_active(was_active[i]);
+        }
+        if (background) {
+            map_->set_background(*background);
+        }
+    };
+    try {
+        renderRegion(*entry.raster, 0, 0, group);
+    } catch (...) {
+        restore();
+        throw;
+    }
+    restore();
+    entry.dirty = false;
+}
+
+void MapPathRenderer::setRenderThreads(unsigned int threads) {
+    render_threads_ = threads;
+}
+
+bool MapPathRenderer::setScaleFactor(double scale_factor) {
+    if (!(scale_factor > 0.0)) {
+        std::cerr << "Error: fattore di scala non valido: " << scale_factor << std::endl;
+        return false;
+    }
+    
+    // Stessa estensione su una tela più grande: la scala della mappa in
+    // unità per pixel si divide per il fattore
+    const mapnik::box2d<double> extent = map_->get_current_extent();
+    scale_factor_ = scale_factor;
+    width_ = std::max(1u, static_cast<unsigned int>(std::lround(base_width_ * scale_factor)));
+    height_ = std::max(1u, static_cast<unsigned int>(std::lround(base_height_ * scale_factor)));
+    map_->resize(width_, height_);
+    map_->zoom_to_box(extent);
+    return true;
+}
+
+const std::vector<LabelEngine::PlacedLabel>& MapPathRenderer::placeLabels(std::size_t group) const {
+    const mapnik::box2d<double>& extent = map_->get_current_extent();
+    if (placed_valid_ && placed_group_ == group && placed_width_ == width_ && placed_height_ == height_ &&
+        placed_extent_.minx() == extent.minx() && placed_extent_.miny() == extent.miny() &&
+        placed_extent_.maxx() == extent.maxx() && placed_extent_.maxy() == extent.maxy()) {
+        return placed_labels_;
+    }
+    
+    // Tutti i marker come ostacoli, poi le etichette in ordine di priorità
+    LabelEngine engine(width_, height_);
+    for (const LabelSet& labels : label_sets_) {
+        if (group != kAllGroups && labels.group != group) continue;
+        const unsigned int pixel_size = static_cast<unsigned int>(
+            std::max(1l, std::lround(labels.font_size * scale_factor_)));
+        const int style = engine.addStyle(labels.options, pixel_size, scale_factor_);
+        const double radius = labels.options.marker_radius * scale_factor_;
+        const std::vector<double>& priorities = labels.options.priorities;
+        for (std::size_t i = 0; i < labels.lon.size(); ++i) {
+            double x, y;
+            if (!geoToPixel(labels.lon[i], labels.lat[i], x, y)) continue;
+            engine.addObstacle(x, y, radius);
+            const double priority = labels.options.priority + (i < priorities.size() ? priorities[i] : 0.0);
+            engine.addLabel(x, y, priority, labels.texts[i], style, radius);
+        }
+    }
+    engine.place(placed_labels_);
+    
+    placed_valid_ = true;
+    placed_group_ = group;
+    placed_extent_ = extent;
+    placed_width_ = width_;
+    placed_height_ = height_;
+    return placed_labels_;
+}
+
+void MapPathRenderer::renderRegion(mapnik::image_rgba8& image,
+                                   unsigned int offset_x, unsigned int offset_y,
+                                   std::size_t group) const {
+    const unsigned int columns = (image.width() + kParallelTileSize - 1) / kParallelTileSize;
+    const unsigned int rows = (image.height() + kParallelTileSize - 1) / kParallelTileSize;
+    const unsigned int threads = parallelThreadCount(render_threads_, columns * rows);
+    if (threads <= 1) {
+        mapnik::agg_renderer<mapnik::image_rgba8> renderer(*map_, image, scale_factor_, offset_x, offset_y);
+        renderer.apply();
+        if (!label_sets_.empty()) {
+            LabelEngine::draw(placeLabels(group), image, offset_x, offset_y);
+        }
+        return;
+    }
+    
+    // Simboli più grandi con il fattore di scala: bordo proporzionale
+    const unsigned int overlap = static_cast<unsigned int>(std::ceil(kParallelTileOverlap * scale_factor_));
+    std::atomic<bool> premultiplied{true};
+    
+    // Tile con bordo: simboli ed etichette vicini al taglio vengono disegnati
+    // per intero. Un buffer per thread, preso dal pool alla prima tile
+    const unsigned int buffer_size = kParallelTileSize + 2 * overlap;
+    std::vector<BufferPool::ImagePtr> buffers(threads);
+    parallelFor(columns * rows, threads, [&](std::size_t t, unsigned int worker) {
+        if (!buffers[worker]) {
+            buffers[worker] = BufferPool::shared().acquireImage(buffer_size, buffer_size);
+        }
+        mapnik::image_rgba8& buffer = *buffers[worker];
+        const unsigned int x0 = static_cast<unsigned int>(t % columns) * kParallelTileSize;
+        const unsigned int y0 = static_cast<unsigned int>(t / columns) * kParallelTileSize;
+        const unsigned int w = std::min(kParallelTileSize, image.width() - x0);
+        const unsigned int h = std::min(kParallelTileSize, image.height() - y0);
+        const unsigned int margin_x = std::min(overlap, offset_x + x0);
+        const unsigned int margin_y = std::min(overlap, offset_y + y0);
+        
+        mapnik::agg_renderer<mapnik::image_rgba8> renderer(*map_, buffer, scale_factor_,
+                                                           offset_x + x0 - margin_x,
+                                                           offset_y + y0 - margin_y);
+        renderer.apply();
+        premultiplied = buffer.get_premultiplied();
+        
+        // Regioni disgiunte dell'immagine finale: nessun lock
+        for (unsigned int y = 0; y < h; ++y) {
+            std::memcpy(image.get_row(y0 + y) + x0, buffer.get_row(margin_y + y) + margin_x,
+                        w * sizeof(std::uint32_t));
+        }
+    });
+    
+    // Stato dell'alfa lasciato da agg_renderer nelle tile
+    image.set_premultiplied(premultiplied);
+    
+    // Etichette sull'immagine ricomposta, posizionate sulla mappa intera
+    if (!label_sets_.empty()) {
+        LabelEngine::draw(placeLabels(group), image, offset_x, offset_y);
+    }
+}
+
 void MapPathRenderer::autoSetExtentFromPoints(const std::vector<GPSPoint>& points,
                                                double margin_percent) {
+    autoSetExtentFromPoints(CoordinateView::fromMembers(points, &GPSPoint::longitude,
+                                                        &GPSPoint::latitude),
+                            margin_percent);
+}
+
+void MapPathRenderer::autoSetExtentFromPoints(const CoordinateView& points,
+                                               double margin_percent) {
     if (points.empty()) {
         return;
     }
@@ -241,11 +1017,11 @@ void MapPathRenderer::autoSetExtentFromPoints(const std::vector<GPSPoint>& point
     double min_lat = std::numeric_limits<double>::max();
     double max_lat = std::numeric_limits<double>::lowest();
     
-    for (const auto& point : points) {
-        min_lon = std::min(min_lon, point.longitude);
-        max_lon = std::max(max_lon, point.longitude);
-        min_lat = std::min(min_lat, point.latitude);
-        max_lat = std::max(max_lat, point.latitude);
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        min_lon = std::min(min_lon, points.x(i));
+        max_lon = std::max(max_lon, points.x(i));
+        min_lat = std::min(min_lat, points.y(i));
+        max_lat = std::max(max_lat, points.y(i));
     }
     
     // Aggiungi margine
@@ -0,0 +1,267 @@
+#include "MapProjection.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+namespace ioc_earth {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kDegToRad = kPi / 180.0;
+constexpr double kRadToDeg = 180.0 / kPi;
+
+// Latitudine massima rappresentabile da Mercatore
+constexpr double kMercatorMaxLat = 85.05112878;
+
+// Distanza minima dal polo opposto per la conica di Lambert (gradi)
+constexpr double kConicPoleMargin = 5.0;
+
+// Campioni per lato usati per i box
+constexpr int kBoxSamples = 33;
+
+inline double relativeLon(double lon, double center_lon) {
+    return std::remainder(lon - center_lon, 360.0);
+}
+
+} // namespace
+
+MapProjection MapProjection::longLat() {
+    return MapProjection();
+}
+
+MapProjection MapProjection::mercator(double center_lon) {
+    MapProjection p;
+    p.type_ = MapProjectionType::Mercator;
+    p.center_lon_ = center_lon;
+    return p;
+}
+
+MapProjection MapProjection::orthographic(double center_lon, double center_lat) {
+    MapProjection p;
+    p.type_ = MapProjectionType::Orthographic;
+    p.center_lon_ = center_lon;
+    p.center_lat_ = std::max(-90.0, std::min(90.0, center_lat));
+    return p;
+}
+
+MapProjection MapProjection::lambertConformal(double center_lon, double center_lat,
+                                              double standard_parallel_1, double standard_parallel_2) {
+    MapProjection p;
+    p.type_ = MapProjectionType::LambertConformal;
+    p.center_lon_ = center_lon;
+    p.center_lat_ = center_lat;
+    p.parallel_1_ = standard_parallel_1;
+    p.parallel_2_ = standard_parallel_2;
+
+    // Costanti di Snyder (sfera)
+    const double phi1 = standard_parallel_1 * kDegToRad;
+    const double phi2 = standard_parallel_2 * kDegToRad;
+    const double phi0 = center_lat * kDegToRad;
+    auto t = [](double phi) { return std::tan(kPi / 4.0 + phi / 2.0); };
+    if (std::abs(phi1 - phi2) < 1e-10) {
+        p.lcc_n_ = std::sin(phi1);
+    } else {
+        p.lcc_n_ = std::log(std::cos(phi1) / std::cos(phi2)) / std::log(t(phi2) / t(phi1));
+    }
+    if (std::abs(p.lcc_n_) < 1e-10) {
+        p.lcc_n_ = 1e-10;  // Paralleli simmetrici rispetto all'equatore: conica degenere
+    }
+    p.lcc_f_ = std::cos(phi1) * std::pow(t(phi1), p.lcc_n_) / p.lcc_n_;
+    p.lcc_rho0_ = kSphereRadius * p.lcc_f_ / std::pow(t(phi0), p.lcc_n_);
+    return p;
+}
+
+std::string MapProjection::proj4() const {
+    std::ostringstream s;
+    s.precision(10);
+    switch (type_) {
+        case MapProjectionType::LongLat:
+            return "+proj=longlat +datum=WGS84 +no_defs";
+        case MapProjectionType::Mercator:
+            s << "+proj=merc +lon_0=" << center_lon_;
+            break;
+        case MapProjectionType::Orthographic:
+            s << "+proj=ortho +lat_0=" << center_lat_ << " +lon_0=" << center_lon_;
+            break;
+        case MapProjectionType::LambertConformal:
+            s << "+proj=lcc +lat_1=" << parallel_1_ << " +lat_2=" << parallel_2_
+              << " +lat_0=" << center_lat_ << " +lon_0=" << center_lon_;
+            break;
+    }
+    s << " +R=" << kSphereRadius << " +units=m +no_defs";
+    return s.str();
+}
+
+bool MapProjection::forward(double lon, double lat, double& x, double& y) const {
+    switch (type_) {
+        case MapProjectionType::LongLat:
+            x = lon;
+            y = lat;
+            return true;
+
+        case MapProjectionType::Mercator: {
+            const bool visible = std::abs(lat) <= kMercatorMaxLat;
+            const double phi = std::max(-kMercatorMaxLat, std::min(kMercatorMaxLat, lat)) * kDegToRad;
+            x = kSphereRadius * relativeLon(lon, center_lon_) * kDegToRad;
+            y = kSphereRadius * std::log(std::tan(kPi / 4.0 + phi / 2.0));
+            return visible;
+        }
+
+        case MapProjectionType::Orthographic: {
+            const double phi = lat * kDegToRad;
+            const double lambda = relativeLon(lon, center_lon_) * kDegToRad;
+            const double phi0 = center_lat_ * kDegToRad;
+            const double cos_c = std::sin(phi0) * std::sin(phi) +
+                                 std::cos(phi0) * std::cos(phi) * std::cos(lambda);
+            x = kSphereRadius * std::cos(phi) * std::sin(lambda);
+            y = kSphereRadius * (std::cos(phi0) * std::sin(phi) -
+                                 std::sin(phi0) * std::cos(phi) * std::cos(lambda));
+            if (cos_c >= 0.0) {
+                return true;
+            }
+            // Emisfero nascosto: il punto viene portato sul bordo del disco
+            const double r = std::sqrt(x * x + y * y);
+            if (r > 0.0) {
+                x *= kSphereRadius / r;
+                y *= kSphereRadius / r;
+            }
+            return false;
+        }
+
+        case MapProjectionType::LambertConformal: {
+            const double limit = 90.0 - kConicPoleMargin;
+            const bool visible = lcc_n_ > 0.0 ? lat >= -limit : lat <= limit;
+            const double clamped = lcc_n_ > 0.0 ? std::max(-limit, std::min(90.0, lat))
+                                                : std::min(limit, std::max(-90.0, lat));
+            const double phi = clamped * kDegToRad;
+            const double rho = kSphereRadius * lcc_f_ /
+                               std::pow(std::tan(kPi / 4.0 + phi / 2.0), lcc_n_);
+            const double theta = lcc_n_ * relativeLon(lon, center_lon_) * kDegToRad;
+            x = rho * std::sin(theta);
+            y = lcc_rho0_ - rho * std::cos(theta);
+            return visible;
+        }
+    }
+    return false;
+}
+
+bool MapProjection::inverse(double x, double y, double& lon, double& lat) const {
+    switch (type_) {
+        case MapProjectionType::LongLat:
+            lon = x;
+            lat = y;
+            return true;
+
+        case MapProjectionType::Mercator:
+            lon = center_lon_ + x / kSphereRadius * kRadToDeg;
+            lat = (2.0 * std::atan(std::exp(y / kSphereRadius)) - kPi / 2.0) * kRadToDeg;
+            return true;
+
+        case MapProjectionType::Orthographic: {
+            const double rho = std::sqrt(x * x + y * y);
+            if (rho > kSphereRadius) {
+                return false;
+            }
+            const double phi0 = center_lat_ * kDegToRad;
+            if (rho == 0.0) {
+                lon = center_lon_;
+                lat = center_lat_;
+                return true;
+            }
+            const double c = std::asin(rho / kSphereRadius);
+            lat = std::asin(std::cos(c) * std::sin(phi0) + y * std::sin(c) * std::cos(phi0) / rho) * kRadToDeg;
+            lon = center_lon_ + std::atan2(x * std::sin(c),
+                                           rho * std::cos(c) * std::cos(phi0) -
+                                           y * std::sin(c) * std::sin(phi0)) * kRadToDeg;
+            return true;
+        }
+
+        case MapProjectionType::LambertConformal: {
+            const double sign = lcc_n_ >= 0.0 ? 1.0 : -1.0;
+            const double dy = lcc_rho0_ - y;
+            const double rho = sign * std::sqrt(x * x + dy * dy);
+            if (rho == 0.0) {
+                lon = center_lon_;
+                lat = 90.0 * sign;
+                return true;
+            }
+            const double theta = std::atan2(sign * x, sign * dy);
+            lat = (2.0 * std::atan(std::pow(kSphereRadius * lcc_f_ / rho, 1.0 / lcc_n_)) - kPi / 2.0) * kRadToDeg;
+            lon = center_lon_ + theta / lcc_n_ * kRadToDeg;
+            return std::abs(theta / lcc_n_) <= kPi;
+        }
+    }
+    return false;
+}
+
+void MapProjection::projectBox(double min_lon, double min_lat, double max_lon, double max_lat,
+                               double& min_x, double& min_y, double& max_x, double& max_y) const {
+    if (isLongLat()) {
+        min_x = min_lon;
+        min_y = min_lat;
+        max_x = max_lon;
+        max_y = max_lat;
+        return;
+    }
+
+    min_x = min_y = std::numeric_limits<double>::max();
+    max_x = max_y = std::numeric_limits<double>::lowest();
+    for (int i = 0; i < kBoxSamples; ++i) {
+        const double lat = min_lat + (max_lat - min_lat) * i / (kBoxSamples - 1);
+        for (int j = 0; j < kBoxSamples; ++j) {
+            const double lon = min_lon + (max_lon - min_lon) * j / (kBoxSamples - 1);
+            double x, y;
+            if (!forward(lon, lat, x, y)) continue;
+            min_x = std::min(min_x, x);
+            max_x = std::max(max_x, x);
+            min_y = std::min(min_y, y);
+            max_y = std::max(max_y, y);
+        }
+    }
+
+    if (min_x > max_x) {
+        // Nessun punto visibile: tutta la zona proiettabile
+        min_x = min_y = -kSphereRadius;
+        max_x = max_y = kSphereRadius;
+    }
+}
+
+void MapProjection::geographicBox(double min_x, double min_y, double max_x, double max_y,
+                                  double& min_lon, double& min_lat,
+                                  double& max_lon, double& max_lat) const {
+    if (isLongLat()) {
+        min_lon = min_x;
+        min_lat = min_y;
+        max_lon = max_x;
+        max_lat = max_y;
+        return;
+    }
+
+    min_lon = min_lat = std::numeric_limits<double>::max();
+    max_lon = max_lat = std::numeric_limits<double>::lowest();
+    for (int i = 0; i < kBoxSamples; ++i) {
+        const double y = min_y + (max_y - min_y) * i / (kBoxSamples - 1);
+        for (int j = 0; j < kBoxSamples; ++j) {
+            const double x = min_x + (max_x - min_x) * j / (kBoxSamples - 1);
+            double lon, lat;
+            if (!inverse(x, y, lon, lat)) continue;
+            // Longitudini continue attorno al centro della proiezione
+            lon = center_lon_ + relativeLon(lon, center_lon_);
+            min_lon = std::min(min_lon, lon);
+            max_lon = std::max(max_lon, lon);
+            min_lat = std::min(min_lat, lat);
+            max_lat = std::max(max_lat, lat);
+        }
+    }
+
+    if (min_lon > max_lon) {
+        min_lon = -180.0;
+        min_lat = -90.0;
+        max_lon = 180.0;
+        max_lat = 90.0;
+    }
+}
+
+} // namespace ioc_earth
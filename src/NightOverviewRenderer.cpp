@@ -0,0 +1,242 @@
+#include "NightOverviewRenderer.h"
+#include "PathDensifier.h"
+#include "StarCatalogTransform.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+namespace ioc_earth {
+
+namespace {
+
+// Margine attorno agli eventi con estensione automatica
+constexpr double kAutoMarginPercent = 5.0;
+constexpr double kMinMarginDegrees = 1.0;
+
+void extendBox(const std::vector<OccultationPathPoint>& line,
+               double& min_lon, double& min_lat, double& max_lon, double& max_lat) {
+    for (const auto& p : line) {
+        min_lon = std::min(min_lon, p.longitude);
+        max_lon = std::max(max_lon, p.longitude);
+        min_lat = std::min(min_lat, p.latitude);
+        max_lat = std::max(max_lat, p.latitude);
+    }
+}
+
+} // namespace
+
+NightOverviewRenderer::NightOverviewRenderer(unsigned int width, unsigned int height)
+    : width_(width), height_(height) {
+}
+
+NightOverviewRenderer::~NightOverviewRenderer() = default;
+
+void NightOverviewRenderer::addEvent(std::shared_ptr<const OccultationData> event) {
+    if (!event || event->central_line.empty()) {
+        return;
+    }
+
+    EventEntry entry;
+    entry.min_lon = entry.min_lat = std::numeric_limits<double>::max();
+    entry.max_lon = entry.max_lat = std::numeric_limits<double>::lowest();
+    extendBox(event->central_line, entry.min_lon, entry.min_lat, entry.max_lon, entry.max_lat);
+    extendBox(event->northern_limit, entry.min_lon, entry.min_lat, entry.max_lon, entry.max_lat);
+    extendBox(event->southern_limit, entry.min_lon, entry.min_lat, entry.max_lon, entry.max_lat);
+
+    if (!StarCatalogTransform::julianDateFromISO(event->date_time_utc, entry.jd)) {
+        entry.jd = 0.0;
+    }
+    entry.data = std::move(event);
+    events_.push_back(std::move(entry));
+}
+
+void NightOverviewRenderer::addEvents(const std::vector<std::shared_ptr<const OccultationData>>& events) {
+    events_.reserve(events_.size() + events.size());
+    for (const auto& event : events) {
+        addEvent(event);
+    }
+}
+
+void NightOverviewRenderer::clearEvents() {
+    events_.clear();
+    rendered_events_.clear();
+}
+
+bool NightOverviewRenderer::setDateRange(const std::string& start_utc, const std::string& end_utc) {
+    double start = 0.0, end = 0.0;
+    if ((!start_utc.empty() && !StarCatalogTransform::julianDateFromISO(start_utc, start)) ||
+        (!end_utc.empty() && !StarCatalogTransform::julianDateFromISO(end_utc, end))) {
+        std::cerr << "Error: intervallo di date non valido" << std::endl;
+        return false;
+    }
+    start_jd_ = start;
+    end_jd_ = end;
+    return true;
+}
+
+void NightOverviewRenderer::setExtent(double min_lon, double min_lat, double max_lon, double max_lat) {
+    extent_[0] = min_lon;
+    extent_[1] = min_lat;
+    extent_[2] = max_lon;
+    extent_[3] = max_lat;
+    auto_extent_ = false;
+}
+
+void NightOverviewRenderer::setAutoExtent() {
+    auto_extent_ = true;
+}
+
+bool NightOverviewRenderer::inDateRange(const EventEntry& entry) const {
+    if (start_jd_ == 0.0 && end_jd_ == 0.0) return true;
+    if (entry.jd == 0.0) return false;
+    return (start_jd_ == 0.0 || entry.jd >= start_jd_) && (end_jd_ == 0.0 || entry.jd <= end_jd_);
+}
+
+bool NightOverviewRenderer::render(const std::string& output_path, bool include_shapefile,
+                                   const ImageFormat& format) {
+    try {
+        std::cout << "\n=== Rendering Night Overview ===" << std::endl;
+
+        std::vector<const EventEntry*> selected;
+        for (const auto& entry : events_) {
+            if (inDateRange(entry)) selected.push_back(&entry);
+        }
+
+        // Estensione: fissa o box degli eventi nell'intervallo
+        double min_lon = extent_[0], min_lat = extent_[1], max_lon = extent_[2], max_lat = extent_[3];
+        if (auto_extent_ && !selected.empty()) {
+            min_lon = min_lat = std::numeric_limits<double>::max();
+            max_lon = max_lat = std::numeric_limits<double>::lowest();
+            for (const auto* entry : selected) {
+                min_lon = std::min(min_lon, entry->min_lon);
+                min_lat = std::min(min_lat, entry->min_lat);
+                max_lon = std::max(max_lon, entry->max_lon);
+                max_lat = std::max(max_lat, entry->max_lat);
+            }
+            const double lon_margin = std::max(kMinMarginDegrees, (max_lon - min_lon) * kAutoMarginPercent / 100.0);
+            const double lat_margin = std::max(kMinMarginDegrees, (max_lat - min_lat) * kAutoMarginPercent / 100.0);
+            min_lon = std::max(-180.0, min_lon - lon_margin);
+            max_lon = std::min(180.0, max_lon + lon_margin);
+            min_lat = std::max(-90.0, min_lat - lat_margin);
+            max_lat = std::min(90.0, max_lat + lat_margin);
+        }
+
+        MapPathRenderer renderer(width_, height_);
+        renderer.setProjection(projection_);
+        renderer.setBackgroundColor(style_.background_color);
+        renderer.setExtent(min_lon, min_lat, max_lon, max_lat);
+        renderer.getExtent(min_lon, min_lat, max_lon, max_lat);
+
+        // Scarta gli eventi il cui box non interseca l'estensione
+        rendered_events_.clear();
+        std::vector<const EventEntry*> visible;
+        for (const auto* entry : selected) {
+            if (entry->max_lon >= min_lon && entry->min_lon <= max_lon &&
+                entry->max_lat >= min_lat && entry->min_lat <= max_lat) {
+                visible.push_back(entry);
+                rendered_events_.push_back(entry->data);
+            }
+        }
+        std::cout << "Eventi: " << events_.size() << ", nell'intervallo: " << selected.size()
+                  << ", visibili: " << visible.size() << std::endl;
+
+        if (style_.show_grid && style_.grid_step_degrees > 0.0) {
+            const double step = style_.grid_step_degrees;
+            std::vector<double> grid_lon, grid_lat;
+            for (double lon = std::ceil(min_lon / step) * step; lon <= max_lon; lon += step) {
+                grid_lon.insert(grid_lon.end(), {lon, lon});
+                grid_lat.insert(grid_lat.end(), {min_lat, max_lat});
+            }
+            for (double lat = std::ceil(min_lat / step) * step; lat <= max_lat; lat += step) {
+                grid_lon.insert(grid_lon.end(), {min_lon, max_lon});
+                grid_lat.insert(grid_lat.end(), {lat, lat});
+            }
+            std::vector<CoordinateView> grid;
+            for (std::size_t i = 0; i + 1 < grid_lon.size(); i += 2) {
+                grid.emplace_back(&grid_lon[i], &grid_lat[i], 2);
+            }
+            renderer.addPathBatch(grid, {}, "overview_grid", style_.grid_color, 0.3);
+        }
+
+        if (include_shapefile) {
+            std::cout << "Caricamento shapefile..." << std::endl;
+            renderer.addShapefileLayer("../../data/ne_50m_admin_0_countries.shp", "countries");
+            renderer.addShapefileLayer("../../data/ne_50m_coastline.shp", "coastline");
+        }
+
+        // Geometrie densificate alla scala della mappa riassuntiva
+        const double degrees_per_pixel = std::max((max_lon - min_lon) / width_,
+                                                  (max_lat - min_lat) / height_);
+        const double tolerance = style_.path_tolerance_pixels > 0.0
+            ? style_.path_tolerance_pixels * degrees_per_pixel : 0.0;
+        auto densify = [&](const std::vector<OccultationPathPoint>& line, DensifiedPath& out) {
+            PathDensifier::densify(CoordinateView::fromMembers(line, &OccultationPathPoint::longitude,
+                                                               &OccultationPathPoint::latitude),
+                                   tolerance, out);
+        };
+
+        std::vector<DensifiedPath> central(visible.size());
+        std::vector<DensifiedPath> limits(style_.show_sigma_limits ? visible.size() * 2 : 0);
+        std::vector<CoordinateView> normal_paths, highlight_paths, limit_paths;
+        std::vector<std::string> normal_names, highlight_names, limit_names;
+        std::vector<double> label_lon, label_lat;
+        std::vector<std::string> labels;
+        LabelOptions label_options;
+
+        for (std::size_t i = 0; i < visible.size(); ++i) {
+            const OccultationData& event = *visible[i]->data;
+            const std::string name = event.asteroid_name.empty() ? event.event_id : event.asteroid_name;
+
+            densify(event.central_line, central[i]);
+            const bool highlight = event.magnitude_drop >= style_.highlight_min_drop;
+            (highlight ? highlight_paths : normal_paths).push_back(central[i].view());
+            (highlight ? highlight_names : normal_names).push_back(event.event_id);
+
+            if (style_.show_sigma_limits) {
+                densify(event.northern_limit, limits[i * 2]);
+                densify(event.southern_limit, limits[i * 2 + 1]);
+                limit_paths.push_back(limits[i * 2].view());
+                limit_paths.push_back(limits[i * 2 + 1].view());
+                limit_names.insert(limit_names.end(), {event.event_id, event.event_id});
+            }
+
+            if (style_.show_labels) {
+                const auto& middle = event.central_line[event.central_line.size() / 2];
+                label_lon.push_back(middle.longitude);
+                label_lat.push_back(middle.latitude);
+                labels.push_back(name);
+                label_options.priorities.push_back(event.magnitude_drop);
+            }
+        }
+
+        // Pochi layer per tutti gli eventi: limiti, centrali, centrali evidenziate
+        if (style_.show_sigma_limits) {
+            renderer.addPathBatch(limit_paths, limit_names, "overview_limits",
+                                  style_.sigma_lines_color, style_.sigma_lines_width);
+        }
+        renderer.addPathBatch(normal_paths, normal_names, "overview_central",
+                              style_.central_line_color, style_.central_line_width);
+        renderer.addPathBatch(highlight_paths, highlight_names, "overview_highlight",
+                              style_.highlight_color, style_.central_line_width * 1.5);
+
+        if (!labels.empty()) {
+            CoordinateView points(label_lon.data(), label_lat.data(), label_lon.size());
+            points.withLabels(labels.data());
+            // Con percorsi vicini prevale il nome dell'evento più profondo
+            renderer.addPointLabels(points, "name", style_.label_font_size, label_options);
+        }
+
+        std::cout << "Rendering finale..." << std::endl;
+        bool success = renderer.renderToFile(output_path, format);
+        if (success) {
+            std::cout << "✓ Mappa riassuntiva salvata in: " << output_path << std::endl;
+        }
+        return success;
+    } catch (const std::exception& e) {
+        std::cerr << "Error rendering night overview: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+} // namespace ioc_earth
@@ -1,4 +1,11 @@
 #include "OccultationRenderer.h"
+#include "BufferPool.h"
+#include "PathDensifier.h"
+#include "ShadowAnimation.h"
+#include "ShadowProbabilityMap.h"
+#include "StationCrossTrack.h"
+#include "TileArchive.h"
+#include "VectorTileEncoder.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -61,8 +68,53 @@ namespace {
 
 namespace ioc_earth {
 
+namespace {
+
+// Gruppi di layer, nell'ordine di disegno
+enum LayerGroupBit : unsigned int {
+    kGroupGrid = 1u << 0,
+    kGroupBasemap = 1u << 1,
+    kGroupProbability = 1u << 2,
+    kGroupPaths = 1u << 3,
+    kGroupMarkers = 1u << 4,
+    kGroupStations = 1u << 5
+};
+constexpr unsigned int kLayerGroupCount = 6;
+constexpr unsigned int kAllLayerGroups = (1u << kLayerGroupCount) - 1;
+const char* const kLayerGroupNames[kLayerGroupCount] = {
+    "grid", "basemap", "probability", "paths", "markers", "stations"};
+
+bool samePath(const std::vector<OccultationPathPoint>& a, const std::vector<OccultationPathPoint>& b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                      [](const OccultationPathPoint& p, const OccultationPathPoint& q) {
+                          return p.longitude == q.longitude && p.latitude == q.latitude &&
+                                 p.timestamp == q.timestamp;
+                      });
+}
+
+bool sameMarkers(const std::vector<OccultationData::TimeMarker>& a,
+                 const std::vector<OccultationData::TimeMarker>& b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                      [](const OccultationData::TimeMarker& p, const OccultationData::TimeMarker& q) {
+                          return p.longitude == q.longitude && p.latitude == q.latitude &&
+                                 p.time_utc == q.time_utc && p.seconds_from_start == q.seconds_from_start;
+                      });
+}
+
+bool sameStations(const std::vector<OccultationData::ObservationStation>& a,
+                  const std::vector<OccultationData::ObservationStation>& b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                      [](const OccultationData::ObservationStation& p,
+                         const OccultationData::ObservationStation& q) {
+                          return p.longitude == q.longitude && p.latitude == q.latitude &&
+                                 p.name == q.name && p.status == q.status;
+                      });
+}
+
+} // namespace
+
 OccultationRenderer::OccultationRenderer(unsigned int width, unsigned int height)
-    : width_(width), height_(height) {
+    : data_(std::make_shared<const OccultationData>()), width_(width), height_(height) {
     renderer_ = std::make_unique<MapPathRenderer>(width, height);
 }
 
@@ -81,6 +133,8 @@ bool OccultationRenderer::loadFromJSON(const std::string& json_path) {
         buffer << file.rdbuf();
         std::string json_content = buffer.str();
         
+        OccultationData data{};
+        
         // Parser semplice per il JSON (usa regex per estrarre i dati)
         // Nota: In produzione, usare una libreria come nlohmann/json
         
@@ -88,37 +142,43 @@ bool OccultationRenderer::loadFromJSON(const std::string& json_path) {
         std::regex id_regex(R"raw("id"\s*:\s*"([^"]+)")raw");
         std::smatch match;
         if (std::regex_search(json_content, match, id_regex)) {
-            data_.event_id = match[1];
+            data.event_id = match[1];
         }
         
         // Estrai nome asteroide (formato semplice)
         std::regex asteroid_regex(R"raw("name"\s*:\s*"([^"]+)")raw");
         if (std::regex_search(json_content, match, asteroid_regex)) {
-            data_.asteroid_name = match[1];
+            data.asteroid_name = match[1];
+        }
+        
+        // Estrai diametro dell'asteroide (larghezza dell'ombra)
+        std::regex diameter_regex(R"raw("diameter_km"\s*:\s*([\d.]+))raw");
+        if (std::regex_search(json_content, match, diameter_regex)) {
+            data.shadow_diameter_km = std::stod(match[1]);
         }
         
         // Estrai nome stella
         std::regex star_regex(R"raw("catalog_id"\s*:\s*"([^"]+)")raw");
         if (std::regex_search(json_content, match, star_regex)) {
-            data_.star_name = match[1];
+            data.star_name = match[1];
         }
         
         // Estrai tempo evento
         std::regex time_regex(R"raw("gregorian"\s*:\s*"([^"]+)")raw");
         if (std::regex_search(json_content, match, time_regex)) {
-            data_.date_time_utc = match[1];
+            data.date_time_utc = match[1];
         }
         
         // Estrai magnitude drop
         std::regex mag_regex(R"raw("magnitude_drop"\s*:\s*([\d.]+))raw");
         if (std::regex_search(json_content, match, mag_regex)) {
-            data_.magnitude_drop = std::stod(match[1]);
+            data.magnitude_drop = std::stod(match[1]);
         }
         
         // Estrai durata
         std::regex dur_regex(R"raw("duration_seconds"\s*:\s*([\d.]+))raw");
         if (std::regex_search(json_content, match, dur_regex)) {
-            data_.duration_seconds = std::stod(match[1]);
+            data.duration_seconds = std::stod(match[1]);
         }
         
         // Parse central_line
@@ -133,8 +193,8 @@ bool OccultationRenderer::loadFromJSON(const std::string& json_path) {
             for (std::sregex_iterator i = points_begin; i != points_end; ++i) {
                 std::smatch point_match = *i;
                 // Controllo semplificato: assume che i primi punti siano della central_line
-                if (data_.central_line.size() < 11) {  // Limite per central_line
-                    data_.central_line.emplace_back(
+                if (data.central_line.size() < 11) {  // Limite per central_line
+                    data.central_line.emplace_back(
                         std::stod(point_match[1]),
                         std::stod(point_match[2]),
                         point_match[3]
@@ -156,7 +216,7 @@ bool OccultationRenderer::loadFromJSON(const std::string& json_path) {
                 count++;
                 if (count > 11 && count <= 22) {  // Northern limit è il secondo gruppo
                     std::smatch point_match = *i;
-                    data_.northern_limit.emplace_back(
+                    data.northern_limit.emplace_back(
                         std::stod(point_match[1]),
                         std::stod(point_match[2]),
                         point_match[3]
@@ -178,7 +238,7 @@ bool OccultationRenderer::loadFromJSON(const std::string& json_path) {
                 count++;
                 if (count > 22) {  // Southern limit è il terzo gruppo
                     std::smatch point_match = *i;
-                    data_.southern_limit.emplace_back(
+                    data.southern_limit.emplace_back(
                         std::stod(point_match[1]),
                         std::stod(point_match[2]),
                         point_match[3]
@@ -202,7 +262,7 @@ bool OccultationRenderer::loadFromJSON(const std::string& json_path) {
                 tm.latitude = std::stod(marker_match[2]);
                 tm.time_utc = marker_match[3];
                 tm.seconds_from_start = std::stoi(marker_match[4]);
-                data_.time_markers.push_back(tm);
+                data.time_markers.push_back(tm);
             }
         }
         
@@ -221,17 +281,19 @@ bool OccultationRenderer::loadFromJSON(const std::string& json_path) {
                 station.longitude = std::stod(station_match[2]);
                 station.latitude = std::stod(station_match[3]);
                 station.status = station_match[4];
-                data_.stations.push_back(station);
+                data.stations.push_back(station);
             }
         }
         
+        data_ = std::make_shared<const OccultationData>(std::move(data));
+        
         std::cout << "✓ Dati occultazione caricati con successo" << std::endl;
-        std::cout << "  Evento: " << data_.event_id << std::endl;
-        std::cout << "  Asteroide: " << data_.asteroid_name << std::endl;
-        std::cout << "  Stella: " << data_.star_name << std::endl;
-        std::cout << "  Punti linea centrale: " << data_.central_line.size() << std::endl;
-        std::cout << "  Time markers: " << data_.time_markers.size() << std::endl;
-        std::cout << "  Stazioni: " << data_.stations.size() << std::endl;
+        std::cout << "  Evento: " << data_->event_id << std::endl;
+        std::cout << "  Asteroide: " << data_->asteroid_name << std::endl;
+        std::cout << "  Stella: " << data_->star_name << std::endl;
+        std::cout << "  Punti linea centrale: " << data_->central_line.size() << std::endl;
+        std::cout << "  Time markers: " << data_->time_markers.size() << std::endl;
+        std::cout << "  Stazioni: " << data_->stations.size() << std::endl;
         
         return true;
         
@@ -242,15 +304,56 @@ bool OccultationRenderer::loadFromJSON(const std::string& json_path) {
 }
 
 void OccultationRenderer::setOccultationData(const OccultationData& data) {
-    data_ = data;
+    data_ = std::make_shared<const OccultationData>(data);
+}
+
+void OccultationRenderer::setOccultationData(OccultationData&& data) {
+    data_ = std::make_shared<const OccultationData>(std::move(data));
+}
+
+void OccultationRenderer::setOccultationData(std::shared_ptr<const OccultationData> data) {
+    data_ = data ? std::move(data) : std::make_shared<const OccultationData>();
+}
+
+void OccultationRenderer::setProbabilityMap(const ShadowEventInput& event,
+                                            const ProbabilityMapOptions& options) {
+    probability_event_ = std::make_shared<const ShadowEventInput>(event);
+    probability_options_ = std::make_shared<const ProbabilityMapOptions>(options);
+}
+
+void OccultationRenderer::clearProbabilityMap() {
+    probability_event_.reset();
+    probability_options_.reset();
+}
+
+void OccultationRenderer::setStationRegistry(std::shared_ptr<const StationRegistry> registry,
+                                             double margin_km) {
+    station_registry_ = std::move(registry);
+    station_margin_km_ = margin_km;
 }
 
 void OccultationRenderer::setRenderStyle(const RenderStyle& style) {
     style_ = style;
 }
 
+void OccultationRenderer::setProjection(const MapProjection& projection) {
+    renderer_->setProjection(projection);
+}
+
+void OccultationRenderer::setStripRendering(unsigned int strip_height, unsigned int overlap) {
+    renderer_->setStripRendering(strip_height, overlap);
+}
+
+void OccultationRenderer::setRenderThreads(unsigned int threads) {
+    renderer_->setRenderThreads(threads);
+}
+
+bool OccultationRenderer::setScaleFactor(double scale_factor) {
+    return renderer_->setScaleFactor(scale_factor);
+}
+
 void OccultationRenderer::autoCalculateExtent(double margin_percent) {
-    if (data_.central_line.empty()) {
+    if (data_->central_line.empty()) {
         std::cerr << "Warning: No data to calculate extent" << std::endl;
         return;
     }
@@ -262,7 +365,7 @@ void OccultationRenderer::autoCalculateExtent(double margin_percent) {
     double max_lat = std::numeric_limits<double>::lowest();
     
     // Considera central_line
-    for (const auto& p : data_.central_line) {
+    for (const auto& p : data_->central_line) {
         min_lon = std::min(min_lon, p.longitude);
         max_lon = std::max(max_lon, p.longitude);
         min_lat = std::min(min_lat, p.latitude);
@@ -270,7 +373,7 @@ void OccultationRenderer::autoCalculateExtent(double margin_percent) {
     }
     
     // Considera northern_limit
-    for (const auto& p : data_.northern_limit) {
+    for (const auto& p : data_->northern_limit) {
         min_lon = std::min(min_lon, p.longitude);
         max_lon = std::max(max_lon, p.longitude);
         min_lat = std::min(min_lat, p.latitude);
@@ -278,7 +381,7 @@ void OccultationRenderer::autoCalculateExtent(double margin_percent) {
     }
     
     // Considera southern_limit
-    for (const auto& p : data_.southern_limit) {
+    for (const auto& p : data_->southern_limit) {
         min_lon = std::min(min_lon, p.longitude);
         max_lon = std::max(max_lon, p.longitude);
         min_lat = std::min(min_lat, p.latitude);
@@ -301,189 +404,183 @@ void OccultationRenderer::autoCalculateExtent(double margin_percent) {
     renderer_->setExtent(min_lon, min_lat, max_lon, max_lat);
 }
 
-void OccultationRenderer::renderCentralLine() {
-    if (data_.central_line.empty()) return;
-    
-    // Converti in GPSPoint
-    std::vector<GPSPoint> points;
-    for (const auto& p : data_.central_line) {
-        points.emplace_back(p.longitude, p.latitude, p.timestamp);
+std::shared_ptr<const DensifiedPath> OccultationRenderer::densifyLine(
+    const std::vector<OccultationPathPoint>& line) const {
+    // Tolleranza in gradi dalla scala corrente della mappa
+    double tolerance_deg = 0.0;
+    if (style_.path_tolerance_pixels > 0.0) {
+        double min_lon, min_lat, max_lon, max_lat;
+        renderer_->getExtent(min_lon, min_lat, max_lon, max_lat);
+        // Pixel effettivi: con un fattore di scala la tolleranza si riduce
+        const double degrees_per_pixel = std::max((max_lon - min_lon) / renderer_->width(),
+                                                  (max_lat - min_lat) / renderer_->height());
+        tolerance_deg = style_.path_tolerance_pixels * degrees_per_pixel;
     }
+    return PathDensifier::shared().densify(data_, line, tolerance_deg);
+}
+
+void OccultationRenderer::renderCentralLine() {
+    if (data_->central_line.empty()) return;
     
-    renderer_->addGPSPath(points, style_.central_line_color, style_.central_line_width);
+    auto path = densifyLine(data_->central_line);
+    renderer_->addGPSPath(path->view(), style_.central_line_color, style_.central_line_width);
 }
 
 void OccultationRenderer::renderSigmaLimits() {
     // Northern limit
-    if (!data_.northern_limit.empty()) {
-        std::vector<GPSPoint> points;
-        for (const auto& p : data_.northern_limit) {
-            points.emplace_back(p.longitude, p.latitude, "");
-        }
-        renderer_->addGPSPath(points, style_.sigma_lines_color, style_.sigma_lines_width);
+    if (!data_->northern_limit.empty()) {
+        auto path = densifyLine(data_->northern_limit);
+        renderer_->addGPSPath(path->view(), style_.sigma_lines_color, style_.sigma_lines_width);
     }
     
     // Southern limit
-    if (!data_.southern_limit.empty()) {
-        std::vector<GPSPoint> points;
-        for (const auto& p : data_.southern_limit) {
-            points.emplace_back(p.longitude, p.latitude, "");
-        }
-        renderer_->addGPSPath(points, style_.sigma_lines_color, style_.sigma_lines_width);
+    if (!data_->southern_limit.empty()) {
+        auto path = densifyLine(data_->southern_limit);
+        renderer_->addGPSPath(path->view(), style_.sigma_lines_color, style_.sigma_lines_width);
     }
 }
 
+void OccultationRenderer::renderProbabilityMap() {
+    if (!probability_event_ || !style_.show_probability_map) return;
+    
+    double min_lon, min_lat, max_lon, max_lat;
+    renderer_->getExtent(min_lon, min_lat, max_lon, max_lat);
+    
+    // Raster a risoluzione ridotta: l'overlay viene ricampionato da Mapnik
+    const unsigned int scale = std::max(1u, probability_options_->raster_scale);
+    const unsigned int raster_width = std::max(1u, renderer_->width() / scale);
+    const unsigned int raster_height = std::max(1u, renderer_->height() / scale);
+    
+    ShadowProbabilityMap::Raster raster;
+    if (!ShadowProbabilityMap::compute(*probability_event_, *probability_options_,
+                                       raster_width, raster_height,
+                                       min_lon, min_lat, max_lon, max_lat, raster)) {
+        std::cerr << "Warning: mappa di probabilità non calcolabile per l'evento "
+                  << probability_event_->event_id << std::endl;
+        return;
+    }
+    
+    std::vector<uint8_t> rgba;
+    if (!ShadowProbabilityMap::colorize(raster, style_.probability_color,
+                                        style_.probability_max_opacity, rgba)) {
+        return;
+    }
+    renderer_->addRasterOverlay(rgba, raster.width, raster.height,
+                                min_lon, min_lat, max_lon, max_lat);
+}
+
 void OccultationRenderer::renderTimeMarkers() {
-    if (data_.time_markers.empty()) return;
+    if (data_->time_markers.empty()) return;
     
-    std::vector<GPSPoint> marker_points;
-    for (const auto& tm : data_.time_markers) {
-        std::string label = style_.show_time_labels ? tm.time_utc : "";
-        marker_points.emplace_back(tm.longitude, tm.latitude, label);
+    using TimeMarker = OccultationData::TimeMarker;
+    CoordinateView markers = CoordinateView::fromMembers(data_->time_markers,
+                                                         &TimeMarker::longitude,
+                                                         &TimeMarker::latitude);
+    if (style_.show_time_labels) {
+        markers.withLabels(&data_->time_markers.front().time_utc, sizeof(TimeMarker));
     }
     
-    renderer_->addPointLabels(marker_points, "timestamp", style_.label_font_size);
+    LabelOptions options;
+    options.font = style_.label_font;
+    options.priority = 10.0;
+    renderer_->addPointLabels(markers, "timestamp", style_.label_font_size, options);
 }
 
 void OccultationRenderer::renderObservationStations() {
-    if (data_.stations.empty()) return;
+    if (data_->stations.empty()) return;
     
-    // Raggruppa le stazioni per stato
-    std::vector<GPSPoint> positive_stations, negative_stations, other_stations;
+    // Raggruppa le stazioni per stato (solo indici, nessuna copia dei dati)
+    std::vector<std::size_t> positive_stations, negative_stations, other_stations;
     
-    for (const auto& station : data_.stations) {
-        std::string label = style_.show_station_labels ? station.name : "";
-        
+    for (std::size_t i = 0; i < data_->stations.size(); ++i) {
+        const auto& station = data_->stations[i];
         if (station.status == "positive") {
-            positive_stations.emplace_back(station.longitude, station.latitude, label);
+            positive_stations.push_back(i);
         } else if (station.status == "negative") {
-            negative_stations.emplace_back(station.longitude, station.latitude, label);
+            negative_stations.push_back(i);
         } else {
-            other_stations.emplace_back(station.longitude, station.latitude, label);
+            other_stations.push_back(i);
         }
     }
     
+    using Station = OccultationData::ObservationStation;
+    CoordinateView all_stations = CoordinateView::fromMembers(data_->stations,
+                                                              &Station::longitude,
+                                                              &Station::latitude);
+    if (style_.show_station_labels) {
+        all_stations.withLabels(&data_->stations.front().name, sizeof(Station));
+    }
+    
+    // Le stazioni osservate prevalgono su marker temporali e registro
+    LabelOptions options;
+    options.font = style_.label_font;
+    options.priority = 20.0;
+    
     // Aggiungi le stazioni (con colori diversi se possibile)
-    if (!positive_stations.empty()) {
-        renderer_->addPointLabels(positive_stations, "timestamp", style_.label_font_size);
+    for (const auto* group : {&positive_stations, &negative_stations, &other_stations}) {
+        if (group->empty()) continue;
+        CoordinateView view = all_stations;
+        view.withIndices(group->data(), group->size());
+        renderer_->addPointLabels(view, "timestamp", style_.label_font_size, options);
     }
-    if (!negative_stations.empty()) {
-        renderer_->addPointLabels(negative_stations, "timestamp", style_.label_font_size);
+}
+
+void OccultationRenderer::renderRegisteredStations() {
+    if (!station_registry_ || station_registry_->size() == 0) return;
+    
+    std::vector<StationMatch> matches;
+    station_registry_->queryInPath(*data_, station_margin_km_, matches);
+    if (matches.empty()) return;
+    
+    std::vector<std::size_t> indices(matches.size());
+    for (std::size_t i = 0; i < matches.size(); ++i) {
+        indices[i] = matches[i].index;
     }
-    if (!other_stations.empty()) {
-        renderer_->addPointLabels(other_stations, "timestamp", style_.label_font_size);
+    
+    CoordinateView view = CoordinateView::fromMembers(station_registry_->stations(),
+                                                      &RegisteredStation::longitude,
+                                                      &RegisteredStation::latitude);
+    if (style_.show_station_labels) {
+        view.withLabels(&station_registry_->stations().front().name, sizeof(RegisteredStation));
     }
+    view.withIndices(indices.data(), indices.size());
+    
+    // Etichette con distanza dalla centrale e istante centrale
+    std::vector<std::string> prediction_labels;
+    if (style_.show_station_labels && style_.show_station_predictions) {
+        std::vector<StationPrediction> predictions;
+        if (StationCrossTrack::compute(*data_, view, StationCrossTrack::Options(), predictions)) {
+            prediction_labels = StationCrossTrack::makeLabels(predictions, view);
+            view.withPositionLabels(prediction_labels.data());
+        }
+    }
+    LabelOptions options;
+    options.font = style_.label_font;
+    renderer_->addPointLabels(view, "timestamp", style_.label_font_size, options);
+    
+    std::cout << "Stazioni del registro nella fascia: " << matches.size() << std::endl;
 }
 
 bool OccultationRenderer::renderOccultationMap(const std::string& output_path, 
-                                                bool include_shapefile) {
+                                                bool include_shapefile,
+                                                const ImageFormat& format) {
     try {
         std::cout << "\n=== Rendering Occultation Map ===" << std::endl;
-        
-        // Imposta lo sfondo
-        renderer_->setBackgroundColor(style_.background_color);
-        
-        // Calcola l'estensione automaticamente
-        std::cout << "Calcolo estensione mappa..." << std::endl;
-        autoCalculateExtent(15.0);
-        
-        // Aggiungi griglia di coordinate (lat/lon)
-        if (style_.show_grid) {
-            std::cout << "Aggiunta griglia di coordinate..." << std::endl;
-            double step = style_.grid_step_degrees;
-            
-            // Ottieni i limiti dalla mappa
-            double min_lon, min_lat, max_lon, max_lat;
-            // Nota: MapPathRenderer non espone questi valori direttamente
-            // Possiamo calcolarli dai dati dell'occultazione
-            min_lon = std::numeric_limits<double>::max();
-            max_lon = std::numeric_limits<double>::lowest();
-            min_lat = std::numeric_limits<double>::max();
-            max_lat = std::numeric_limits<double>::lowest();
-            
-            for (const auto& p : data_.central_line) {
-                min_lon = std::min(min_lon, p.longitude);
-                max_lon = std::max(max_lon, p.longitude);
-                min_lat = std::min(min_lat, p.latitude);
-                max_lat = std::max(max_lat, p.latitude);
-            }
-            for (const auto& p : data_.northern_limit) {
-                min_lon = std::min(min_lon, p.longitude);
-                max_lon = std::max(max_lon, p.longitude);
-                min_lat = std::min(min_lat, p.latitude);
-                max_lat = std::max(max_lat, p.latitude);
-            }
-            for (const auto& p : data_.southern_limit) {
-                min_lon = std::min(min_lon, p.longitude);
-                max_lon = std::max(max_lon, p.longitude);
-                min_lat = std::min(min_lat, p.latitude);
-                max_lat = std::max(max_lat, p.latitude);
-            }
-            
-            // Aggiungi margine
-            double lon_margin = (max_lon - min_lon) * 0.15;
-            double lat_margin = (max_lat - min_lat) * 0.15;
-            min_lon -= lon_margin;
-            max_lon += lon_margin;
-            min_lat -= lat_margin;
-            max_lat += lat_margin;
-            
-            // Linee verticali di longitudine
-            double lon_start = std::floor(min_lon / step) * step;
-            for (double lon = lon_start; lon <= max_lon; lon += step) {
-                if (lon >= min_lon && lon <= max_lon) {
-                    std::vector<GPSPoint> lon_line;
-                    lon_line.emplace_back(lon, min_lat, "");
-                    lon_line.emplace_back(lon, max_lat, "");
-                    renderer_->addGPSPath(lon_line, style_.grid_color, 0.3);
-                }
-            }
-            
-            // Linee orizzontali di latitudine
-            double lat_start = std::floor(min_lat / step) * step;
-            for (double lat = lat_start; lat <= max_lat; lat += step) {
-                if (lat >= min_lat && lat <= max_lat) {
-                    std::vector<GPSPoint> lat_line;
-                    lat_line.emplace_back(min_lon, lat, "");
-                    lat_line.emplace_back(max_lon, lat, "");
-                    renderer_->addGPSPath(lat_line, style_.grid_color, 0.3);
-                }
-            }
-        }
-        
-        // Aggiungi shapefile se richiesto
-        if (include_shapefile) {
-            std::cout << "Caricamento shapefile..." << std::endl;
-            renderer_->addShapefileLayer("../../data/ne_50m_admin_0_countries.shp", "countries");
-            renderer_->addShapefileLayer("../../data/ne_50m_coastline.shp", "coastline");
-        }
-        
-        // Renderizza i vari componenti
-        std::cout << "Rendering limiti sigma..." << std::endl;
-        renderSigmaLimits();
-        
-        std::cout << "Rendering linea centrale..." << std::endl;
-        renderCentralLine();
-        
-        std::cout << "Rendering time markers..." << std::endl;
-        renderTimeMarkers();
-        
-        std::cout << "Rendering stazioni osservazione..." << std::endl;
-        renderObservationStations();
+        buildOccultationMap(include_shapefile);
         
         // Renderizza la mappa finale
         std::cout << "Rendering finale..." << std::endl;
-        bool success = renderer_->renderToFile(output_path);
+        bool success = renderer_->renderToFile(output_path, format);
         
         if (success) {
             std::cout << "\n✓ Mappa occultazione generata: " << output_path << std::endl;
             std::cout << "\nDettagli:" << std::endl;
-            std::cout << "  Evento: " << data_.event_id << std::endl;
-            std::cout << "  Asteroide: " << data_.asteroid_name << std::endl;
-            std::cout << "  Stella: " << data_.star_name << std::endl;
-            std::cout << "  Tempo: " << data_.date_time_utc << std::endl;
-            std::cout << "  Durata: " << data_.duration_seconds << " secondi" << std::endl;
-            std::cout << "  Calo magnitudine: " << data_.magnitude_drop << std::endl;
+            std::cout << "  Evento: " << data_->event_id << std::endl;
+            std::cout << "  Asteroide: " << data_->asteroid_name << std::endl;
+            std::cout << "  Stella: " << data_->star_name << std::endl;
+            std::cout << "  Tempo: " << data_->date_time_utc << std::endl;
+            std::cout << "  Durata: " << data_->duration_seconds << " secondi" << std::endl;
+            std::cout << "  Calo magnitudine: " << data_->magnitude_drop << std::endl;
             if (style_.show_grid) {
                 std::cout << "  ✓ Griglia RA/Dec ogni " << style_.grid_step_degrees << "° visibile" << std::endl;
             }
@@ -497,44 +594,386 @@ bool OccultationRenderer::renderOccultationMap(const std::string& output_path,
     }
 }
 
-bool OccultationRenderer::renderToBuffer(std::vector<uint8_t>& png_data,
-                                         bool include_shapefile) {
+bool OccultationRenderer::renderOccultationMaps(std::vector<MapPathRenderer::RenderOutput>& outputs,
+                                                 bool include_shapefile) {
     try {
-        // Crea un file temporaneo
-        std::string temp_file = "/tmp/occultation_temp_" + 
-                               std::to_string(std::time(nullptr)) + ".png";
+        std::cout << "\n=== Rendering Occultation Map ===" << std::endl;
+        buildOccultationMap(include_shapefile);
         
-        // Renderizza su file
-        bool success = renderOccultationMap(temp_file, include_shapefile);
+        std::cout << "Rendering finale (" << outputs.size() << " dimensioni)..." << std::endl;
+        bool success = renderer_->renderToOutputs(outputs);
         
-        if (!success) {
+        if (success) {
+            for (const auto& output : outputs) {
+                std::cout << "✓ " << output.width << "x" << output.height << ": "
+                          << (output.path.empty() ? "buffer di " + std::to_string(output.data.size()) + " bytes"
+                                                  : output.path)
+                          << std::endl;
+            }
+        }
+        
+        return success;
+        
+    } catch (const std::exception& e) {
+        std::cerr << "Error rendering occultation maps: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool OccultationRenderer::renderOccultationMapAtScales(
+    const std::vector<std::pair<double, std::string>>& outputs, bool include_shapefile,
+    const ImageFormat& format) {
+    if (outputs.empty()) {
+        return true;
+    }
+    const double previous_scale = renderer_->scaleFactor();
+    try {
+        std::cout << "\n=== Rendering Occultation Map ===" << std::endl;
+        
+        // Percorsi densificati e raster alla densità massima: validi anche per le scale minori
+        double max_scale = 0.0;
+        for (const auto& output : outputs) {
+            max_scale = std::max(max_scale, output.first);
+        }
+        if (!renderer_->setScaleFactor(max_scale)) {
             return false;
         }
+        buildOccultationMap(include_shapefile);
+        
+        bool success = true;
+        for (const auto& output : outputs) {
+            std::cout << "Rendering finale @" << output.first << "x..." << std::endl;
+            if (!renderer_->setScaleFactor(output.first) || !renderer_->renderToFile(output.second, format)) {
+                success = false;
+                break;
+            }
+            std::cout << "✓ Mappa occultazione generata: " << output.second
+                      << " (" << renderer_->width() << "x" << renderer_->height() << ")" << std::endl;
+        }
+        renderer_->setScaleFactor(previous_scale);
+        return success;
         
-        // Leggi il file in memoria
-        std::ifstream file(temp_file, std::ios::binary);
-        if (!file) {
-            std::cerr << "Error: Cannot read temporary file" << std::endl;
+    } catch (const std::exception& e) {
+        renderer_->setScaleFactor(previous_scale);
+        std::cerr << "Error rendering occultation map: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool OccultationRenderer::renderShadowAnimation(const std::string& output_path,
+                                                const ShadowAnimationOptions& options,
+                                                bool include_shapefile) {
+    try {
+        std::cout << "\n=== Rendering Shadow Animation ===" << std::endl;
+        buildOccultationMap(include_shapefile);
+        
+        // Mappa di base: un solo rendering per tutti i fotogrammi
+        std::cout << "Rendering mappa di base..." << std::endl;
+        BufferPool::ImagePtr base = BufferPool::shared().acquireImage(renderer_->width(), renderer_->height());
+        if (!renderer_->renderToImage(*base)) {
             return false;
         }
         
-        // Ottieni la dimensione del file
-        file.seekg(0, std::ios::end);
-        size_t file_size = file.tellg();
-        file.seekg(0, std::ios::beg);
+        std::vector<ShadowAnimation::Footprint> footprints;
+        const MapPathRenderer& map = *renderer_;
+        if (!ShadowAnimation::computeFootprints(*data_, options,
+                                                [&map](double lon, double lat, double& x, double& y) {
+                                                    return map.geoToPixel(lon, lat, x, y);
+                                                },
+                                                footprints)) {
+            return false;
+        }
         
-        // Leggi i dati
-        png_data.resize(file_size);
-        file.read(reinterpret_cast<char*>(png_data.data()), file_size);
-        file.close();
+        std::cout << "Composizione di " << footprints.size() << " fotogrammi..." << std::endl;
+        return ShadowAnimation::write(*base, footprints, options, output_path);
         
-        // Rimuovi il file temporaneo
-        std::remove(temp_file.c_str());
+    } catch (const std::exception& e) {
+        std::cerr << "Error rendering shadow animation: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+void OccultationRenderer::buildOccultationMap(bool include_shapefile) {
+    // Imposta lo sfondo
+    renderer_->setBackgroundColor(style_.background_color);
+    
+    // Calcola l'estensione automaticamente
+    std::cout << "Calcolo estensione mappa..." << std::endl;
+    autoCalculateExtent(15.0);
+    
+    // Ricostruisce tutti i gruppi (senza accumulare i layer dei rendering precedenti)
+    rebuildLayerGroups(kAllLayerGroups, include_shapefile);
+}
+
+void OccultationRenderer::renderGrid() {
+    double step = style_.grid_step_degrees;
+    
+    // Ottieni i limiti dalla mappa
+    double min_lon, min_lat, max_lon, max_lat;
+    // Nota: MapPathRenderer non espone questi valori direttamente
+    // Possiamo calcolarli dai dati dell'occultazione
+    min_lon = std::numeric_limits<double>::max();
+    max_lon = std::numeric_limits<double>::lowest();
+    min_lat = std::numeric_limits<double>::max();
+    max_lat = std::numeric_limits<double>::lowest();
+    
+    for (const auto& p : data_->central_line) {
+        min_lon = std::min(min_lon, p.longitude);
+        max_lon = std::max(max_lon, p.longitude);
+        min_lat = std::min(min_lat, p.latitude);
+        max_lat = std::max(max_lat, p.latitude);
+    }
+    for (const auto& p : data_->northern_limit) {
+        min_lon = std::min(min_lon, p.longitude);
+        max_lon = std::max(max_lon, p.longitude);
+        min_lat = std::min(min_lat, p.latitude);
+        max_lat = std::max(max_lat, p.latitude);
+    }
+    for (const auto& p : data_->southern_limit) {
+        min_lon = std::min(min_lon, p.longitude);
+        max_lon = std::max(max_lon, p.longitude);
+        min_lat = std::min(min_lat, p.latitude);
+        max_lat = std::max(max_lat, p.latitude);
+    }
+    
+    // Aggiungi margine
+    double lon_margin = (max_lon - min_lon) * 0.15;
+    double lat_margin = (max_lat - min_lat) * 0.15;
+    min_lon -= lon_margin;
+    max_lon += lon_margin;
+    min_lat -= lat_margin;
+    max_lat += lat_margin;
+    
+    // Linee verticali di longitudine
+    double lon_start = std::floor(min_lon / step) * step;
+    for (double lon = lon_start; lon <= max_lon; lon += step) {
+        if (lon >= min_lon && lon <= max_lon) {
+            const double xs[2] = {lon, lon};
+            const double ys[2] = {min_lat, max_lat};
+            renderer_->addGPSPath(CoordinateView(xs, ys, 2), style_.grid_color, 0.3);
+        }
+    }
+    
+    // Linee orizzontali di latitudine
+    double lat_start = std::floor(min_lat / step) * step;
+    for (double lat = lat_start; lat <= max_lat; lat += step) {
+        if (lat >= min_lat && lat <= max_lat) {
+            const double xs[2] = {min_lon, max_lon};
+            const double ys[2] = {lat, lat};
+            renderer_->addGPSPath(CoordinateView(xs, ys, 2), style_.grid_color, 0.3);
+        }
+    }
+}
+
+void OccultationRenderer::rebuildLayerGroups(unsigned int groups, bool include_shapefile) {
+    for (unsigned int g = 0; g < kLayerGroupCount; ++g) {
+        // Tutti i gruppi vengono registrati, anche se invariati, per fissarne l'ordine
+        renderer_->beginLayerGroup(kLayerGroupNames[g]);
+        const unsigned int group = 1u << g;
+        if ((groups & group) == 0) continue;
+        renderer_->clearLayerGroup(kLayerGroupNames[g]);
         
-        // Salva nella cache
-        last_rendered_buffer_ = png_data;
+        switch (group) {
+        case kGroupGrid:
+            // Aggiungi griglia di coordinate (lat/lon)
+            if (style_.show_grid) {
+                std::cout << "Aggiunta griglia di coordinate..." << std::endl;
+                renderGrid();
+            }
+            break;
+        case kGroupBasemap:
+            // Aggiungi shapefile se richiesto
+            if (include_shapefile) {
+                std::cout << "Caricamento shapefile..." << std::endl;
+                renderer_->addShapefileLayer("../../data/ne_50m_admin_0_countries.shp", "countries");
+                renderer_->addShapefileLayer("../../data/ne_50m_coastline.shp", "coastline");
+            }
+            break;
+        case kGroupProbability:
+            if (probability_event_ && style_.show_probability_map) {
+                std::cout << "Rendering mappa di probabilità..." << std::endl;
+                renderProbabilityMap();
+            }
+            break;
+        case kGroupPaths:
+            std::cout << "Rendering limiti sigma..." << std::endl;
+            renderSigmaLimits();
+            
+            std::cout << "Rendering linea centrale..." << std::endl;
+            renderCentralLine();
+            break;
+        case kGroupMarkers:
+            std::cout << "Rendering time markers..." << std::endl;
+            renderTimeMarkers();
+            break;
+        case kGroupStations:
+            std::cout << "Rendering stazioni osservazione..." << std::endl;
+            renderObservationStations();
+            renderRegisteredStations();
+            break;
+        }
+    }
+    
+    // Riferimento per il confronto del prossimo rendering incrementale
+    built_.valid = true;
+    built_.include_shapefile = include_shapefile;
+    built_.data = data_;
+    built_.style = style_;
+    built_.probability_event = probability_event_;
+    built_.station_registry = station_registry_;
+    built_.station_margin_km = station_margin_km_;
+    built_.projection = renderer_->getProjection().proj4();
+    renderer_->getExtent(built_.min_lon, built_.min_lat, built_.max_lon, built_.max_lat);
+    built_.width = renderer_->width();
+    built_.height = renderer_->height();
+}
+
+unsigned int OccultationRenderer::changedLayerGroups(bool include_shapefile) const {
+    // Estensione, proiezione o dimensione diverse: cambiano tutte le geometrie
+    double min_lon, min_lat, max_lon, max_lat;
+    renderer_->getExtent(min_lon, min_lat, max_lon, max_lat);
+    if (!built_.valid || built_.width != renderer_->width() || built_.height != renderer_->height() ||
+        built_.projection != renderer_->getProjection().proj4() ||
+        built_.min_lon != min_lon || built_.min_lat != min_lat ||
+        built_.max_lon != max_lon || built_.max_lat != max_lat) {
+        return kAllLayerGroups;
+    }
+    
+    // Stile: ogni campo tocca solo i gruppi che lo usano (lo sfondo nessuno)
+    const RenderStyle& old_style = built_.style;
+    unsigned int groups = 0;
+    if (old_style.show_grid != style_.show_grid || old_style.grid_color != style_.grid_color ||
+        old_style.grid_step_degrees != style_.grid_step_degrees) {
+        groups |= kGroupGrid;
+    }
+    if (built_.include_shapefile != include_shapefile ||
+        old_style.coastline_color != style_.coastline_color ||
+        old_style.border_color != style_.border_color || old_style.city_color != style_.city_color ||
+        old_style.show_city_names != style_.show_city_names) {
+        groups |= kGroupBasemap;
+    }
+    if (built_.probability_event != probability_event_ ||
+        old_style.show_probability_map != style_.show_probability_map ||
+        old_style.probability_color != style_.probability_color ||
+        old_style.probability_max_opacity != style_.probability_max_opacity) {
+        groups |= kGroupProbability;
+    }
+    if (old_style.central_line_color != style_.central_line_color ||
+        old_style.central_line_width != style_.central_line_width ||
+        old_style.sigma_lines_color != style_.sigma_lines_color ||
+        old_style.sigma_lines_width != style_.sigma_lines_width ||
+        old_style.path_tolerance_pixels != style_.path_tolerance_pixels) {
+        groups |= kGroupPaths;
+    }
+    if (old_style.time_markers_color != style_.time_markers_color ||
+        old_style.time_marker_size != style_.time_marker_size ||
+        old_style.show_time_labels != style_.show_time_labels) {
+        groups |= kGroupMarkers;
+    }
+    if (built_.station_registry != station_registry_ ||
+        built_.station_margin_km != station_margin_km_ ||
+        old_style.station_positive_color != style_.station_positive_color ||
+        old_style.station_negative_color != style_.station_negative_color ||
+        old_style.station_clouded_color != style_.station_clouded_color ||
+        old_style.station_marker_size != style_.station_marker_size ||
+        old_style.show_station_labels != style_.show_station_labels ||
+        old_style.show_station_predictions != style_.show_station_predictions) {
+        groups |= kGroupStations;
+    }
+    // Le etichette stanno nei layer dei punti che descrivono
+    if (old_style.label_font_size != style_.label_font_size || old_style.label_font != style_.label_font) {
+        groups |= kGroupMarkers | kGroupStations;
+    }
+    
+    // Dati: confronto per parte, saltato se i dati sono gli stessi
+    if (built_.data != data_) {
+        const OccultationData& old_data = *built_.data;
+        if (!samePath(old_data.central_line, data_->central_line) ||
+            !samePath(old_data.northern_limit, data_->northern_limit) ||
+            !samePath(old_data.southern_limit, data_->southern_limit)) {
+            // Griglia e stazioni del registro dipendono dalla fascia
+            groups |= kGroupGrid | kGroupPaths | (station_registry_ ? kGroupStations : 0u);
+        }
+        if (!sameMarkers(old_data.time_markers, data_->time_markers)) {
+            groups |= kGroupMarkers;
+        }
+        if (!sameStations(old_data.stations, data_->stations)) {
+            groups |= kGroupStations;
+        }
+    }
+    return groups;
+}
+
+void OccultationRenderer::updateLayerGroups(bool include_shapefile) {
+    renderer_->setBackgroundColor(style_.background_color);
+    autoCalculateExtent(15.0);
+    const unsigned int groups = changedLayerGroups(include_shapefile);
+    if (groups != 0) {
+        rebuildLayerGroups(groups, include_shapefile);
+    }
+}
+
+bool OccultationRenderer::renderIncremental(mapnik::image_rgba8& image, bool include_shapefile) {
+    try {
+        updateLayerGroups(include_shapefile);
+        return renderer_->renderLayerGroups(image);
+    } catch (const std::exception& e) {
+        std::cerr << "Error rendering incremental map: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool OccultationRenderer::renderIncremental(std::shared_ptr<const std::vector<uint8_t>>& data,
+                                            bool include_shapefile,
+                                            const ImageFormat& format) {
+    try {
+        updateLayerGroups(include_shapefile);
+        BufferPool::BytesPtr buffer = BufferPool::shared().acquireBytes(
+            last_rendered_buffer_ ? last_rendered_buffer_->size() : 0);
+        if (!renderer_->renderLayerGroups(*buffer, format)) {
+            return false;
+        }
+        last_rendered_buffer_ = buffer;
+        data = last_rendered_buffer_;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error rendering incremental map: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool OccultationRenderer::renderToBuffer(std::vector<uint8_t>& png_data,
+                                         bool include_shapefile,
+                                         const ImageFormat& format) {
+    std::shared_ptr<const std::vector<uint8_t>> shared_data;
+    if (!renderToBuffer(shared_data, include_shapefile, format)) {
+        return false;
+    }
+    png_data = *shared_data;
+    return true;
+}
+
+bool OccultationRenderer::renderToBuffer(std::shared_ptr<const std::vector<uint8_t>>& png_data,
+                                         bool include_shapefile,
+                                         const ImageFormat& format) {
+    try {
+        std::cout << "\n=== Rendering Occultation Map ===" << std::endl;
+        buildOccultationMap(include_shapefile);
         
-        std::cout << "✓ Immagine PNG generata in buffer (" << png_data.size() << " bytes)" << std::endl;
+        // Codifica direttamente in memoria, in un buffer del pool grande
+        // quanto l'ultimo PNG (niente file temporaneo né riallocazioni)
+        std::cout << "Rendering finale..." << std::endl;
+        BufferPool::BytesPtr buffer = BufferPool::shared().acquireBytes(
+            last_rendered_buffer_ ? last_rendered_buffer_->size() : 0);
+        if (!renderer_->renderToBuffer(*buffer, format)) {
+            return false;
+        }
+        
+        // La cache condivide il buffer con il chiamante, senza copie
+        last_rendered_buffer_ = buffer;
+        png_data = last_rendered_buffer_;
+        
+        std::cout << "✓ Immagine " << format.extension() << " generata in buffer (" << png_data->size() << " bytes)" << std::endl;
         
         return true;
         
@@ -551,13 +990,13 @@ bool OccultationRenderer::exportToHTML(const std::string& output_html_path,
         std::cout << "\n=== Exporting to HTML ===" << std::endl;
         
         // Renderizza in buffer
-        std::vector<uint8_t> png_data;
+        std::shared_ptr<const std::vector<uint8_t>> png_data;
         if (!renderToBuffer(png_data, include_shapefile)) {
             return false;
         }
         
         // Converti in base64
-        std::string base64_image = base64_encode(png_data);
+        std::string base64_image = base64_encode(*png_data);
         
         // Crea la pagina HTML
         std::ofstream html_file(output_html_path);
@@ -674,29 +1113,29 @@ bool OccultationRenderer::exportToHTML(const std::string& output_html_path,
         html_file << "            <div class=\"info-grid\">\n";
         html_file << "                <div class=\"info-item\">\n";
         html_file << "                    <div class=\"info-label\">ID Evento</div>\n";
-        html_file << "                    <div class=\"info-value\">" << data_.event_id << "</div>\n";
+        html_file << "                    <div class=\"info-value\">" << data_->event_id << "</div>\n";
         html_file << "                </div>\n";
         html_file << "                <div class=\"info-item\">\n";
         html_file << "                    <div class=\"info-label\">Asteroide</div>\n";
-        html_file << "                    <div class=\"info-value\">" << data_.asteroid_name << "</div>\n";
+        html_file << "                    <div class=\"info-value\">" << data_->asteroid_name << "</div>\n";
         html_file << "                </div>\n";
         html_file << "                <div class=\"info-item\">\n";
         html_file << "                    <div class=\"info-label\">Stella</div>\n";
-        html_file << "                    <div class=\"info-value\">" << data_.star_name << "</div>\n";
+        html_file << "                    <div class=\"info-value\">" << data_->star_name << "</div>\n";
         html_file << "                </div>\n";
         html_file << "                <div class=\"info-item\">\n";
         html_file << "                    <div class=\"info-label\">Data/Ora (UTC)</div>\n";
-        html_file << "                    <div class=\"info-value\">" << data_.date_time_utc << "</div>\n";
+        html_file << "                    <div class=\"info-value\">" << data_->date_time_utc << "</div>\n";
         html_file << "                </div>\n";
         html_file << "                <div class=\"info-item\">\n";
         html_file << "                    <div class=\"info-label\">Durata</div>\n";
         html_file << "                    <div class=\"info-value\">" << std::fixed << std::setprecision(1) 
-                  << data_.duration_seconds << " secondi</div>\n";
+                  << data_->duration_seconds << " secondi</div>\n";
         html_file << "                </div>\n";
         html_file << "                <div class=\"info-item\">\n";
         html_file << "                    <div class=\"info-label\">Calo Magnitudine</div>\n";
         html_file << "                    <div class=\"info-value\">" << std::fixed << std::setprecision(1) 
-                  << data_.magnitude_drop << " mag</div>\n";
+                  << data_->magnitude_drop << " mag</div>\n";
         html_file << "                </div>\n";
         html_file << "            </div>\n";
         html_file << "        </div>\n";
@@ -739,7 +1178,7 @@ bool OccultationRenderer::exportToHTML(const std::string& output_html_path,
         html_file.close();
         
         std::cout << "✓ Pagina HTML generata: " << output_html_path << std::endl;
-        std::cout << "  Dimensione immagine embedded: " << png_data.size() << " bytes" << std::endl;
+        std::cout << "  Dimensione immagine embedded: " << png_data->size() << " bytes" << std::endl;
         
         return true;
         
@@ -749,11 +1188,133 @@ bool OccultationRenderer::exportToHTML(const std::string& output_html_path,
     }
 }
 
+std::vector<std::size_t> OccultationRenderer::registryStationsInPath() const {
+    std::vector<std::size_t> indices;
+    if (!station_registry_ || station_registry_->size() == 0) return indices;
+    
+    std::vector<StationMatch> matches;
+    station_registry_->queryInPath(*data_, station_margin_km_, matches);
+    indices.reserve(matches.size());
+    for (const auto& match : matches) {
+        indices.push_back(match.index);
+    }
+    return indices;
+}
+
+void OccultationRenderer::addVectorTileLayers(VectorTileEncoder& encoder, unsigned int zoom,
+                                              const std::vector<std::size_t>& registry_indices) const {
+    // Densificazione alla risoluzione di una tile da 256 pixel
+    const double tolerance_deg = style_.path_tolerance_pixels > 0.0
+        ? style_.path_tolerance_pixels * 360.0 / (256.0 * (1u << zoom)) : 0.0;
+    auto view = [&](const std::vector<OccultationPathPoint>& line) {
+        return PathDensifier::shared().densify(data_, line, tolerance_deg);
+    };
+    
+    encoder.beginLayer("sigma_limits");
+    if (!data_->northern_limit.empty()) {
+        encoder.addLine(view(data_->northern_limit)->view(), {{"side", std::string("north")}});
+    }
+    if (!data_->southern_limit.empty()) {
+        encoder.addLine(view(data_->southern_limit)->view(), {{"side", std::string("south")}});
+    }
+    
+    encoder.beginLayer("central_line");
+    if (!data_->central_line.empty()) {
+        encoder.addLine(view(data_->central_line)->view(), {
+            {"event_id", data_->event_id},
+            {"asteroid", data_->asteroid_name},
+            {"star", data_->star_name},
+            {"time_utc", data_->date_time_utc},
+            {"magnitude_drop", data_->magnitude_drop},
+            {"duration_seconds", data_->duration_seconds}
+        });
+    }
+    
+    encoder.beginLayer("time_markers");
+    for (const auto& marker : data_->time_markers) {
+        encoder.addPoint(marker.longitude, marker.latitude, {
+            {"time_utc", marker.time_utc},
+            {"seconds_from_start", static_cast<std::int64_t>(marker.seconds_from_start)}
+        });
+    }
+    
+    encoder.beginLayer("stations");
+    for (const auto& station : data_->stations) {
+        encoder.addPoint(station.longitude, station.latitude, {
+            {"name", station.name},
+            {"status", station.status}
+        });
+    }
+    
+    encoder.beginLayer("registry_stations");
+    for (std::size_t index : registry_indices) {
+        const RegisteredStation& station = station_registry_->stations()[index];
+        encoder.addPoint(station.longitude, station.latitude, {
+            {"name", station.name},
+            {"observer", station.observer}
+        });
+    }
+}
+
+bool OccultationRenderer::exportVectorTile(const TileCoord& tile, std::string& mvt) const {
+    mvt.clear();
+    if (data_->central_line.empty()) {
+        std::cerr << "Error: nessun dato di occultazione da esportare" << std::endl;
+        return false;
+    }
+    
+    VectorTileEncoder encoder(tile);
+    addVectorTileLayers(encoder, tile.z, registryStationsInPath());
+    if (!encoder.empty()) {
+        mvt = encoder.encode();
+    }
+    return true;
+}
+
+bool OccultationRenderer::exportVectorTiles(const std::string& archive_path,
+                                            unsigned int min_zoom, unsigned int max_zoom) const {
+    if (data_->central_line.empty()) {
+        std::cerr << "Error: nessun dato di occultazione da esportare" << std::endl;
+        return false;
+    }
+    
+    // Stessa copertura delle tile raster
+    TileRenderer coverage(data_);
+    coverage.setRenderStyle(style_);
+    TileRenderer::Options options;
+    options.station_margin_km = station_margin_km_;
+    coverage.setOptions(options);
+    coverage.setStationRegistry(station_registry_);
+    
+    TileArchive archive;
+    if (!archive.open(archive_path, TileArchive::TileType::MVT)) {
+        return false;
+    }
+    archive.setMetadata(data_->event_id, data_->asteroid_name + " / " + data_->star_name);
+    
+    const std::vector<std::size_t> registry_indices = registryStationsInPath();
+    std::size_t written = 0;
+    for (unsigned int z = min_zoom; z <= std::min(max_zoom, TileRenderer::kMaxZoom); ++z) {
+        for (const TileCoord& tile : coverage.coveredTiles(z)) {
+            VectorTileEncoder encoder(tile);
+            addVectorTileLayers(encoder, z, registry_indices);
+            if (encoder.empty()) continue;
+            if (!archive.addTile(tile, encoder.encode())) {
+                return false;
+            }
+            ++written;
+        }
+    }
+    
+    std::cout << "Vector tile esportate: " << written << std::endl;
+    return archive.finalize();
+}
+
 std::string OccultationRenderer::getLastRenderedImageBase64() const {
-    if (last_rendered_buffer_.empty()) {
+    if (!last_rendered_buffer_ || last_rendered_buffer_->empty()) {
         return "";
     }
-    return base64_encode(last_rendered_buffer_);
+    return base64_encode(*last_rendered_buffer_);
 }
 
 } // namespace ioc_earth
@@ -0,0 +1,111 @@
+#include "PathDensifier.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ioc_earth {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kDegToRad = kPi / 180.0;
+constexpr double kRadToDeg = 180.0 / kPi;
+
+struct UnitVector {
+    double x, y, z;
+};
+
+inline UnitVector toUnit(double lon_deg, double lat_deg) {
+    const double lon = lon_deg * kDegToRad;
+    const double lat = lat_deg * kDegToRad;
+    return {std::cos(lat) * std::cos(lon), std::cos(lat) * std::sin(lon), std::sin(lat)};
+}
+
+/**
+ * Suddivide l'arco a-b finché il punto medio dell'arco dista dal punto medio
+ * del segmento in lon/lat meno della tolleranza. Aggiunge i punti interni
+ * e l'estremo b. Il confronto avviene con longitudini continue rispetto ad a.
+ */
+void subdivide(double a_lon, double a_lat, const UnitVector& a,
+               double b_lon, double b_lat, const UnitVector& b,
+               double tolerance, int depth, DensifiedPath& out) {
+    const double mx = a.x + b.x, my = a.y + b.y, mz = a.z + b.z;
+    const double norm = std::sqrt(mx * mx + my * my + mz * mz);
+
+    if (depth < PathDensifier::kMaxDepth && norm > 1e-12) {
+        const UnitVector m{mx / norm, my / norm, mz / norm};
+        const double m_lat = std::asin(std::max(-1.0, std::min(1.0, m.z))) * kRadToDeg;
+        double m_lon = std::atan2(m.y, m.x) * kRadToDeg;
+        m_lon = a_lon + std::remainder(m_lon - a_lon, 360.0);
+
+        const double dx = m_lon - (a_lon + b_lon) * 0.5;
+        const double dy = m_lat - (a_lat + b_lat) * 0.5;
+        if (dx * dx + dy * dy > tolerance * tolerance) {
+            subdivide(a_lon, a_lat, a, m_lon, m_lat, m, tolerance, depth + 1, out);
+            subdivide(m_lon, m_lat, m, b_lon, b_lat, b, tolerance, depth + 1, out);
+            return;
+        }
+    }
+
+    // I punti interni restano nell'intervallo [-180, 180] come quelli originali
+    out.lon.push_back(std::abs(b_lon) > 180.0 ? std::remainder(b_lon, 360.0) : b_lon);
+    out.lat.push_back(b_lat);
+}
+
+double quantizeTolerance(double tolerance_deg) {
+    return std::exp2(std::floor(std::log2(tolerance_deg)));
+}
+
+} // namespace
+
+PathDensifier& PathDensifier::shared() {
+    static PathDensifier instance;
+    return instance;
+}
+
+void PathDensifier::densify(const CoordinateView& path, double tolerance_deg, DensifiedPath& out) {
+    out.lon.clear();
+    out.lat.clear();
+    if (path.empty()) return;
+
+    out.lon.reserve(path.size() * 2);
+    out.lat.reserve(path.size() * 2);
+    out.lon.push_back(path.x(0));
+    out.lat.push_back(path.y(0));
+    if (!(tolerance_deg > 0.0)) {
+        for (std::size_t i = 1; i < path.size(); ++i) {
+            out.lon.push_back(path.x(i));
+            out.lat.push_back(path.y(i));
+        }
+        return;
+    }
+
+    UnitVector previous = toUnit(path.x(0), path.y(0));
+    for (std::size_t i = 1; i < path.size(); ++i) {
+        const UnitVector current = toUnit(path.x(i), path.y(i));
+        const double a_lon = path.x(i - 1);
+        const double b_lon = a_lon + std::remainder(path.x(i) - a_lon, 360.0);
+        subdivide(a_lon, path.y(i - 1), previous, b_lon, path.y(i), current,
+                  tolerance_deg, 0, out);
+        out.lon.back() = path.x(i);
+        previous = current;
+    }
+}
+
+DensifiedPathPtr PathDensifier::densify(const std::shared_ptr<const void>& owner,
+                                        const std::vector<OccultationPathPoint>& line,
+                                        double tolerance_deg) {
+    const double tolerance = tolerance_deg > 0.0 ? quantizeTolerance(tolerance_deg) : 0.0;
+    return cache_.getOrCompute(CacheKey(owner, &line, tolerance), [&] {
+        auto result = std::make_shared<DensifiedPath>();
+        densify(CoordinateView::fromMembers(line, &OccultationPathPoint::longitude,
+                                            &OccultationPathPoint::latitude),
+                tolerance, *result);
+        return DensifiedPathPtr(result);
+    });
+}
+
+void PathDensifier::clearCache() {
+    cache_.clear();
+}
+
+} // namespace ioc_earth
@@ -0,0 +1,148 @@
+#include "PngStreamWriter.h"
+#include <png.h>
+#include <algorithm>
+#include <csetjmp>
+#include <cstring>
+#include <iostream>
+
+namespace ioc_earth {
+
+namespace {
+
+void errorHandler(png_structp png, png_const_charp message) {
+    std::cerr << "Error: libpng: " << message << std::endl;
+    png_longjmp(png, 1);
+}
+
+void warningHandler(png_structp, png_const_charp) {
+}
+
+void appendToVector(png_structp png, png_bytep data, png_size_t length) {
+    auto* output = static_cast<std::vector<std::uint8_t>*>(png_get_io_ptr(png));
+    output->insert(output->end(), data, data + length);
+}
+
+void flushVector(png_structp) {
+}
+
+} // namespace
+
+PngStreamWriter::PngStreamWriter() = default;
+
+PngStreamWriter::~PngStreamWriter() {
+    release();
+}
+
+void PngStreamWriter::release() {
+    if (png_) {
+        png_destroy_write_struct(&png_, info_ ? &info_ : nullptr);
+        png_ = nullptr;
+        info_ = nullptr;
+    }
+    if (file_) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+    memory_ = nullptr;
+}
+
+bool PngStreamWriter::open(const std::string& path, unsigned int width, unsigned int height,
+                           int compression_level) {
+    release();
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) {
+        std::cerr << "Error: impossibile creare " << path << std::endl;
+        return false;
+    }
+    return begin(width, height, compression_level);
+}
+
+bool PngStreamWriter::open(std::vector<std::uint8_t>& output, unsigned int width, unsigned int height,
+                           int compression_level) {
+    release();
+    memory_ = &output;
+    return begin(width, height, compression_level);
+}
+
+bool PngStreamWriter::begin(unsigned int width, unsigned int height, int compression_level) {
+    width_ = width;
+    height_ = height;
+    rows_written_ = 0;
+    row_.resize(static_cast<std::size_t>(width) * 4);
+
+    png_ = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, errorHandler, warningHandler);
+    info_ = png_ ? png_create_info_struct(png_) : nullptr;
+    if (!info_) {
+        std::cerr << "Error: inizializzazione di libpng fallita" << std::endl;
+        release();
+        return false;
+    }
+
+    if (setjmp(png_jmpbuf(png_))) {
+        release();
+        return false;
+    }
+    if (file_) {
+        png_init_io(png_, file_);
+    } else {
+        png_set_write_fn(png_, memory_, appendToVector, flushVector);
+    }
+    if (compression_level >= 0) {
+        png_set_compression_level(png_, compression_level);
+    }
+    png_set_IHDR(png_, info_, width, height, 8, PNG_COLOR_TYPE_RGB_ALPHA,
+                 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png_, info_);
+    return true;
+}
+
+bool PngStreamWriter::writeRows(const mapnik::image_rgba8& image, unsigned int first_row, unsigned int count) {
+    if (!png_ || image.width() != width_ || first_row + count > image.height() ||
+        rows_written_ + count > height_) {
+        std::cerr << "Error: righe PNG non valide" << std::endl;
+        return false;
+    }
+
+    const bool premultiplied = image.get_premultiplied();
+    if (setjmp(png_jmpbuf(png_))) {
+        release();
+        return false;
+    }
+    for (unsigned int y = first_row; y < first_row + count; ++y) {
+        std::memcpy(row_.data(), image.get_row(y), row_.size());
+        if (premultiplied) {
+            for (std::size_t i = 0; i < row_.size(); i += 4) {
+                const unsigned int alpha = row_[i + 3];
+                if (alpha == 0 || alpha == 255) continue;
+                for (std::size_t c = 0; c < 3; ++c) {
+                    row_[i + c] = static_cast<std::uint8_t>(
+                        std::min(255u, (row_[i + c] * 255u + alpha / 2) / alpha));
+                }
+            }
+        }
+        png_write_row(png_, row_.data());
+    }
+    rows_written_ += count;
+    return true;
+}
+
+bool PngStreamWriter::close() {
+    if (!png_) {
+        return false;
+    }
+    if (rows_written_ != height_) {
+        std::cerr << "Error: PNG incompleto (" << rows_written_ << "/" << height_ << " righe)" << std::endl;
+        release();
+        return false;
+    }
+    if (setjmp(png_jmpbuf(png_))) {
+        release();
+        return false;
+    }
+    png_write_end(png_, nullptr);
+    const bool flushed = !file_ || std::fflush(file_) == 0;
+    release();
+    return flushed;
+}
+
+} // namespace ioc_earth
@@ -0,0 +1,449 @@
+#include "ShadowAnimation.h"
+#include "BufferPool.h"
+#include "OccultationRenderer.h"
+#include "ParallelFor.h"
+#include "PngStreamWriter.h"
+#include "StarCatalogTransform.h"
+#include <mapnik/color.hpp>
+#include <mapnik/image_util.hpp>
+#include <zlib.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+namespace ioc_earth {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kDegToRad = kPi / 180.0;
+constexpr double kRadToDeg = 180.0 / kPi;
+constexpr double kEarthRadiusKm = 6371.0088;
+
+// Vertici del contorno dell'impronta e sottoscansioni per pixel (antialiasing)
+constexpr unsigned int kFootprintVertices = 48;
+constexpr unsigned int kSubsamples = 4;
+
+const std::uint8_t kPngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+/**
+ * @brief Rettangolo di pixel [x0, x1) × [y0, y1)
+ */
+struct Rect {
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+
+    bool empty() const { return x1 <= x0 || y1 <= y0; }
+    unsigned int width() const { return static_cast<unsigned int>(x1 - x0); }
+    unsigned int height() const { return static_cast<unsigned int>(y1 - y0); }
+};
+
+Rect unite(const Rect& a, const Rect& b) {
+    if (a.empty()) return b;
+    if (b.empty()) return a;
+    return {std::min(a.x0, b.x0), std::min(a.y0, b.y0), std::max(a.x1, b.x1), std::max(a.y1, b.y1)};
+}
+
+/**
+ * @brief Pixel toccati dal poligono, limitati all'immagine
+ */
+Rect bounds(const std::vector<std::pair<double, double>>& polygon, unsigned int width, unsigned int height) {
+    if (polygon.size() < 3) {
+        return Rect();
+    }
+    double min_x = std::numeric_limits<double>::max(), min_y = min_x;
+    double max_x = std::numeric_limits<double>::lowest(), max_y = max_x;
+    for (const auto& p : polygon) {
+        min_x = std::min(min_x, p.first);
+        max_x = std::max(max_x, p.first);
+        min_y = std::min(min_y, p.second);
+        max_y = std::max(max_y, p.second);
+    }
+    Rect rect;
+    rect.x0 = static_cast<int>(std::max(0.0, std::floor(min_x)));
+    rect.y0 = static_cast<int>(std::max(0.0, std::floor(min_y)));
+    rect.x1 = static_cast<int>(std::min(static_cast<double>(width), std::ceil(max_x) + 1.0));
+    rect.y1 = static_cast<int>(std::min(static_cast<double>(height), std::ceil(max_y) + 1.0));
+    return rect.empty() ? Rect() : rect;
+}
+
+/**
+ * @brief Colore dell'impronta, premoltiplicato (componenti 0-255)
+ */
+struct Paint {
+    float r = 0.0f, g = 0.0f, b = 0.0f, a = 0.0f;
+};
+
+/**
+ * @brief Aggiunge a coverage la copertura orizzontale dello span [a, b)
+ */
+void addSpan(std::vector<float>& coverage, double a, double b, float weight) {
+    a = std::max(a, 0.0);
+    b = std::min(b, static_cast<double>(coverage.size()));
+    if (a >= b) return;
+    const std::size_t ia = static_cast<std::size_t>(a);
+    const std::size_t ib = static_cast<std::size_t>(b);
+    if (ia == ib) {
+        coverage[ia] += static_cast<float>(b - a) * weight;
+        return;
+    }
+    coverage[ia] += static_cast<float>(ia + 1 - a) * weight;
+    for (std::size_t i = ia + 1; i < ib; ++i) {
+        coverage[i] += weight;
+    }
+    if (ib < coverage.size()) {
+        coverage[ib] += static_cast<float>(b - ib) * weight;
+    }
+}
+
+/**
+ * @brief Riempie il poligono (regola pari-dispari) con antialiasing
+ *
+ * L'immagine rappresenta la regione della mappa che inizia in
+ * (origin_x, origin_y); il poligono è in pixel della mappa intera.
+ */
+void fillPolygon(mapnik::image_rgba8& image, int origin_x, int origin_y,
+                 const std::vector<std::pair<double, double>>& polygon, const Paint& paint) {
+    if (polygon.size() < 3) return;
+    const bool premultiplied = image.get_premultiplied();
+    std::vector<float> coverage(image.width());
+    std::vector<double> crossings;
+    const float weight = 1.0f / kSubsamples;
+
+    for (unsigned int y = 0; y < image.height(); ++y) {
+        std::fill(coverage.begin(), coverage.end(), 0.0f);
+        bool touched = false;
+        for (unsigned int s = 0; s < kSubsamples; ++s) {
+            const double sy = origin_y + y + (s + 0.5) / kSubsamples;
+            crossings.clear();
+            for (std::size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+                const double y0 = polygon[j].second, y1 = polygon[i].second;
+                if ((y0 <= sy && y1 > sy) || (y1 <= sy && y0 > sy)) {
+                    const double x0 = polygon[j].first, x1 = polygon[i].first;
+                    crossings.push_back(x0 + (sy - y0) * (x1 - x0) / (y1 - y0) - origin_x);
+                }
+            }
+            std::sort(crossings.begin(), crossings.end());
+            for (std::size_t k = 0; k + 1 < crossings.size(); k += 2) {
+                addSpan(coverage, crossings[k], crossings[k + 1], weight);
+                touched = true;
+            }
+        }
+        if (!touched) continue;
+
+        std::uint8_t* row = reinterpret_cast<std::uint8_t*>(image.get_row(y));
+        for (unsigned int x = 0; x < image.width(); ++x) {
+            const float c = std::min(1.0f, coverage[x]);
+            if (c <= 0.0f) continue;
+            std::uint8_t* p = row + 4 * x;
+            const float src_a = paint.a * c;
+            const float keep = 1.0f - src_a / 255.0f;
+            float dst_a = p[3];
+            float dst[3] = {static_cast<float>(p[0]), static_cast<float>(p[1]), static_cast<float>(p[2])};
+            if (!premultiplied) {
+                for (float& v : dst) v = v * dst_a / 255.0f;
+            }
+            const float out_a = src_a + dst_a * keep;
+            const float out[3] = {paint.r * c + dst[0] * keep, paint.g * c + dst[1] * keep,
+                                  paint.b * c + dst[2] * keep};
+            for (int k = 0; k < 3; ++k) {
+                float v = out[k];
+                if (!premultiplied) {
+                    v = out_a > 0.0f ? v * 255.0f / out_a : 0.0f;
+                }
+                p[k] = static_cast<std::uint8_t>(std::min(255.0f, v + 0.5f));
+            }
+            p[3] = static_cast<std::uint8_t>(std::min(255.0f, out_a + 0.5f));
+        }
+    }
+}
+
+/**
+ * @brief Copia la regione rect della base e vi disegna l'impronta
+ */
+void composeRegion(const mapnik::image_rgba8& base, const Rect& rect,
+                   const ShadowAnimation::Footprint& footprint, const Paint& paint,
+                   mapnik::image_rgba8& out) {
+    out.set_premultiplied(base.get_premultiplied());
+    for (unsigned int y = 0; y < rect.height(); ++y) {
+        std::memcpy(out.get_row(y), base.get_row(rect.y0 + y) + rect.x0, rect.width() * sizeof(std::uint32_t));
+    }
+    fillPolygon(out, rect.x0, rect.y0, footprint.polygon, paint);
+}
+
+inline void putUint32(std::string& out, std::uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<char>((value >> shift) & 0xFF));
+    }
+}
+
+inline void putUint16(std::string& out, std::uint16_t value) {
+    out.push_back(static_cast<char>(value >> 8));
+    out.push_back(static_cast<char>(value & 0xFF));
+}
+
+inline std::uint32_t readUint32(const std::uint8_t* p) {
+    return (std::uint32_t(p[0]) << 24) | (std::uint32_t(p[1]) << 16) | (std::uint32_t(p[2]) << 8) | p[3];
+}
+
+/**
+ * @brief Accoda un chunk PNG (lunghezza, tipo, dati, CRC)
+ */
+void putChunk(std::string& out, const char* type, const std::string& data) {
+    putUint32(out, static_cast<std::uint32_t>(data.size()));
+    const std::size_t start = out.size();
+    out.append(type, 4);
+    out += data;
+    const uLong crc = crc32(0L, reinterpret_cast<const Bytef*>(out.data() + start),
+                            static_cast<uInt>(out.size() - start));
+    putUint32(out, static_cast<std::uint32_t>(crc));
+}
+
+/**
+ * @brief Chunk di un PNG in memoria
+ */
+struct PngChunk {
+    std::string type;
+    const std::uint8_t* data;
+    std::uint32_t length;
+};
+
+bool parseChunks(const std::vector<std::uint8_t>& png, std::vector<PngChunk>& chunks) {
+    if (png.size() < 8 || std::memcmp(png.data(), kPngSignature, 8) != 0) {
+        return false;
+    }
+    for (std::size_t pos = 8; pos + 12 <= png.size();) {
+        const std::uint32_t length = readUint32(&png[pos]);
+        if (pos + 12 + length > png.size()) {
+            return false;
+        }
+        chunks.push_back({std::string(reinterpret_cast<const char*>(&png[pos + 4]), 4), &png[pos + 8], length});
+        pos += 12 + length;
+    }
+    return true;
+}
+
+std::string frameControl(std::uint32_t sequence, const Rect& rect, unsigned int delay_ms) {
+    std::string fctl;
+    putUint32(fctl, sequence);
+    putUint32(fctl, rect.width());
+    putUint32(fctl, rect.height());
+    putUint32(fctl, static_cast<std::uint32_t>(rect.x0));
+    putUint32(fctl, static_cast<std::uint32_t>(rect.y0));
+    putUint16(fctl, static_cast<std::uint16_t>(std::min(delay_ms, 65535u)));
+    putUint16(fctl, 1000);
+    fctl.push_back(0);   // dispose_op NONE: il fotogramma resta come base del successivo
+    fctl.push_back(0);   // blend_op SOURCE: la regione viene sostituita
+    return fctl;
+}
+
+} // namespace
+
+bool ShadowAnimation::computeFootprints(const OccultationData& data, const ShadowAnimationOptions& options,
+                                        const PixelTransform& to_pixel, std::vector<Footprint>& footprints) {
+    const auto& line = data.central_line;
+    if (line.size() < 2 || options.frame_count == 0) {
+        std::cerr << "Error: linea centrale insufficiente per l'animazione" << std::endl;
+        return false;
+    }
+    // Larghezza dell'ombra = diametro dell'asteroide; i limiti 1-sigma
+    // includono l'incertezza e disegnerebbero un'ombra troppo larga
+    const double diameter_km = options.shadow_diameter_km > 0.0 ? options.shadow_diameter_km
+                                                                : data.shadow_diameter_km;
+    if (diameter_km <= 0.0) {
+        std::cerr << "Error: diametro dell'ombra sconosciuto (impostare shadow_diameter_km)" << std::endl;
+        return false;
+    }
+    const double radius_km = diameter_km / 2.0;
+
+    // Secondi di ogni vertice: dai timestamp, altrimenti velocità uniforme sulla durata
+    std::vector<double> seconds(line.size(), 0.0);
+    bool timed = true;
+    double first_jd = 0.0;
+    for (std::size_t i = 0; i < line.size() && timed; ++i) {
+        double jd;
+        timed = StarCatalogTransform::julianDateFromISO(line[i].timestamp, jd);
+        if (!timed) break;
+        if (i == 0) first_jd = jd;
+        seconds[i] = (jd - first_jd) * 86400.0;
+        timed = i == 0 || seconds[i] >= seconds[i - 1];
+    }
+    if (!timed || seconds.back() <= 0.0) {
+        for (std::size_t i = 1; i < line.size(); ++i) {
+            const double dx = std::remainder(line[i].longitude - line[i - 1].longitude, 360.0) *
+                              std::cos(line[i].latitude * kDegToRad);
+            seconds[i] = seconds[i - 1] + std::hypot(dx, line[i].latitude - line[i - 1].latitude);
+        }
+        const double duration = data.duration_seconds > 0.0 ? data.duration_seconds : 1.0;
+        const double total = seconds.back() > 0.0 ? seconds.back() : 1.0;
+        for (double& s : seconds) {
+            s = s / total * duration;
+        }
+    }
+
+    footprints.assign(options.frame_count, Footprint());
+    const double total = seconds.back();
+    for (unsigned int f = 0; f < options.frame_count; ++f) {
+        const double t = options.frame_count > 1 ? total * f / (options.frame_count - 1) : 0.0;
+        const std::size_t i = std::min<std::size_t>(
+            line.size() - 2,
+            static_cast<std::size_t>(std::max<std::ptrdiff_t>(
+                0, std::upper_bound(seconds.begin(), seconds.end(), t) - seconds.begin() - 1)));
+        const double span = seconds[i + 1] - seconds[i];
+        const double u = span > 0.0 ? (t - seconds[i]) / span : 0.0;
+        const double lon = line[i].longitude + u * std::remainder(line[i + 1].longitude - line[i].longitude, 360.0);
+        const double lat = line[i].latitude + u * (line[i + 1].latitude - line[i].latitude);
+
+        // Cerchio sulla sfera proiettato vertice per vertice: forma corretta in ogni proiezione
+        Footprint& footprint = footprints[f];
+        footprint.seconds = t;
+        const double delta = radius_km / kEarthRadiusKm;
+        const double phi = lat * kDegToRad, lambda = lon * kDegToRad;
+        for (unsigned int k = 0; k < kFootprintVertices; ++k) {
+            const double bearing = 2.0 * kPi * k / kFootprintVertices;
+            const double phi2 = std::asin(std::sin(phi) * std::cos(delta) +
+                                          std::cos(phi) * std::sin(delta) * std::cos(bearing));
+            const double lambda2 = lambda + std::atan2(std::sin(bearing) * std::sin(delta) * std::cos(phi),
+                                                       std::cos(delta) - std::sin(phi) * std::sin(phi2));
+            double x, y;
+            if (to_pixel(lambda2 * kRadToDeg, phi2 * kRadToDeg, x, y)) {
+                footprint.polygon.emplace_back(x, y);
+            }
+        }
+        if (footprint.polygon.size() < 3) {
+            footprint.polygon.clear();
+        }
+    }
+    return true;
+}
+
+bool ShadowAnimation::write(const mapnik::image_rgba8& base, const std::vector<Footprint>& footprints,
+                            const ShadowAnimationOptions& options, const std::string& output_path) {
+    if (footprints.empty() || base.width() == 0 || base.height() == 0) {
+        std::cerr << "Error: nessun fotogramma da scrivere" << std::endl;
+        return false;
+    }
+
+    Paint paint;
+    try {
+        const mapnik::color color(options.shadow_color);
+        paint.a = static_cast<float>(std::max(0.0, std::min(1.0, options.shadow_opacity)) * color.alpha());
+        paint.r = color.red() * paint.a / 255.0f;
+        paint.g = color.green() * paint.a / 255.0f;
+        paint.b = color.blue() * paint.a / 255.0f;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: colore dell'ombra non valido: " << e.what() << std::endl;
+        return false;
+    }
+    const Rect full{0, 0, static_cast<int>(base.width()), static_cast<int>(base.height())};
+
+    if (options.output == ShadowAnimationOptions::Output::Frames) {
+        const ImageFormat& format = options.frame_format;
+        if (format.isVector()) {
+            std::cerr << "Error: i fotogrammi devono essere raster" << std::endl;
+            return false;
+        }
+        bool ok = false;
+        try {
+            ok = parallelFor(footprints.size(), options.threads, [&](std::size_t i) {
+                std::ostringstream path;
+                path << output_path << "_" << std::setw(4) << std::setfill('0') << i << "." << format.extension();
+                BufferPool::ImagePtr frame = BufferPool::shared().acquireImage(base.width(), base.height());
+                composeRegion(base, full, footprints[i], paint, *frame);
+                if (!format.isPlainPNG()) {
+                    mapnik::save_to_file(*frame, path.str(), format.mapnikFormat());
+                    return true;
+                }
+                PngStreamWriter png;
+                return png.open(path.str(), base.width(), base.height(), format.compression_level) &&
+                       png.writeRows(*frame, 0, base.height()) && png.close();
+            });
+        } catch (const std::exception& e) {
+            std::cerr << "Error rendering animation frame: " << e.what() << std::endl;
+        }
+        if (ok) {
+            std::cout << "✓ Fotogrammi scritti: " << footprints.size() << " (" << output_path << "_NNNN)" << std::endl;
+        }
+        return ok;
+    }
+
+    // APNG: il primo fotogramma è intero, gli altri solo il rettangolo cambiato
+    std::vector<Rect> rects(footprints.size());
+    rects[0] = full;
+    for (std::size_t i = 1; i < footprints.size(); ++i) {
+        rects[i] = unite(bounds(footprints[i - 1].polygon, base.width(), base.height()),
+                         bounds(footprints[i].polygon, base.width(), base.height()));
+        if (rects[i].empty()) {
+            rects[i] = Rect{0, 0, 1, 1};   // Nessun cambiamento visibile: un pixel invariato
+        }
+    }
+
+    std::vector<std::vector<std::uint8_t>> encoded(footprints.size());
+    bool ok = false;
+    try {
+        ok = parallelFor(footprints.size(), options.threads, [&](std::size_t i) {
+            const Rect& rect = rects[i];
+            BufferPool::ImagePtr region = BufferPool::shared().acquireImage(rect.width(), rect.height());
+            composeRegion(base, rect, footprints[i], paint, *region);
+            PngStreamWriter png;
+            return png.open(encoded[i], rect.width(), rect.height(), options.frame_format.compression_level) &&
+                   png.writeRows(*region, 0, rect.height()) && png.close();
+        });
+    } catch (const std::exception& e) {
+        std::cerr << "Error rendering animation frame: " << e.what() << std::endl;
+    }
+    if (!ok) {
+        return false;
+    }
+
+    // Assemblaggio: IHDR del primo fotogramma, acTL, poi fcTL + IDAT/fdAT per fotogramma
+    std::string apng(reinterpret_cast<const char*>(kPngSignature), 8);
+    std::uint32_t sequence = 0;
+    for (std::size_t i = 0; i < encoded.size(); ++i) {
+        std::vector<PngChunk> chunks;
+        if (!parseChunks(encoded[i], chunks)) {
+            std::cerr << "Error: fotogramma PNG non valido" << std::endl;
+            return false;
+        }
+        if (i == 0) {
+            for (const PngChunk& chunk : chunks) {
+                if (chunk.type == "IHDR") {
+                    putChunk(apng, "IHDR", std::string(reinterpret_cast<const char*>(chunk.data), chunk.length));
+                }
+            }
+            std::string actl;
+            putUint32(actl, static_cast<std::uint32_t>(encoded.size()));
+            putUint32(actl, options.loops);
+            putChunk(apng, "acTL", actl);
+        }
+        putChunk(apng, "fcTL", frameControl(sequence++, rects[i], options.frame_delay_ms));
+        for (const PngChunk& chunk : chunks) {
+            if (chunk.type != "IDAT") continue;
+            const std::string payload(reinterpret_cast<const char*>(chunk.data), chunk.length);
+            if (i == 0) {
+                putChunk(apng, "IDAT", payload);
+            } else {
+                std::string fdat;
+                putUint32(fdat, sequence++);
+                putChunk(apng, "fdAT", fdat + payload);
+            }
+        }
+        std::vector<std::uint8_t>().swap(encoded[i]);
+    }
+    putChunk(apng, "IEND", std::string());
+
+    std::ofstream file(output_path, std::ios::binary);
+    if (!file || !file.write(apng.data(), static_cast<std::streamsize>(apng.size()))) {
+        std::cerr << "Error: impossibile scrivere " << output_path << std::endl;
+        return false;
+    }
+    std::cout << "✓ Animazione APNG: " << output_path << " (" << footprints.size() << " fotogrammi, "
+              << apng.size() << " bytes)" << std::endl;
+    return true;
+}
+
+} // namespace ioc_earth
@@ -0,0 +1,280 @@
+#include "ShadowPathEngine.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+namespace ioc_earth {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kDegToRad = kPi / 180.0;
+constexpr double kRadToDeg = 180.0 / kPi;
+
+// Eccentricità al quadrato dell'ellissoide WGS84
+constexpr double kEarthE2 = 0.00669437999014;
+
+constexpr double kSecondsPerDay = 86400.0;
+
+/**
+ * Valuta un polinomio e la sua derivata su tutti gli istanti (Horner, SoA)
+ */
+void evaluatePolynomial(const std::vector<double>& coeffs, const double* t, std::size_t count,
+                        double* value, double* derivative) {
+    std::fill(value, value + count, 0.0);
+    std::fill(derivative, derivative + count, 0.0);
+    for (std::size_t k = coeffs.size(); k-- > 0;) {
+        const double c = coeffs[k];
+        for (std::size_t i = 0; i < count; ++i) {
+            derivative[i] = derivative[i] * t[i] + value[i];
+            value[i] = value[i] * t[i] + c;
+        }
+    }
+}
+
+/**
+ * Centrale e limiti (a ±offset raggi terrestri, perpendicolari al moto)
+ * per gli istanti richiesti
+ */
+void evaluatePath(const BesselianElements& e, const double* hours, std::size_t count,
+                  double offset, ShadowPathEngine::PathSamples& out) {
+    std::vector<double> x(count), y(count), vx(count), vy(count), mu(count);
+    evaluatePolynomial(e.x_coeffs, hours, count, x.data(), vx.data());
+    evaluatePolynomial(e.y_coeffs, hours, count, y.data(), vy.data());
+    for (std::size_t i = 0; i < count; ++i) {
+        mu[i] = e.mu0_deg + e.mu1_deg_per_hour * hours[i];
+    }
+
+    out.central_lon.resize(count);
+    out.central_lat.resize(count);
+    out.on_earth_central.resize(count);
+    ShadowPathEngine::fundamentalPlaneToGeographic(x.data(), y.data(), mu.data(), count,
+                                                   e.star_dec_deg, out.central_lon.data(),
+                                                   out.central_lat.data(),
+                                                   out.on_earth_central.data());
+
+    // Normale al moto orientata verso +η (nord del piano fondamentale)
+    std::vector<double> nx(count), ny(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        const double speed = std::sqrt(vx[i] * vx[i] + vy[i] * vy[i]);
+        const double inv = speed > 0.0 ? 1.0 / speed : 0.0;
+        const double sign = vx[i] >= 0.0 ? 1.0 : -1.0;
+        nx[i] = -vy[i] * inv * sign;
+        ny[i] = vx[i] * inv * sign;
+    }
+
+    std::vector<double> xi(count), eta(count);
+    for (int side = 0; side < 2; ++side) {
+        const double s = side == 0 ? offset : -offset;
+        for (std::size_t i = 0; i < count; ++i) {
+            xi[i] = x[i] + s * nx[i];
+            eta[i] = y[i] + s * ny[i];
+        }
+        auto& lon = side == 0 ? out.north_lon : out.south_lon;
+        auto& lat = side == 0 ? out.north_lat : out.south_lat;
+        auto& on_earth = side == 0 ? out.on_earth_north : out.on_earth_south;
+        lon.resize(count);
+        lat.resize(count);
+        on_earth.resize(count);
+        ShadowPathEngine::fundamentalPlaneToGeographic(xi.data(), eta.data(), mu.data(), count,
+                                                       e.star_dec_deg, lon.data(), lat.data(),
+                                                       on_earth.data());
+    }
+}
+
+bool validate(const ShadowEventInput& input) {
+    const BesselianElements& e = input.elements;
+    if (e.x_coeffs.empty() || e.y_coeffs.empty()) {
+        std::cerr << "Elementi besseliani incompleti per l'evento " << input.event_id << std::endl;
+        return false;
+    }
+    if (!(input.step_seconds > 0.0) || !(input.end_hours > input.start_hours) ||
+        input.asteroid_diameter_km < 0.0 || input.sigma_km < 0.0) {
+        std::cerr << "Parametri di calcolo non validi per l'evento " << input.event_id << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::string formatTimeOfDay(double jd) {
+    // Secondi del giorno UTC arrotondati al secondo
+    double day_seconds = std::fmod((jd + 0.5) * kSecondsPerDay, kSecondsPerDay);
+    long total = std::lround(day_seconds) % 86400;
+    char buffer[16];
+    std::snprintf(buffer, sizeof(buffer), "%02ld:%02ld:%02ld", total / 3600, (total / 60) % 60,
+                  total % 60);
+    return buffer;
+}
+
+} // namespace
+
+void ShadowPathEngine::fundamentalPlaneToGeographic(const double* xi, const double* eta,
+                                                    const double* mu_deg, std::size_t count,
+                                                    double star_dec_deg, double* lon, double* lat,
+                                                    std::uint8_t* on_earth) {
+    // Costanti della declinazione, comuni a tutti i punti
+    const double d = star_dec_deg * kDegToRad;
+    const double rho1 = std::sqrt(1.0 - kEarthE2 * std::cos(d) * std::cos(d));
+    const double sin_d1 = std::sin(d) / rho1;
+    const double cos_d1 = std::sqrt(1.0 - kEarthE2) * std::cos(d) / rho1;
+    const double inv_rho1 = 1.0 / rho1;
+    const double polar_ratio = std::sqrt(1.0 - kEarthE2);
+
+    for (std::size_t i = 0; i < count; ++i) {
+        const double eta1 = eta[i] * inv_rho1;
+        const double zeta2 = 1.0 - xi[i] * xi[i] - eta1 * eta1;
+        const double ok = zeta2 > 0.0 ? 1.0 : 0.0;
+        const double zeta1 = std::sqrt(zeta2 * ok);
+
+        const double b = -eta1 * sin_d1 + zeta1 * cos_d1;     // cos φ1 cos θ
+        const double sin_phi1 = eta1 * cos_d1 + zeta1 * sin_d1;
+        const double cos_phi1 = std::sqrt(xi[i] * xi[i] + b * b);
+
+        const double theta = std::atan2(xi[i], b) * kRadToDeg;
+        lon[i] = std::remainder(theta - mu_deg[i], 360.0);
+        lat[i] = std::atan2(sin_phi1, polar_ratio * cos_phi1) * kRadToDeg;
+        on_earth[i] = static_cast<std::uint8_t>(ok);
+    }
+}
+
+bool ShadowPathEngine::sample(const ShadowEventInput& input, PathSamples& samples) {
+    if (!validate(input)) {
+        return false;
+    }
+
+    const double step_hours = input.step_seconds / 3600.0;
+    const std::size_t count =
+        static_cast<std::size_t>(std::floor((input.end_hours - input.start_hours) / step_hours)) + 1;
+    samples.hours.resize(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        samples.hours[i] = input.start_hours + step_hours * static_cast<double>(i);
+    }
+
+    const double offset = (input.asteroid_diameter_km / 2.0 + input.sigma_km) / kEarthRadiusKm;
+    evaluatePath(input.elements, samples.hours.data(), count, offset, samples);
+
+    // Istante di massimo avvicinamento al centro della Terra e velocità dell'ombra
+    std::vector<double> x(count), y(count), vx(count), vy(count);
+    evaluatePolynomial(input.elements.x_coeffs, samples.hours.data(), count, x.data(), vx.data());
+    evaluatePolynomial(input.elements.y_coeffs, samples.hours.data(), count, y.data(), vy.data());
+    std::size_t closest = 0;
+    for (std::size_t i = 1; i < count; ++i) {
+        if (x[i] * x[i] + y[i] * y[i] < x[closest] * x[closest] + y[closest] * y[closest]) {
+            closest = i;
+        }
+    }
+    samples.closest_hours = samples.hours[closest];
+    samples.shadow_speed_km_s =
+        std::sqrt(vx[closest] * vx[closest] + vy[closest] * vy[closest]) * kEarthRadiusKm / 3600.0;
+    return true;
+}
+
+bool ShadowPathEngine::compute(const ShadowEventInput& input, OccultationData& data) {
+    PathSamples samples;
+    if (!sample(input, samples)) {
+        return false;
+    }
+
+    const BesselianElements& e = input.elements;
+    data = OccultationData{};
+    data.event_id = input.event_id;
+    data.asteroid_name = input.asteroid_name;
+    data.star_name = input.star_name;
+    data.magnitude_drop = input.magnitude_drop;
+    data.date_time_utc = isoFromJulianDate(e.t0_jd + samples.closest_hours / 24.0);
+    data.shadow_diameter_km = input.asteroid_diameter_km;
+    data.duration_seconds = samples.shadow_speed_km_s > 0.0
+        ? input.asteroid_diameter_km / samples.shadow_speed_km_s : 0.0;
+
+    const std::size_t count = samples.hours.size();
+    for (std::size_t i = 0; i < count; ++i) {
+        const std::string timestamp = isoFromJulianDate(e.t0_jd + samples.hours[i] / 24.0);
+        if (samples.on_earth_central[i]) {
+            data.central_line.emplace_back(samples.central_lon[i], samples.central_lat[i], timestamp);
+        }
+        if (samples.on_earth_north[i]) {
+            data.northern_limit.emplace_back(samples.north_lon[i], samples.north_lat[i], timestamp);
+        }
+        if (samples.on_earth_south[i]) {
+            data.southern_limit.emplace_back(samples.south_lon[i], samples.south_lat[i], timestamp);
+        }
+    }
+
+    if (data.central_line.empty()) {
+        std::cerr << "L'ombra dell'evento " << input.event_id << " non tocca la Terra" << std::endl;
+        return false;
+    }
+
+    // Marker a istanti UTC arrotondati all'intervallo richiesto
+    if (input.marker_interval_seconds > 0.0) {
+        const double interval_days = input.marker_interval_seconds / kSecondsPerDay;
+        const double first_jd = std::ceil((e.t0_jd + input.start_hours / 24.0) / interval_days) *
+                                interval_days;
+        const double last_jd = e.t0_jd + input.end_hours / 24.0;
+        const double mid_jd = e.t0_jd + samples.closest_hours / 24.0;
+
+        std::vector<double> marker_hours;
+        for (double jd = first_jd; jd <= last_jd; jd += interval_days) {
+            marker_hours.push_back((jd - e.t0_jd) * 24.0);
+        }
+
+        PathSamples markers;
+        evaluatePath(e, marker_hours.data(), marker_hours.size(), 0.0, markers);
+        for (std::size_t i = 0; i < marker_hours.size(); ++i) {
+            if (!markers.on_earth_central[i]) continue;
+            const double jd = e.t0_jd + marker_hours[i] / 24.0;
+            OccultationData::TimeMarker marker;
+            marker.longitude = markers.central_lon[i];
+            marker.latitude = markers.central_lat[i];
+            marker.time_utc = formatTimeOfDay(jd);
+            marker.seconds_from_start = static_cast<int>(std::lround((jd - mid_jd) * kSecondsPerDay));
+            data.time_markers.push_back(std::move(marker));
+        }
+    }
+    return true;
+}
+
+std::vector<std::shared_ptr<const OccultationData>> ShadowPathEngine::computeBatch(
+    const std::vector<ShadowEventInput>& inputs, unsigned int threads) {
+    std::vector<std::shared_ptr<const OccultationData>> results(inputs.size());
+
+    // Distribuzione dinamica: gli eventi hanno griglie di lunghezza diversa
+    parallelFor(inputs.size(), threads, [&](std::size_t i) {
+        OccultationData data;
+        if (compute(inputs[i], data)) {
+            results[i] = std::make_shared<const OccultationData>(std::move(data));
+        }
+    });
+    return results;
+}
+
+std::string ShadowPathEngine::isoFromJulianDate(double jd) {
+    // Algoritmo di Meeus (inverso), con arrotondamento al millisecondo
+    const double z_ms = std::round((jd + 0.5) * kSecondsPerDay * 1000.0);
+    const double z = std::floor(z_ms / (kSecondsPerDay * 1000.0));
+    const int ms_of_day = static_cast<int>(z_ms - z * kSecondsPerDay * 1000.0);
+
+    double a = z;
+    if (z >= 2299161.0) {
+        const double alpha = std::floor((z - 1867216.25) / 36524.25);
+        a = z + 1.0 + alpha - std::floor(alpha / 4.0);
+    }
+    const double b = a + 1524.0;
+    const double c = std::floor((b - 122.1) / 365.25);
+    const double d = std::floor(365.25 * c);
+    const double e = std::floor((b - d) / 30.6001);
+
+    const int day = static_cast<int>(b - d - std::floor(30.6001 * e));
+    const int month = static_cast<int>(e < 14.0 ? e - 1.0 : e - 13.0);
+    const int year = static_cast<int>(month > 2 ? c - 4716.0 : c - 4715.0);
+
+    char buffer[48];
+    std::snprintf(buffer, sizeof(buffer), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ",
+                  year, month, day, ms_of_day / 3600000, (ms_of_day / 60000) % 60,
+                  (ms_of_day / 1000) % 60, ms_of_day % 1000);
+    return buffer;
+}
+
+} // namespace ioc_earth
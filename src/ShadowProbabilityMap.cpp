@@ -0,0 +1,211 @@
+#include "ShadowProbabilityMap.h"
+#include "ParallelFor.h"
+#include <mapnik/color.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+namespace ioc_earth {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kDegToRad = kPi / 180.0;
+
+// Rapporto tra semiasse polare ed equatoriale (WGS84)
+constexpr double kPolarAxisRatio = 0.99664718933525;
+
+// Risoluzione del profilo trasversale e ampiezza in sigma
+constexpr std::size_t kProfileBins = 4096;
+constexpr double kProfileSigmas = 5.0;
+
+// Iterazioni di Newton sull'istante di massimo avvicinamento
+constexpr int kNewtonIterations = 3;
+
+/**
+ * Probabilità di copertura in funzione della distanza trasversale (km)
+ */
+struct CrossTrackProfile {
+    double half_range = 0.0;
+    double bin_width = 1.0;
+    std::vector<float> probability;
+
+    float at(double cross_km) const {
+        const double pos = (cross_km + half_range) / bin_width - 0.5;
+        if (!(pos >= 0.0) || pos >= static_cast<double>(probability.size() - 1)) {
+            return 0.0f;
+        }
+        const std::size_t i = static_cast<std::size_t>(pos);
+        const float f = static_cast<float>(pos - static_cast<double>(i));
+        return probability[i] + (probability[i + 1] - probability[i]) * f;
+    }
+};
+
+CrossTrackProfile buildProfile(double radius_km, double sigma_km, unsigned int clones,
+                               unsigned int seed) {
+    CrossTrackProfile profile;
+    profile.half_range = radius_km + kProfileSigmas * sigma_km + 1.0;
+    profile.bin_width = 2.0 * profile.half_range / static_cast<double>(kProfileBins);
+    profile.probability.assign(kProfileBins, 0.0f);
+    if (radius_km <= 0.0) {
+        return profile;
+    }
+
+    // Ogni clone copre l'intervallo [o - R, o + R]: array differenze
+    std::vector<int> diff(kProfileBins + 1, 0);
+    std::mt19937_64 rng(seed);
+    std::normal_distribution<double> offset(0.0, sigma_km);
+    const unsigned int count = sigma_km > 0.0 ? std::max(1u, clones) : 1u;
+    for (unsigned int k = 0; k < count; ++k) {
+        const double o = sigma_km > 0.0 ? offset(rng) : 0.0;
+        const double lo = std::ceil((o - radius_km + profile.half_range) / profile.bin_width - 0.5);
+        const double hi = std::floor((o + radius_km + profile.half_range) / profile.bin_width - 0.5);
+        if (hi < 0.0 || lo > static_cast<double>(kProfileBins - 1) || hi < lo) continue;
+        diff[static_cast<std::size_t>(std::max(lo, 0.0))] += 1;
+        diff[static_cast<std::size_t>(std::min(hi, static_cast<double>(kProfileBins - 1))) + 1] -= 1;
+    }
+
+    int running = 0;
+    const float scale = 1.0f / static_cast<float>(count);
+    for (std::size_t i = 0; i < kProfileBins; ++i) {
+        running += diff[i];
+        profile.probability[i] = static_cast<float>(running) * scale;
+    }
+    return profile;
+}
+
+inline void horner(const std::vector<double>& coeffs, double t, double& value, double& rate) {
+    value = 0.0;
+    rate = 0.0;
+    for (std::size_t k = coeffs.size(); k-- > 0;) {
+        rate = rate * t + value;
+        value = value * t + coeffs[k];
+    }
+}
+
+} // namespace
+
+bool ShadowProbabilityMap::compute(const ShadowEventInput& event,
+                                   const ProbabilityMapOptions& options,
+                                   unsigned int width, unsigned int height,
+                                   double min_lon, double min_lat, double max_lon, double max_lat,
+                                   Raster& raster) {
+    ShadowPathEngine::PathSamples samples;
+    if (width == 0 || height == 0 || !ShadowPathEngine::sample(event, samples)) {
+        return false;
+    }
+
+    raster.width = width;
+    raster.height = height;
+    raster.min_lon = min_lon;
+    raster.min_lat = min_lat;
+    raster.max_lon = max_lon;
+    raster.max_lat = max_lat;
+    raster.probability.assign(static_cast<std::size_t>(width) * height, 0.0f);
+
+    const double orbit_sigma = options.orbit_sigma_km >= 0.0 ? options.orbit_sigma_km : event.sigma_km;
+    const double sigma = std::sqrt(orbit_sigma * orbit_sigma +
+                                   options.star_sigma_km * options.star_sigma_km);
+    const CrossTrackProfile profile = buildProfile(event.asteroid_diameter_km / 2.0, sigma,
+                                                   options.clones, options.seed);
+
+    const BesselianElements& e = event.elements;
+    const double sin_d = std::sin(e.star_dec_deg * kDegToRad);
+    const double cos_d = std::cos(e.star_dec_deg * kDegToRad);
+    const double mu1 = e.mu1_deg_per_hour * kDegToRad;
+    const double t_start = samples.closest_hours;
+    const double lon_step = (max_lon - min_lon) / width;
+    const double lat_step = (max_lat - min_lat) / height;
+
+    auto render_row = [&](unsigned int row, std::vector<double>& t) {
+        // Coordinate geocentriche dell'osservatore, costanti lungo la riga
+        const double lat = (max_lat - (row + 0.5) * lat_step) * kDegToRad;
+        const double u = std::atan(kPolarAxisRatio * std::tan(lat));
+        const double rho_sin = kPolarAxisRatio * std::sin(u);
+        const double rho_cos = std::cos(u);
+        float* out = &raster.probability[static_cast<std::size_t>(row) * width];
+
+        std::fill(t.begin(), t.end(), t_start);
+        for (int iteration = 0; iteration <= kNewtonIterations; ++iteration) {
+            const bool last = iteration == kNewtonIterations;
+            for (unsigned int col = 0; col < width; ++col) {
+                double x, vx, y, vy;
+                horner(e.x_coeffs, t[col], x, vx);
+                horner(e.y_coeffs, t[col], y, vy);
+                const double lon = min_lon + (col + 0.5) * lon_step;
+                const double hour_angle = (e.mu0_deg + e.mu1_deg_per_hour * t[col] + lon) * kDegToRad;
+                const double sin_h = std::sin(hour_angle);
+                const double cos_h = std::cos(hour_angle);
+
+                const double xi = rho_cos * sin_h;
+                const double eta = rho_sin * cos_d - rho_cos * cos_h * sin_d;
+                const double du = mu1 * rho_cos * cos_h - vx;
+                const double dw = mu1 * xi * sin_d - vy;
+                const double dx = xi - x;
+                const double dy = eta - y;
+
+                if (!last) {
+                    const double denom = du * du + dw * dw;
+                    t[col] -= denom > 0.0 ? (dx * du + dy * dw) / denom : 0.0;
+                    continue;
+                }
+
+                // Distanza trasversale con la stessa orientazione dei limiti nord/sud
+                const double speed = std::sqrt(vx * vx + vy * vy);
+                const double sign = vx >= 0.0 ? 1.0 : -1.0;
+                const double nx = speed > 0.0 ? -vy / speed * sign : 0.0;
+                const double ny = speed > 0.0 ? vx / speed * sign : 0.0;
+                const double cross_km = (dx * nx + dy * ny) * ShadowPathEngine::kEarthRadiusKm;
+
+                const double zeta = rho_sin * sin_d + rho_cos * cos_h * cos_d;
+                const bool valid = zeta > 0.0 && t[col] >= event.start_hours &&
+                                   t[col] <= event.end_hours;
+                out[col] = valid ? profile.at(cross_km) : 0.0f;
+            }
+        }
+    };
+
+    // Un buffer dei tempi per thread
+    const unsigned int threads = parallelThreadCount(options.threads, height);
+    std::vector<std::vector<double>> times(threads);
+    parallelFor(height, threads, [&](std::size_t row, unsigned int worker) {
+        std::vector<double>& t = times[worker];
+        t.resize(width);
+        render_row(static_cast<unsigned int>(row), t);
+    });
+    return true;
+}
+
+bool ShadowProbabilityMap::colorize(const Raster& raster, const std::string& color,
+                                    double max_alpha, std::vector<uint8_t>& rgba) {
+    // Stessa sintassi degli altri colori dello stile (nomi, #rgb, rgba(...))
+    std::uint8_t r, g, b;
+    double color_alpha;
+    try {
+        const mapnik::color parsed(color);
+        r = parsed.red();
+        g = parsed.green();
+        b = parsed.blue();
+        color_alpha = parsed.alpha() / 255.0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: colore non valido per la mappa di probabilità: " << color
+                  << " (" << e.what() << ")" << std::endl;
+        rgba.clear();
+        return false;
+    }
+
+    const std::size_t count = raster.probability.size();
+    const float alpha_scale =
+        static_cast<float>(std::max(0.0, std::min(1.0, max_alpha)) * color_alpha * 255.0);
+    rgba.resize(count * 4);
+    for (std::size_t i = 0; i < count; ++i) {
+        rgba[i * 4 + 0] = r;
+        rgba[i * 4 + 1] = g;
+        rgba[i * 4 + 2] = b;
+        rgba[i * 4 + 3] = static_cast<std::uint8_t>(raster.probability[i] * alpha_scale + 0.5f);
+    }
+    return true;
+}
+
+} // namespace ioc_earth
@@ -1,14 +1,66 @@
 #include "SkyMapRenderer.h"
 #include "MapPathRenderer.h"
+#include "StarCatalogTransform.h"
 #include <iostream>
 #include <cmath>
 #include <algorithm>
 
 namespace ioc_earth {
 
+namespace {
+
+// Passo di campionamento delle curve di griglia, confini e asterismi (gradi)
+constexpr double kGridSampleDegrees = 1.0;
+constexpr double kBoundarySampleDegrees = 1.0;
+
+// Gruppi di layer, nell'ordine di disegno
+enum SkyLayerGroupBit : unsigned int {
+    kSkyGroupGrid = 1u << 0,
+    kSkyGroupConstellations = 1u << 1,
+    kSkyGroupStars = 1u << 2,
+    kSkyGroupTarget = 1u << 3
+};
+constexpr unsigned int kAllSkyGroups = (1u << 4) - 1;
+const char* const kSkyGroupNames[] = {"grid", "constellations", "stars", "target"};
+
+// Disegna i tratti proiettabili di una polilinea proiettata
+void addProjectedPath(MapPathRenderer& renderer, const ProjectedPath& path,
+                      const std::string& color, double width) {
+    SkyProjection::forEachVisibleRun(path.visible.data(), path.size(),
+        [&](std::size_t first, std::size_t count) {
+            renderer.addGPSPath(CoordinateView(path.x.data() + first, path.y.data() + first, count),
+                                color, width);
+        });
+}
+
+} // namespace
+
 class SkyMapRenderer::Impl {
 public:
+    /**
+     * @brief Dati e stile dell'ultima costruzione dei layer
+     */
+    struct BuiltState {
+        bool valid = false;
+        double center_ra = 0.0;
+        double center_dec = 0.0;
+        double field_of_view = 0.0;
+        double mag_limit = 0.0;
+        double observation_epoch_jd = 0.0;
+        StarCatalogPtr stars;
+        ConstellationLinesPtr constellation_lines;
+        ConstellationBoundariesPtr constellation_boundaries;
+        std::shared_ptr<const TargetData> target;
+        SkyMapStyle style;
+        bool has_finder_chart_bounds = false;
+        double finder_chart_ra = 0.0;
+        double finder_chart_dec = 0.0;
+        double finder_chart_fov = 0.0;
+    };
+    
     std::unique_ptr<MapPathRenderer> renderer;
+    BuiltState built;
+    std::size_t visible_star_count = 0;
     
     Impl(unsigned int w, unsigned int h) {
         renderer = std::make_unique<MapPathRenderer>(w, h);
@@ -23,7 +75,10 @@ SkyMapRenderer::SkyMapRenderer(unsigned int width, unsigned int height)
     , center_dec_(0.0)
     , field_of_view_(60.0)
     , mag_limit_(12.0)
-    , target_{"", 0.0, 0.0, 0.0, {}, {}} {
+    , stars_(std::make_shared<const std::vector<StarData>>())
+    , constellation_lines_(std::make_shared<const std::vector<ConstellationLineData>>())
+    , constellation_boundaries_(std::make_shared<const std::vector<ConstellationBoundaryData>>())
+    , target_(std::make_shared<const TargetData>(TargetData{"", 0.0, 0.0, 0.0, {}, {}})) {
 }
 
 SkyMapRenderer::~SkyMapRenderer() = default;
@@ -45,26 +100,69 @@ void SkyMapRenderer::setMagnitudeLimit(double mag_limit) {
 }
 
 void SkyMapRenderer::addStars(const std::vector<StarData>& stars) {
-    stars_ = stars;
-    std::cout << "⭐ Aggiunte " << stars_.size() << " stelle SAO" << std::endl;
+    addStars(std::make_shared<const std::vector<StarData>>(stars));
+}
+
+void SkyMapRenderer::addStars(std::vector<StarData>&& stars) {
+    addStars(std::make_shared<const std::vector<StarData>>(std::move(stars)));
+}
+
+void SkyMapRenderer::addStars(StarCatalogPtr stars) {
+    stars_ = stars ? std::move(stars) : std::make_shared<const std::vector<StarData>>();
+    std::cout << "⭐ Aggiunte " << stars_->size() << " stelle SAO" << std::endl;
 }
 
 void SkyMapRenderer::addConstellationLines(const std::vector<ConstellationLineData>& lines) {
-    constellation_lines_ = lines;
-    std::cout << "🔷 Aggiunte " << constellation_lines_.size() << " linee di costellazioni" << std::endl;
+    addConstellationLines(std::make_shared<const std::vector<ConstellationLineData>>(lines));
+}
+
+void SkyMapRenderer::addConstellationLines(std::vector<ConstellationLineData>&& lines) {
+    addConstellationLines(std::make_shared<const std::vector<ConstellationLineData>>(std::move(lines)));
+}
+
+void SkyMapRenderer::addConstellationLines(ConstellationLinesPtr lines) {
+    constellation_lines_ = lines ? std::move(lines)
+                                 : std::make_shared<const std::vector<ConstellationLineData>>();
+    std::cout << "🔷 Aggiunte " << constellation_lines_->size() << " linee di costellazioni" << std::endl;
 }
 
 void SkyMapRenderer::addConstellationBoundaries(const std::vector<ConstellationBoundaryData>& boundaries) {
-    constellation_boundaries_ = boundaries;
-    std::cout << "🔶 Aggiunti " << constellation_boundaries_.size() << " confini di costellazioni" << std::endl;
+    addConstellationBoundaries(std::make_shared<const std::vector<ConstellationBoundaryData>>(boundaries));
+}
+
+void SkyMapRenderer::addConstellationBoundaries(std::vector<ConstellationBoundaryData>&& boundaries) {
+    addConstellationBoundaries(
+        std::make_shared<const std::vector<ConstellationBoundaryData>>(std::move(boundaries)));
+}
+
+void SkyMapRenderer::addConstellationBoundaries(ConstellationBoundariesPtr boundaries) {
+    constellation_boundaries_ = boundaries ? std::move(boundaries)
+                                           : std::make_shared<const std::vector<ConstellationBoundaryData>>();
+    std::cout << "🔶 Aggiunti " << constellation_boundaries_->size() << " confini di costellazioni" << std::endl;
+}
+
+void SkyMapRenderer::setObservationEpoch(double epoch_jd) {
+    observation_epoch_jd_ = epoch_jd;
 }
 
 void SkyMapRenderer::setTarget(const TargetData& target) {
-    target_ = target;
-    std::cout << "🎯 Target impostato: " << target_.name << std::endl;
-    std::cout << "   RA: " << target_.ra_deg << "° Dec: " << target_.dec_deg << "°" << std::endl;
-    if (!target_.trajectory.empty()) {
-        std::cout << "   Traiettoria: " << target_.trajectory.size() << " punti" << std::endl;
+    setTarget(std::make_shared<const TargetData>(target));
+}
+
+void SkyMapRenderer::setTarget(TargetData&& target) {
+    setTarget(std::make_shared<const TargetData>(std::move(target)));
+}
+
+void SkyMapRenderer::setTarget(std::shared_ptr<const TargetData> target) {
+    if (!target) {
+        target_ = std::make_shared<const TargetData>(TargetData{"", 0.0, 0.0, 0.0, {}, {}});
+        return;
+    }
+    target_ = std::move(target);
+    std::cout << "🎯 Target impostato: " << target_->name << std::endl;
+    std::cout << "   RA: " << target_->ra_deg << "° Dec: " << target_->dec_deg << "°" << std::endl;
+    if (!target_->trajectory.empty()) {
+        std::cout << "   Traiettoria: " << target_->trajectory.size() << " punti" << std::endl;
     }
 }
 
@@ -82,166 +180,304 @@ void SkyMapRenderer::setStyle(const SkyMapStyle& style) {
     style_ = style;
 }
 
-bool SkyMapRenderer::renderSkyMap(const std::string& output_path) {
-    try {
-        std::cout << "\n🎨 === Rendering Mappa Celeste ===" << std::endl;
+void SkyMapRenderer::buildSkyMap(unsigned int groups) {
+    MapPathRenderer& renderer = *pImpl_->renderer;
+    
+    // Imposta sfondo bianco
+    renderer.setBackgroundColor(style_.background_color);
+    
+    // Proiezione sul piano tangente centrata sul campo
+    const SkyProjection projection(center_ra_, center_dec_, style_.projection);
+    double half_fov = field_of_view_ / 2.0;
+    double half_plane = projection.planeRadius(half_fov);
+    double aspect = static_cast<double>(width_) / static_cast<double>(height_);
+    double half_width = aspect >= 1.0 ? half_plane * aspect : half_plane;
+    double half_height = aspect >= 1.0 ? half_plane : half_plane / aspect;
+    
+    // Estensione in coordinate del piano (est a sinistra, nord in alto)
+    renderer.setExtent(-half_width, -half_height, half_width, half_height);
+    
+    // Regione RA/Dec che contiene tutto il campo (angoli compresi)
+    const double field_radius = half_fov * std::hypot(half_width, half_height) /
+                                std::min(half_width, half_height);
+    const SkyBox region = SkyBox::around(center_ra_, center_dec_, field_radius);
+    
+    ProjectedPath path;
+    
+    // Ogni gruppo viene registrato anche se invariato, per fissarne l'ordine
+    renderer.beginLayerGroup(kSkyGroupNames[0]);
+    if (groups & kSkyGroupGrid) {
+        renderer.clearLayerGroup(kSkyGroupNames[0]);
+    }
+    
+    // Renderizza griglia di coordinate RA/Dec (curve sul piano)
+    if ((groups & kSkyGroupGrid) && style_.show_grid) {
+        std::cout << "📏 Rendering griglia di coordinate RA/Dec..." << std::endl;
         
-        // Imposta sfondo bianco
-        pImpl_->renderer->setBackgroundColor(style_.background_color);
+        double step = style_.grid_step_degrees;
+        double min_ra = region.min_ra;
+        double max_ra = region.wrapsRA() ? region.max_ra + 360.0 : region.max_ra;
+        double sample = std::min(step, kGridSampleDegrees);
         
-        // Imposta estensione mappa (RA/Dec)
-        double half_fov = field_of_view_ / 2.0;
-        pImpl_->renderer->setExtent(
-            center_ra_ - half_fov,
-            center_dec_ - half_fov,
-            center_ra_ + half_fov,
-            center_dec_ + half_fov
-        );
+        // Meridiani (AR costante)
+        double ra_start = std::ceil(min_ra / step) * step;
+        for (double ra = ra_start; ra <= max_ra && ra < min_ra + 360.0; ra += step) {
+            projection.projectMeridian(ra, region.min_dec, region.max_dec, sample, path);
+            addProjectedPath(renderer, path, style_.grid_color, style_.grid_line_width);
+        }
         
-        // Renderizza griglia di coordinate RA/Dec (linee tratteggiate)
-        if (style_.show_grid) {
-            std::cout << "📏 Rendering griglia di coordinate RA/Dec..." << std::endl;
-            
-            double step = style_.grid_step_degrees;
-            double min_ra = center_ra_ - half_fov;
-            double max_ra = center_ra_ + half_fov;
-            double min_dec = center_dec_ - half_fov;
-            double max_dec = center_dec_ + half_fov;
-            
-            // Linee verticali di AR (Right Ascension)
-            double ra_start = std::floor(min_ra / step) * step;
-            for (double ra = ra_start; ra <= max_ra; ra += step) {
-                if (ra >= min_ra && ra <= max_ra) {
-                    std::vector<GPSPoint> ra_line;
-                    ra_line.emplace_back(ra, min_dec, "");
-                    ra_line.emplace_back(ra, max_dec, "");
-                    pImpl_->renderer->addGPSPath(ra_line, style_.grid_color, 
-                                                 style_.grid_line_width);
-                }
-            }
+        // Paralleli (Dec costante)
+        double dec_start = std::ceil(region.min_dec / step) * step;
+        for (double dec = dec_start; dec <= region.max_dec; dec += step) {
+            if (std::abs(dec) >= 90.0) continue;
+            projection.projectParallel(dec, min_ra, max_ra, sample, path);
+            addProjectedPath(renderer, path, style_.grid_color, style_.grid_line_width);
+        }
+    }
+    
+    renderer.beginLayerGroup(kSkyGroupNames[1]);
+    if (groups & kSkyGroupConstellations) {
+        renderer.clearLayerGroup(kSkyGroupNames[1]);
+    }
+    
+    // Renderizza confini costellazioni
+    if ((groups & kSkyGroupConstellations) && style_.show_constellation_boundaries) {
+        std::cout << "📍 Rendering confini costellazioni..." << std::endl;
+        for (const auto& boundary : *constellation_boundaries_) {
+            if (boundary.points.size() < 2) continue;
             
-            // Linee orizzontali di DEC (Declinazione)
-            double dec_start = std::floor(min_dec / step) * step;
-            for (double dec = dec_start; dec <= max_dec; dec += step) {
-                if (dec >= min_dec && dec <= max_dec) {
-                    std::vector<GPSPoint> dec_line;
-                    dec_line.emplace_back(min_ra, dec, "");
-                    dec_line.emplace_back(max_ra, dec, "");
-                    pImpl_->renderer->addGPSPath(dec_line, style_.grid_color, 
-                                                 style_.grid_line_width);
-                }
-            }
+            projection.projectPolyline(&boundary.points[0].first, &boundary.points[0].second,
+                                       boundary.points.size(),
+                                       sizeof(boundary.points[0]),
+                                       kBoundarySampleDegrees, path);
+            addProjectedPath(renderer, path, style_.constellation_boundary_color,
+                             style_.constellation_boundary_width);
         }
-        
-        // Renderizza confini costellazioni
-        if (style_.show_constellation_boundaries) {
-            std::cout << "📍 Rendering confini costellazioni..." << std::endl;
-            for (const auto& boundary : constellation_boundaries_) {
-                if (boundary.points.size() < 2) continue;
-                
-                std::vector<GPSPoint> path;
-                for (const auto& point : boundary.points) {
-                    path.emplace_back(point.first, point.second, "");
-                }
-                
-                pImpl_->renderer->addGPSPath(path, style_.constellation_boundary_color, 
-                                             style_.constellation_boundary_width);
-            }
+    }
+    
+    // Renderizza linee costellazioni (archi di cerchio massimo, curvi in stereografica)
+    if ((groups & kSkyGroupConstellations) && style_.show_constellation_lines) {
+        std::cout << "📐 Rendering linee costellazioni..." << std::endl;
+        for (const auto& line : *constellation_lines_) {
+            projection.projectGreatCircle(line.ra1_deg, line.dec1_deg, line.ra2_deg, line.dec2_deg,
+                                          kBoundarySampleDegrees, path);
+            addProjectedPath(renderer, path, style_.constellation_line_color,
+                             style_.constellation_line_width);
         }
+    }
+    
+    renderer.beginLayerGroup(kSkyGroupNames[2]);
+    if (groups & kSkyGroupStars) {
+        renderer.clearLayerGroup(kSkyGroupNames[2]);
         
-        // Renderizza linee costellazioni
-        if (style_.show_constellation_lines) {
-            std::cout << "📐 Rendering linee costellazioni..." << std::endl;
-            for (const auto& line : constellation_lines_) {
-                std::vector<GPSPoint> path;
-                path.emplace_back(line.ra1_deg, line.dec1_deg, "");
-                path.emplace_back(line.ra2_deg, line.dec2_deg, "");
-                
-                pImpl_->renderer->addGPSPath(path, style_.constellation_line_color,
-                                             style_.constellation_line_width);
-            }
+        // Renderizza stelle SAO: proiezione in blocco e selezione sul piano
+        std::cout << "⭐ Rendering stelle SAO..." << std::endl;
+        std::vector<std::size_t> visible_stars;
+        std::vector<std::string> star_labels;
+        // Posizioni all'epoca dell'evento (calcolate una volta per epoca). Solo
+        // moto proprio: centro, target e costellazioni restano nell'equinozio J2000
+        StarCatalogTransform::Options epoch_options;
+        epoch_options.precession = false;
+        const StarCatalogPtr stars = observation_epoch_jd_ > 0.0
+            ? StarCatalogTransform::shared().apply(stars_, observation_epoch_jd_, epoch_options)
+            : stars_;
+        std::vector<double> star_x(stars->size());
+        std::vector<double> star_y(stars->size());
+        std::vector<std::uint8_t> star_projected(stars->size());
+        if (!stars->empty()) {
+            projection.projectBatch(&stars->front().ra_deg, &stars->front().dec_deg,
+                                    stars->size(), sizeof(StarData),
+                                    star_x.data(), star_y.data(), star_projected.data());
         }
+        std::vector<std::size_t> in_field;
+        SkyProjection::cullToRect(star_x.data(), star_y.data(), star_projected.data(),
+                                  stars->size(), half_width, half_height, in_field);
         
-        // Renderizza stelle SAO
-        std::cout << "⭐ Rendering stelle SAO..." << std::endl;
-        std::vector<GPSPoint> star_points;
-        for (const auto& star : stars_) {
+        for (std::size_t i : in_field) {
+            const auto& star = (*stars)[i];
             if (star.magnitude > mag_limit_) continue;
             
-            // Controlla se la stella è nel campo visivo
-            if (std::abs(star.ra_deg - center_ra_) > half_fov) continue;
-            if (std::abs(star.dec_deg - center_dec_) > half_fov) continue;
-            
-            std::string label;
+            visible_stars.push_back(i);
             if (style_.show_star_labels) {
-                label = "SAO " + std::to_string(star.sao_number);
+                std::string label = "SAO " + std::to_string(star.sao_number);
                 
                 // Aggiungi lettera di Flamsteed se disponibile
                 if (style_.show_flamsteed_letters && !star.flamsteed_letter.empty()) {
                     label = star.flamsteed_letter + " " + star.constellation + "\n" + label;
                 }
+                star_labels.push_back(std::move(label));
             }
-            
-            star_points.emplace_back(star.ra_deg, star.dec_deg, label);
         }
         
-        if (!star_points.empty()) {
-            pImpl_->renderer->addPointLabels(star_points, "star", style_.label_font_size);
+        if (!visible_stars.empty()) {
+            CoordinateView star_view(star_x.data(), star_y.data(), star_x.size());
+            star_view.withIndices(visible_stars.data(), visible_stars.size());
+            if (!star_labels.empty()) {
+                star_view.withPositionLabels(star_labels.data());
+            }
+            // Le stelle più brillanti vincono le collisioni tra etichette
+            LabelOptions options;
+            options.font = style_.label_font;
+            options.color = style_.star_label_color;
+            options.priorities.reserve(visible_stars.size());
+            for (std::size_t i : visible_stars) {
+                options.priorities.push_back(-(*stars)[i].magnitude);
+            }
+            renderer.addPointLabels(star_view, "star", style_.label_font_size, options);
         }
-        std::cout << "   Stelle visualizzate: " << star_points.size() << std::endl;
+        pImpl_->visible_star_count = visible_stars.size();
+        std::cout << "   Stelle visualizzate: " << visible_stars.size() << std::endl;
+    }
+    
+    renderer.beginLayerGroup(kSkyGroupNames[3]);
+    if (groups & kSkyGroupTarget) {
+        renderer.clearLayerGroup(kSkyGroupNames[3]);
+    }
+    
+    // Renderizza target e traiettoria
+    if ((groups & kSkyGroupTarget) && !target_->name.empty()) {
+        std::cout << "🎯 Rendering target e traiettoria..." << std::endl;
         
-        // Renderizza target e traiettoria
-        if (!target_.name.empty()) {
-            std::cout << "🎯 Rendering target e traiettoria..." << std::endl;
-            
-            // Traiettoria
-            if (!target_.trajectory.empty()) {
-                std::vector<GPSPoint> trajectory;
-                for (size_t i = 0; i < target_.trajectory.size(); ++i) {
-                    std::string label = i < target_.trajectory_timestamps.size() ? 
-                                       target_.trajectory_timestamps[i] : "";
-                    trajectory.emplace_back(target_.trajectory[i].first,
-                                           target_.trajectory[i].second,
-                                           label);
-                }
-                
-                pImpl_->renderer->addGPSPath(trajectory, style_.trajectory_color, 
-                                             style_.trajectory_line_width);
-            }
-            
-            // Target
-            std::vector<GPSPoint> target_point;
-            target_point.emplace_back(target_.ra_deg, target_.dec_deg, target_.name);
-            pImpl_->renderer->addPointLabels(target_point, "target", style_.label_font_size + 2);
+        // Traiettoria
+        if (!target_->trajectory.empty()) {
+            const auto& trajectory = target_->trajectory;
+            projection.projectPolyline(&trajectory[0].first, &trajectory[0].second,
+                                       trajectory.size(), sizeof(trajectory[0]), 0.0, path);
+            addProjectedPath(renderer, path, style_.trajectory_color,
+                             style_.trajectory_line_width);
         }
         
-        // Renderizza rettangolo FOV del finder chart se impostato
-        if (has_finder_chart_bounds_) {
-            std::cout << "📦 Rendering rettangolo FOV finder chart (tratteggiato)..." << std::endl;
-            
-            double half_fc_fov = finder_chart_fov_ / 2.0;
-            
-            // Creiamo un rettangolo come 4 linee
-            std::vector<std::pair<double, double>> rect_points = {
-                {finder_chart_ra_ - half_fc_fov, finder_chart_dec_ - half_fc_fov},
-                {finder_chart_ra_ + half_fc_fov, finder_chart_dec_ - half_fc_fov},
-                {finder_chart_ra_ + half_fc_fov, finder_chart_dec_ + half_fc_fov},
-                {finder_chart_ra_ - half_fc_fov, finder_chart_dec_ + half_fc_fov},
-                {finder_chart_ra_ - half_fc_fov, finder_chart_dec_ - half_fc_fov}
-            };
-            
-            std::vector<GPSPoint> rect_path;
-            for (const auto& pt : rect_points) {
-                rect_path.emplace_back(pt.first, pt.second, "");
+        // Target
+        double target_x = 0.0, target_y = 0.0;
+        if (projection.project(target_->ra_deg, target_->dec_deg, target_x, target_y)) {
+            CoordinateView target_point(&target_x, &target_y, 1);
+            target_point.withLabels(&target_->name);
+            LabelOptions options;
+            options.font = style_.label_font;
+            options.color = style_.target_color;
+            options.priority = 1000.0;
+            renderer.addPointLabels(target_point, "target", style_.label_font_size + 2, options);
+        }
+    }
+    
+    // Renderizza rettangolo FOV del finder chart se impostato
+    if ((groups & kSkyGroupTarget) && has_finder_chart_bounds_) {
+        std::cout << "📦 Rendering rettangolo FOV finder chart (tratteggiato)..." << std::endl;
+        
+        // Il rettangolo è quadrato nel piano gnomonico del finder chart:
+        // i lati vengono campionati, riportati in RA/Dec e riproiettati
+        const SkyProjection finder(finder_chart_ra_, finder_chart_dec_,
+                                   SkyProjectionType::Gnomonic);
+        const double h = finder.planeRadius(finder_chart_fov_ / 2.0);
+        const double corners[5][2] = {{-h, -h}, {h, -h}, {h, h}, {-h, h}, {-h, -h}};
+        const int samples_per_side = 8;
+        
+        std::vector<double> rect_ra, rect_dec;
+        for (int side = 0; side < 4; ++side) {
+            for (int k = 0; k < samples_per_side; ++k) {
+                const double t = static_cast<double>(k) / samples_per_side;
+                double ra = 0.0, dec = 0.0;
+                finder.unproject(corners[side][0] + (corners[side + 1][0] - corners[side][0]) * t,
+                                 corners[side][1] + (corners[side + 1][1] - corners[side][1]) * t,
+                                 ra, dec);
+                rect_ra.push_back(ra);
+                rect_dec.push_back(dec);
             }
-            
-            pImpl_->renderer->addGPSPath(rect_path, style_.fov_rect_color, 
-                                         style_.fov_rect_line_width);
         }
+        rect_ra.push_back(rect_ra.front());
+        rect_dec.push_back(rect_dec.front());
+        
+        projection.projectPolyline(rect_ra.data(), rect_dec.data(), rect_ra.size(),
+                                   sizeof(double), 0.0, path);
+        addProjectedPath(renderer, path, style_.fov_rect_color,
+                         style_.fov_rect_line_width);
+    }
+    
+    // Riferimento per il confronto del prossimo rendering incrementale
+    Impl::BuiltState& built = pImpl_->built;
+    built.valid = true;
+    built.center_ra = center_ra_;
+    built.center_dec = center_dec_;
+    built.field_of_view = field_of_view_;
+    built.mag_limit = mag_limit_;
+    built.observation_epoch_jd = observation_epoch_jd_;
+    built.stars = stars_;
+    built.constellation_lines = constellation_lines_;
+    built.constellation_boundaries = constellation_boundaries_;
+    built.target = target_;
+    built.style = style_;
+    built.has_finder_chart_bounds = has_finder_chart_bounds_;
+    built.finder_chart_ra = finder_chart_ra_;
+    built.finder_chart_dec = finder_chart_dec_;
+    built.finder_chart_fov = finder_chart_fov_;
+}
+
+unsigned int SkyMapRenderer::changedLayerGroups() const {
+    const Impl::BuiltState& built = pImpl_->built;
+    const SkyMapStyle& old_style = built.style;
+    
+    // Nuovo campo o nuova proiezione: cambiano tutte le geometrie
+    if (!built.valid || built.center_ra != center_ra_ || built.center_dec != center_dec_ ||
+        built.field_of_view != field_of_view_ || old_style.projection != style_.projection) {
+        return kAllSkyGroups;
+    }
+    
+    // Lo sfondo non tocca nessun gruppo: basta ricomporre
+    unsigned int groups = 0;
+    if (old_style.show_grid != style_.show_grid || old_style.grid_color != style_.grid_color ||
+        old_style.grid_line_width != style_.grid_line_width ||
+        old_style.grid_step_degrees != style_.grid_step_degrees ||
+        old_style.grid_dashed != style_.grid_dashed) {
+        groups |= kSkyGroupGrid;
+    }
+    if (built.constellation_lines != constellation_lines_ ||
+        built.constellation_boundaries != constellation_boundaries_ ||
+        old_style.constellation_line_color != style_.constellation_line_color ||
+        old_style.constellation_boundary_color != style_.constellation_boundary_color ||
+        old_style.constellation_line_width != style_.constellation_line_width ||
+        old_style.constellation_boundary_width != style_.constellation_boundary_width ||
+        old_style.show_constellation_lines != style_.show_constellation_lines ||
+        old_style.show_constellation_boundaries != style_.show_constellation_boundaries ||
+        old_style.show_constellation_names != style_.show_constellation_names) {
+        groups |= kSkyGroupConstellations;
+    }
+    if (built.stars != stars_ || built.mag_limit != mag_limit_ ||
+        built.observation_epoch_jd != observation_epoch_jd_ ||
+        old_style.star_color != style_.star_color ||
+        old_style.star_label_color != style_.star_label_color ||
+        old_style.star_base_size != style_.star_base_size ||
+        old_style.show_star_labels != style_.show_star_labels ||
+        old_style.show_flamsteed_letters != style_.show_flamsteed_letters ||
+        old_style.show_magnitude_scale != style_.show_magnitude_scale) {
+        groups |= kSkyGroupStars;
+    }
+    if (built.target != target_ || built.has_finder_chart_bounds != has_finder_chart_bounds_ ||
+        (has_finder_chart_bounds_ && (built.finder_chart_ra != finder_chart_ra_ ||
+                                      built.finder_chart_dec != finder_chart_dec_ ||
+                                      built.finder_chart_fov != finder_chart_fov_)) ||
+        old_style.target_color != style_.target_color ||
+        old_style.trajectory_color != style_.trajectory_color ||
+        old_style.fov_rect_color != style_.fov_rect_color ||
+        old_style.target_size != style_.target_size ||
+        old_style.trajectory_line_width != style_.trajectory_line_width ||
+        old_style.fov_rect_line_width != style_.fov_rect_line_width) {
+        groups |= kSkyGroupTarget;
+    }
+    // Le etichette stanno nei layer dei punti che descrivono
+    if (old_style.label_font_size != style_.label_font_size || old_style.label_font != style_.label_font) {
+        groups |= kSkyGroupStars | kSkyGroupTarget;
+    }
+    return groups;
+}
+
+bool SkyMapRenderer::renderSkyMap(const std::string& output_path, const ImageFormat& format) {
+    try {
+        std::cout << "\n🎨 === Rendering Mappa Celeste ===" << std::endl;
+        buildSkyMap(kAllSkyGroups);
         
         // Renderizza e salva
         std::cout << "💾 Salvataggio mappa..." << std::endl;
-        bool success = pImpl_->renderer->renderToFile(output_path);
+        bool success = pImpl_->renderer->renderToFile(output_path, format);
         
         if (success) {
             std::cout << "\n✅ Mappa celeste generata: " << output_path << std::endl;
@@ -249,13 +485,13 @@ bool SkyMapRenderer::renderSkyMap(const std::string& output_path) {
             std::cout << "   Centro: RA " << center_ra_ << "° Dec " << center_dec_ << "°" << std::endl;
             std::cout << "   Campo visivo: " << field_of_view_ << "°" << std::endl;
             std::cout << "   Dimensioni: " << width_ << "x" << height_ << " px" << std::endl;
-            std::cout << "   Stelle visualizzate: " << star_points.size() << std::endl;
+            std::cout << "   Stelle visualizzate: " << pImpl_->visible_star_count << std::endl;
             std::cout << "   Magnitudine limite: " << mag_limit_ << std::endl;
-            std::cout << "   Linee costellazioni: " << constellation_lines_.size() << std::endl;
-            std::cout << "   Confini costellazioni: " << constellation_boundaries_.size() << std::endl;
+            std::cout << "   Linee costellazioni: " << constellation_lines_->size() << std::endl;
+            std::cout << "   Confini costellazioni: " << constellation_boundaries_->size() << std::endl;
             std::cout << "   Griglia RA/Dec: ogni " << style_.grid_step_degrees << "°" << std::endl;
-            if (!target_.name.empty()) {
-                std::cout << "   Target: " << target_.name << std::endl;
+            if (!target_->name.empty()) {
+                std::cout << "   Target: " << target_->name << std::endl;
             }
             if (has_finder_chart_bounds_) {
                 std::cout << "   ✓ Rettangolo FOV finder chart visibile" << std::endl;
@@ -270,6 +506,18 @@ bool SkyMapRenderer::renderSkyMap(const std::string& output_path) {
     }
 }
 
+bool SkyMapRenderer::renderSkyMapIncremental(std::vector<uint8_t>& data, const ImageFormat& format) {
+    try {
+        // Solo i gruppi cambiati vengono ricostruiti; sfondo ed estensione
+        // vengono sempre reimpostati (la cache li confronta da sola)
+        buildSkyMap(changedLayerGroups());
+        return pImpl_->renderer->renderLayerGroups(data, format);
+    } catch (const std::exception& e) {
+        std::cerr << "❌ Errore nel rendering: " << e.what() << std::endl;
+        return false;
+    }
+}
+
 std::vector<uint8_t> SkyMapRenderer::getLastRenderedBuffer() const {
     return last_rendered_buffer_;
 }
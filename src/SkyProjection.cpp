@@ -0,0 +1,286 @@
+#include "SkyProjection.h"
+#include <cmath>
+#include <algorithm>
+
+namespace ioc_earth {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kDegToRad = kPi / 180.0;
+constexpr double kRadToDeg = 180.0 / kPi;
+
+// Dimensione dei blocchi per le conversioni RA/Dec -> vettori unitari
+constexpr std::size_t kBlockSize = 256;
+
+// Sotto questa soglia di cos(c) il punto è considerato non proiettabile
+constexpr double kGnomonicMinCos = 1.0e-6;
+constexpr double kStereographicMinCos = -1.0 + 1.0e-6;
+
+inline double strided(const double* base, std::size_t index, std::size_t stride_bytes) {
+    return *reinterpret_cast<const double*>(reinterpret_cast<const char*>(base) +
+                                            index * stride_bytes);
+}
+
+double normalizeRA(double ra) {
+    ra = std::fmod(ra, 360.0);
+    return ra < 0.0 ? ra + 360.0 : ra;
+}
+
+} // namespace
+
+SkyBox SkyBox::around(double center_ra_deg, double center_dec_deg, double radius_deg) {
+    double min_dec = std::max(-90.0, center_dec_deg - radius_deg);
+    double max_dec = std::min(90.0, center_dec_deg + radius_deg);
+    if (min_dec <= -90.0 || max_dec >= 90.0) {
+        return SkyBox{0.0, 360.0, min_dec, max_dec};
+    }
+
+    // Semi-ampiezza in RA alla declinazione più lontana dall'equatore
+    double extreme_dec = std::max(std::abs(min_dec), std::abs(max_dec)) * kDegToRad;
+    double half_ra = radius_deg / std::cos(extreme_dec);
+    if (half_ra >= 180.0) {
+        return SkyBox{0.0, 360.0, min_dec, max_dec};
+    }
+    return SkyBox{normalizeRA(center_ra_deg - half_ra), normalizeRA(center_ra_deg + half_ra),
+                  min_dec, max_dec};
+}
+
+SkyProjection::SkyProjection(double center_ra_deg, double center_dec_deg, SkyProjectionType type)
+    : center_ra_(center_ra_deg), center_dec_(center_dec_deg), type_(type) {
+    const double a0 = center_ra_deg * kDegToRad;
+    const double d0 = center_dec_deg * kDegToRad;
+    const double sa = std::sin(a0), ca = std::cos(a0);
+    const double sd = std::sin(d0), cd = std::cos(d0);
+
+    cx_ = cd * ca;  cy_ = cd * sa;  cz_ = sd;
+    ex_ = -sa;      ey_ = ca;       ez_ = 0.0;
+    nx_ = -sd * ca; ny_ = -sd * sa; nz_ = cd;
+}
+
+bool SkyProjection::project(double ra_deg, double dec_deg, double& x, double& y) const {
+    std::uint8_t visible = 0;
+    projectBatch(&ra_deg, &dec_deg, 1, sizeof(double), &x, &y, &visible);
+    return visible != 0;
+}
+
+double SkyProjection::planeRadius(double angular_deg) const {
+    const double c = angular_deg * kDegToRad;
+    if (type_ == SkyProjectionType::Gnomonic) {
+        return std::tan(std::min(c, kPi / 2.0 - 1.0e-6)) * kRadToDeg;
+    }
+    return 2.0 * std::tan(std::min(c, kPi - 1.0e-6) / 2.0) * kRadToDeg;
+}
+
+bool SkyProjection::unproject(double x, double y, double& ra_deg, double& dec_deg) const {
+    // Coordinate standard (ξ verso est, η verso nord) in radianti
+    const double xi = -x * kDegToRad;
+    const double eta = y * kDegToRad;
+
+    double px, py, pz;
+    if (type_ == SkyProjectionType::Gnomonic) {
+        // p ∝ c + ξ e + η n
+        px = cx_ + xi * ex_ + eta * nx_;
+        py = cy_ + xi * ey_ + eta * ny_;
+        pz = cz_ + xi * ez_ + eta * nz_;
+    } else {
+        // Inversione stereografica: ρ = 2 tan(c/2)
+        const double rho2 = xi * xi + eta * eta;
+        const double cos_c = (4.0 - rho2) / (4.0 + rho2);
+        const double k = (1.0 + cos_c) / 2.0;
+        px = cos_c * cx_ + k * (xi * ex_ + eta * nx_);
+        py = cos_c * cy_ + k * (xi * ey_ + eta * ny_);
+        pz = cos_c * cz_ + k * (xi * ez_ + eta * nz_);
+    }
+
+    const double norm = std::sqrt(px * px + py * py + pz * pz);
+    if (!(norm > 0.0)) {
+        return false;
+    }
+    ra_deg = std::atan2(py, px) * kRadToDeg;
+    if (ra_deg < 0.0) ra_deg += 360.0;
+    dec_deg = std::asin(std::max(-1.0, std::min(1.0, pz / norm))) * kRadToDeg;
+    return true;
+}
+
+void SkyProjection::projectBatch(const double* ra_deg, const double* dec_deg, std::size_t count,
+                                 std::size_t stride_bytes, double* x, double* y,
+                                 std::uint8_t* visible) const {
+    double ux[kBlockSize], uy[kBlockSize], uz[kBlockSize];
+
+    for (std::size_t base = 0; base < count; base += kBlockSize) {
+        const std::size_t n = std::min(kBlockSize, count - base);
+
+        // Conversione a vettori unitari per blocco (l'unica parte con trigonometria)
+        for (std::size_t i = 0; i < n; ++i) {
+            const double a = strided(ra_deg, base + i, stride_bytes) * kDegToRad;
+            const double d = strided(dec_deg, base + i, stride_bytes) * kDegToRad;
+            const double cd = std::cos(d);
+            ux[i] = cd * std::cos(a);
+            uy[i] = cd * std::sin(a);
+            uz[i] = std::sin(d);
+        }
+
+        projectUnitVectors(ux, uy, uz, n, x + base, y + base,
+                           visible ? visible + base : nullptr);
+    }
+}
+
+void SkyProjection::projectUnitVectors(const double* ux, const double* uy, const double* uz,
+                                       std::size_t count, double* x, double* y,
+                                       std::uint8_t* visible) const {
+    const double cx = cx_, cy = cy_, cz = cz_;
+    const double ex = ex_, ey = ey_, ez = ez_;
+    const double nx = nx_, ny = ny_, nz = nz_;
+
+    if (type_ == SkyProjectionType::Gnomonic) {
+        for (std::size_t i = 0; i < count; ++i) {
+            const double cos_c = ux[i] * cx + uy[i] * cy + uz[i] * cz;
+            const double ok = cos_c > kGnomonicMinCos ? 1.0 : 0.0;
+            // Evita la divisione per valori prossimi a zero senza salti
+            const double inv = ok * kRadToDeg / (cos_c * ok + (1.0 - ok));
+            x[i] = -(ux[i] * ex + uy[i] * ey + uz[i] * ez) * inv;
+            y[i] = (ux[i] * nx + uy[i] * ny + uz[i] * nz) * inv;
+            if (visible) visible[i] = static_cast<std::uint8_t>(ok);
+        }
+    } else {
+        for (std::size_t i = 0; i < count; ++i) {
+            const double cos_c = ux[i] * cx + uy[i] * cy + uz[i] * cz;
+            const double ok = cos_c > kStereographicMinCos ? 1.0 : 0.0;
+            const double k = ok * 2.0 * kRadToDeg / ((1.0 + cos_c) * ok + (1.0 - ok));
+            x[i] = -(ux[i] * ex + uy[i] * ey + uz[i] * ez) * k;
+            y[i] = (ux[i] * nx + uy[i] * ny + uz[i] * nz) * k;
+            if (visible) visible[i] = static_cast<std::uint8_t>(ok);
+        }
+    }
+}
+
+void SkyProjection::projectPolyline(const double* ra_deg, const double* dec_deg, std::size_t count,
+                                    std::size_t stride_bytes, double max_step_deg,
+                                    ProjectedPath& out) const {
+    out.clear();
+    if (count == 0) {
+        return;
+    }
+
+    // Campionamento dei lati in RA/Dec; le coordinate campionate vengono
+    // scritte temporaneamente in x/y e proiettate in un solo passaggio
+    std::vector<double>& ra = out.x;
+    std::vector<double>& dec = out.y;
+    ra.reserve(count);
+    dec.reserve(count);
+    double prev_ra = strided(ra_deg, 0, stride_bytes);
+    double prev_dec = strided(dec_deg, 0, stride_bytes);
+    ra.push_back(prev_ra);
+    dec.push_back(prev_dec);
+
+    for (std::size_t i = 1; i < count; ++i) {
+        const double cur_ra = strided(ra_deg, i, stride_bytes);
+        const double cur_dec = strided(dec_deg, i, stride_bytes);
+        double d_ra = std::remainder(cur_ra - prev_ra, 360.0);
+        const double d_dec = cur_dec - prev_dec;
+
+        std::size_t steps = 1;
+        if (max_step_deg > 0.0) {
+            const double span = std::max(std::abs(d_ra), std::abs(d_dec));
+            steps = std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(span / max_step_deg)));
+        }
+        for (std::size_t k = 1; k <= steps; ++k) {
+            const double t = static_cast<double>(k) / static_cast<double>(steps);
+            ra.push_back(prev_ra + d_ra * t);
+            dec.push_back(prev_dec + d_dec * t);
+        }
+        prev_ra = cur_ra;
+        prev_dec = cur_dec;
+    }
+
+    const std::size_t n = ra.size();
+    std::vector<double> plane_x(n);
+    out.visible.resize(n);
+    // projectBatch legge a blocchi: y può essere scritto sopra dec in place
+    projectBatch(ra.data(), dec.data(), n, sizeof(double), plane_x.data(), dec.data(),
+                 out.visible.data());
+    out.x.swap(plane_x);
+}
+
+void SkyProjection::projectGreatCircle(double ra1_deg, double dec1_deg, double ra2_deg,
+                                       double dec2_deg, double max_step_deg,
+                                       ProjectedPath& out) const {
+    double a[3], b[3];
+    const double ends[2][2] = {{ra1_deg, dec1_deg}, {ra2_deg, dec2_deg}};
+    double* vectors[2] = {a, b};
+    for (int e = 0; e < 2; ++e) {
+        const double ra = ends[e][0] * kDegToRad;
+        const double dec = ends[e][1] * kDegToRad;
+        vectors[e][0] = std::cos(dec) * std::cos(ra);
+        vectors[e][1] = std::cos(dec) * std::sin(ra);
+        vectors[e][2] = std::sin(dec);
+    }
+
+    // Angolo tra gli estremi; estremi coincidenti o antipodali restano un segmento
+    const double cross_x = a[1] * b[2] - a[2] * b[1];
+    const double cross_y = a[2] * b[0] - a[0] * b[2];
+    const double cross_z = a[0] * b[1] - a[1] * b[0];
+    const double sin_angle = std::sqrt(cross_x * cross_x + cross_y * cross_y + cross_z * cross_z);
+    const double angle = std::atan2(sin_angle, a[0] * b[0] + a[1] * b[1] + a[2] * b[2]);
+
+    std::size_t steps = 1;
+    if (type_ != SkyProjectionType::Gnomonic && max_step_deg > 0.0 && sin_angle > 1.0e-9) {
+        steps = std::max<std::size_t>(
+            1, static_cast<std::size_t>(std::ceil(angle * kRadToDeg / max_step_deg)));
+    }
+
+    // Interpolazione sferica lineare tra i vettori unitari
+    std::vector<double> ux(steps + 1), uy(steps + 1), uz(steps + 1);
+    for (std::size_t k = 0; k <= steps; ++k) {
+        const double t = static_cast<double>(k) / static_cast<double>(steps);
+        double wa = 1.0 - t, wb = t;
+        if (steps > 1) {
+            wa = std::sin((1.0 - t) * angle) / sin_angle;
+            wb = std::sin(t * angle) / sin_angle;
+        }
+        ux[k] = wa * a[0] + wb * b[0];
+        uy[k] = wa * a[1] + wb * b[1];
+        uz[k] = wa * a[2] + wb * b[2];
+    }
+    out.resize(steps + 1);
+    projectUnitVectors(ux.data(), uy.data(), uz.data(), steps + 1, out.x.data(), out.y.data(),
+                       out.visible.data());
+}
+
+void SkyProjection::projectMeridian(double ra_deg, double dec_from, double dec_to, double step_deg,
+                                    ProjectedPath& out) const {
+    const double ends_ra[2] = {ra_deg, ra_deg};
+    const double ends_dec[2] = {dec_from, dec_to};
+    projectPolyline(ends_ra, ends_dec, 2, sizeof(double), step_deg, out);
+}
+
+void SkyProjection::projectParallel(double dec_deg, double ra_from, double ra_to, double step_deg,
+                                    ProjectedPath& out) const {
+    // Non si usa projectPolyline: l'arco può superare 180° in RA
+    const double span = ra_to - ra_from;
+    const std::size_t steps = std::max<std::size_t>(
+        1, static_cast<std::size_t>(std::ceil(std::abs(span) / std::max(step_deg, 1.0e-3))));
+    out.resize(steps + 1);
+    std::vector<double> ra(steps + 1);
+    for (std::size_t k = 0; k <= steps; ++k) {
+        ra[k] = ra_from + span * static_cast<double>(k) / static_cast<double>(steps);
+    }
+    std::fill(out.y.begin(), out.y.end(), dec_deg);
+    projectBatch(ra.data(), out.y.data(), steps + 1, sizeof(double), out.x.data(), out.y.data(),
+                 out.visible.data());
+}
+
+void SkyProjection::cullToRect(const double* x, const double* y, const std::uint8_t* visible,
+                               std::size_t count, double half_width, double half_height,
+                               std::vector<std::size_t>& indices) {
+    for (std::size_t i = 0; i < count; ++i) {
+        const bool inside = std::abs(x[i]) <= half_width && std::abs(y[i]) <= half_height &&
+                            (visible == nullptr || visible[i] != 0);
+        if (inside) {
+            indices.push_back(i);
+        }
+    }
+}
+
+} // namespace ioc_earth
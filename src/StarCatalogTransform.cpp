@@ -0,0 +1,246 @@
+#include "StarCatalogTransform.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace ioc_earth {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kDegToRad = kPi / 180.0;
+constexpr double kRadToDeg = 180.0 / kPi;
+constexpr double kArcsecToRad = kDegToRad / 3600.0;
+constexpr double kMasToRad = kArcsecToRad / 1000.0;
+constexpr double kDaysPerJulianYear = 365.25;
+constexpr double kDaysPerJulianCentury = 36525.0;
+
+// Costante di aberrazione (secondi d'arco)
+constexpr double kAberrationConstant = 20.49552;
+
+// Dimensione dei blocchi del kernel
+constexpr std::size_t kBlockSize = 256;
+
+inline const double& strided(const double* base, std::size_t index, std::size_t stride_bytes) {
+    return *reinterpret_cast<const double*>(reinterpret_cast<const char*>(base) +
+                                            index * stride_bytes);
+}
+
+inline double& strided(double* base, std::size_t index, std::size_t stride_bytes) {
+    return *reinterpret_cast<double*>(reinterpret_cast<char*>(base) + index * stride_bytes);
+}
+
+/**
+ * Matrice di precessione da J2000 all'epoca (angoli di Lieske 1977)
+ */
+void precessionMatrix(double epoch_jd, double m[3][3]) {
+    const double t = (epoch_jd - kJulianDateJ2000) / kDaysPerJulianCentury;
+    const double zeta = (2306.2181 + (0.30188 + 0.017998 * t) * t) * t * kArcsecToRad;
+    const double z = (2306.2181 + (1.09468 + 0.018203 * t) * t) * t * kArcsecToRad;
+    const double theta = (2004.3109 - (0.42665 + 0.041833 * t) * t) * t * kArcsecToRad;
+
+    const double cz = std::cos(zeta), sz = std::sin(zeta);
+    const double cZ = std::cos(z), sZ = std::sin(z);
+    const double ct = std::cos(theta), st = std::sin(theta);
+
+    m[0][0] = cz * ct * cZ - sz * sZ;
+    m[0][1] = -sz * ct * cZ - cz * sZ;
+    m[0][2] = -st * cZ;
+    m[1][0] = cz * ct * sZ + sz * cZ;
+    m[1][1] = -sz * ct * sZ + cz * cZ;
+    m[1][2] = -st * sZ;
+    m[2][0] = cz * st;
+    m[2][1] = -sz * st;
+    m[2][2] = ct;
+}
+
+/**
+ * Velocità della Terra in unità di c (equatoriale J2000), dalla longitudine
+ * del Sole a bassa precisione (errore < 0.01° -> < 0.01" sull'aberrazione)
+ */
+void earthVelocity(double epoch_jd, double v[3]) {
+    const double d = epoch_jd - kJulianDateJ2000;
+    const double mean_longitude = (280.460 + 0.9856474 * d) * kDegToRad;
+    const double mean_anomaly = (357.528 + 0.9856003 * d) * kDegToRad;
+    const double longitude = mean_longitude + (1.915 * std::sin(mean_anomaly) +
+                                               0.020 * std::sin(2.0 * mean_anomaly)) * kDegToRad;
+    const double obliquity = (23.439 - 4.0e-7 * d) * kDegToRad;
+    const double k = kAberrationConstant * kArcsecToRad;
+
+    v[0] = k * std::sin(longitude);
+    v[1] = -k * std::cos(longitude) * std::cos(obliquity);
+    v[2] = -k * std::cos(longitude) * std::sin(obliquity);
+}
+
+template <typename Star>
+std::shared_ptr<const std::vector<Star>> transformCatalog(const std::vector<Star>& catalog,
+                                                          double epoch_jd,
+                                                          const StarCatalogTransform::Options& options) {
+    auto result = std::make_shared<std::vector<Star>>(catalog);
+    if (!result->empty()) {
+        Star& first = result->front();
+        StarCatalogTransform::transformBatch(&first.ra_deg, &first.dec_deg,
+                                             &first.pm_ra_mas_yr, &first.pm_dec_mas_yr,
+                                             result->size(), sizeof(Star), epoch_jd, options,
+                                             &first.ra_deg, &first.dec_deg);
+    }
+    return result;
+}
+
+} // namespace
+
+StarCatalogTransform::StarCatalogTransform() = default;
+
+StarCatalogTransform::StarCatalogTransform(const Options& options)
+    : options_(options) {
+}
+
+void StarCatalogTransform::setOptions(const Options& options) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    options_ = options;
+}
+
+StarCatalogTransform::Options StarCatalogTransform::getOptions() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return options_;
+}
+
+StarCatalogTransform& StarCatalogTransform::shared() {
+    static StarCatalogTransform instance;
+    return instance;
+}
+
+StarCatalogPtr StarCatalogTransform::apply(const StarCatalogPtr& catalog, double epoch_jd) {
+    return applyCached(catalog, epoch_jd, getOptions());
+}
+
+SAOCatalogPtr StarCatalogTransform::apply(const SAOCatalogPtr& catalog, double epoch_jd) {
+    return applyCached(catalog, epoch_jd, getOptions());
+}
+
+StarCatalogPtr StarCatalogTransform::apply(const StarCatalogPtr& catalog, double epoch_jd,
+                                           const Options& options) {
+    return applyCached(catalog, epoch_jd, options);
+}
+
+SAOCatalogPtr StarCatalogTransform::apply(const SAOCatalogPtr& catalog, double epoch_jd,
+                                          const Options& options) {
+    return applyCached(catalog, epoch_jd, options);
+}
+
+void StarCatalogTransform::clearCache() {
+    cache_.clear();
+}
+
+template <typename Star>
+std::shared_ptr<const std::vector<Star>> StarCatalogTransform::applyCached(
+    const std::shared_ptr<const std::vector<Star>>& catalog, double epoch_jd,
+    const Options& options) {
+    if (!catalog) {
+        return catalog;
+    }
+
+    const std::shared_ptr<const void> result =
+        cache_.getOrCompute(CacheKey(catalog, epoch_jd, options), [&] {
+            return std::shared_ptr<const void>(transformCatalog(*catalog, epoch_jd, options));
+        });
+    return std::static_pointer_cast<const std::vector<Star>>(result);
+}
+
+void StarCatalogTransform::transformBatch(const double* ra_deg, const double* dec_deg,
+                                          const double* pm_ra_mas_yr, const double* pm_dec_mas_yr,
+                                          std::size_t count, std::size_t stride_bytes,
+                                          double epoch_jd, const Options& options,
+                                          double* out_ra_deg, double* out_dec_deg) {
+    // Costanti dell'epoca, calcolate una sola volta per tutto il catalogo
+    const double years = options.proper_motion
+        ? (epoch_jd - options.catalog_epoch_jd) / kDaysPerJulianYear : 0.0;
+    const double pm_scale = years * kMasToRad;
+
+    double p[3][3] = {{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}};
+    if (options.precession) {
+        precessionMatrix(epoch_jd, p);
+    }
+    double v[3] = {0.0, 0.0, 0.0};
+    if (options.aberration) {
+        earthVelocity(epoch_jd, v);
+    }
+
+    double ux[kBlockSize], uy[kBlockSize], uz[kBlockSize];
+    double sa[kBlockSize], ca[kBlockSize], sd[kBlockSize], cd[kBlockSize];
+    double pma[kBlockSize], pmd[kBlockSize];
+
+    for (std::size_t base = 0; base < count; base += kBlockSize) {
+        const std::size_t n = std::min(kBlockSize, count - base);
+
+        // 1. Lettura e trigonometria (unica parte non lineare in ingresso)
+        for (std::size_t i = 0; i < n; ++i) {
+            const double a = strided(ra_deg, base + i, stride_bytes) * kDegToRad;
+            const double d = strided(dec_deg, base + i, stride_bytes) * kDegToRad;
+            sa[i] = std::sin(a);
+            ca[i] = std::cos(a);
+            sd[i] = std::sin(d);
+            cd[i] = std::cos(d);
+            pma[i] = strided(pm_ra_mas_yr, base + i, stride_bytes) * pm_scale;
+            pmd[i] = strided(pm_dec_mas_yr, base + i, stride_bytes) * pm_scale;
+        }
+
+        // 2. Moto proprio lungo le direzioni locali est/nord, aberrazione
+        //    e precessione: solo moltiplicazioni e somme
+        for (std::size_t i = 0; i < n; ++i) {
+            double x = cd[i] * ca[i] - pma[i] * sa[i] - pmd[i] * sd[i] * ca[i];
+            double y = cd[i] * sa[i] + pma[i] * ca[i] - pmd[i] * sd[i] * sa[i];
+            double z = sd[i] + pmd[i] * cd[i];
+
+            const double inv = 1.0 / std::sqrt(x * x + y * y + z * z);
+            x *= inv;
+            y *= inv;
+            z *= inv;
+
+            // p' = p + v - (p·v) p  (primo ordine in v/c)
+            const double pv = x * v[0] + y * v[1] + z * v[2];
+            x += v[0] - pv * x;
+            y += v[1] - pv * y;
+            z += v[2] - pv * z;
+
+            ux[i] = p[0][0] * x + p[0][1] * y + p[0][2] * z;
+            uy[i] = p[1][0] * x + p[1][1] * y + p[1][2] * z;
+            uz[i] = p[2][0] * x + p[2][1] * y + p[2][2] * z;
+        }
+
+        // 3. Ritorno a RA/Dec
+        for (std::size_t i = 0; i < n; ++i) {
+            const double r = std::sqrt(ux[i] * ux[i] + uy[i] * uy[i] + uz[i] * uz[i]);
+            double ra = std::atan2(uy[i], ux[i]) * kRadToDeg;
+            ra += ra < 0.0 ? 360.0 : 0.0;
+            strided(out_ra_deg, base + i, stride_bytes) = ra;
+            strided(out_dec_deg, base + i, stride_bytes) =
+                std::asin(std::max(-1.0, std::min(1.0, uz[i] / r))) * kRadToDeg;
+        }
+    }
+}
+
+bool StarCatalogTransform::julianDateFromISO(const std::string& iso_utc, double& jd) {
+    int year = 0, month = 0, day = 0, hour = 0, minute = 0;
+    double second = 0.0;
+    int fields = std::sscanf(iso_utc.c_str(), "%d-%d-%d%*[T ]%d:%d:%lf",
+                             &year, &month, &day, &hour, &minute, &second);
+    if (fields < 3 || month < 1 || month > 12 || day < 1 || day > 31 ||
+        hour < 0 || hour > 23 || minute < 0 || minute > 59 || second < 0.0 || second >= 61.0) {
+        return false;
+    }
+
+    // Algoritmo di Meeus (calendario gregoriano)
+    if (month <= 2) {
+        year -= 1;
+        month += 12;
+    }
+    const int a = year / 100;
+    const int b = 2 - a + a / 4;
+    const double day_fraction = (hour + (minute + second / 60.0) / 60.0) / 24.0;
+    jd = std::floor(365.25 * (year + 4716)) + std::floor(30.6001 * (month + 1)) +
+         day + day_fraction + b - 1524.5;
+    return true;
+}
+
+} // namespace ioc_earth
@@ -0,0 +1,259 @@
+#include "StationCrossTrack.h"
+#include "CsvFormat.h"
+#include "ParallelFor.h"
+#include "ShadowPathEngine.h"
+#include "StarCatalogTransform.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+
+namespace ioc_earth {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kDegToRad = kPi / 180.0;
+constexpr double kSecondsPerDay = 86400.0;
+
+// Fattore (1 - e²) WGS84: latitudine geodetica -> geocentrica
+constexpr double kGeocentricFactor = 1.0 - 0.00669437999014;
+
+// Dimensione dei blocchi di stazioni
+constexpr std::size_t kBlockSize = 256;
+
+inline void unitVector(double lon_deg, double lat_deg, double& x, double& y, double& z) {
+    const double lat = std::atan(kGeocentricFactor * std::tan(lat_deg * kDegToRad));
+    const double lon = lon_deg * kDegToRad;
+    x = std::cos(lat) * std::cos(lon);
+    y = std::cos(lat) * std::sin(lon);
+    z = std::sin(lat);
+}
+
+/**
+ * Linea centrale in forma SoA: estremi, normale del cerchio massimo e
+ * tangenti agli estremi (per il test "proiezione interna all'arco")
+ */
+struct ArcTable {
+    std::vector<double> ax, ay, az;   // Primo estremo
+    std::vector<double> bx, by, bz;   // Secondo estremo
+    std::vector<double> nx, ny, nz;   // Normale unitaria a x b
+    std::vector<double> tax, tay, taz; // n x a
+    std::vector<double> tbx, tby, tbz; // n x b
+    std::vector<double> arc;          // Ampiezza dell'arco (radianti)
+    std::vector<double> start_jd, end_jd;
+
+    std::size_t size() const { return ax.size(); }
+};
+
+ArcTable buildArcs(const std::vector<OccultationPathPoint>& line) {
+    ArcTable t;
+    std::vector<double> px(line.size()), py(line.size()), pz(line.size()), jd(line.size(), 0.0);
+    for (std::size_t i = 0; i < line.size(); ++i) {
+        unitVector(line[i].longitude, line[i].latitude, px[i], py[i], pz[i]);
+        if (!StarCatalogTransform::julianDateFromISO(line[i].timestamp, jd[i])) {
+            jd[i] = 0.0;
+        }
+    }
+
+    for (std::size_t i = 0; i + 1 < line.size(); ++i) {
+        const double cx = py[i] * pz[i + 1] - pz[i] * py[i + 1];
+        const double cy = pz[i] * px[i + 1] - px[i] * pz[i + 1];
+        const double cz = px[i] * py[i + 1] - py[i] * px[i + 1];
+        const double norm = std::sqrt(cx * cx + cy * cy + cz * cz);
+        if (norm <= 0.0) continue;  // Punti coincidenti
+        const double nx = cx / norm, ny = cy / norm, nz = cz / norm;
+
+        t.ax.push_back(px[i]);     t.ay.push_back(py[i]);     t.az.push_back(pz[i]);
+        t.bx.push_back(px[i + 1]); t.by.push_back(py[i + 1]); t.bz.push_back(pz[i + 1]);
+        t.nx.push_back(nx);        t.ny.push_back(ny);        t.nz.push_back(nz);
+        t.tax.push_back(ny * pz[i] - nz * py[i]);
+        t.tay.push_back(nz * px[i] - nx * pz[i]);
+        t.taz.push_back(nx * py[i] - ny * px[i]);
+        t.tbx.push_back(ny * pz[i + 1] - nz * py[i + 1]);
+        t.tby.push_back(nz * px[i + 1] - nx * pz[i + 1]);
+        t.tbz.push_back(nx * py[i + 1] - ny * px[i + 1]);
+        t.arc.push_back(std::atan2(norm, px[i] * px[i + 1] + py[i] * py[i + 1] + pz[i] * pz[i + 1]));
+        t.start_jd.push_back(jd[i]);
+        t.end_jd.push_back(jd[i + 1]);
+    }
+    return t;
+}
+
+/**
+ * Distanza angolare con segno di un punto dal percorso
+ */
+double signedAngle(const ArcTable& arcs, std::size_t s, double x, double y, double z) {
+    const double d = x * arcs.nx[s] + y * arcs.ny[s] + z * arcs.nz[s];
+    const bool inside = x * arcs.tax[s] + y * arcs.tay[s] + z * arcs.taz[s] >= 0.0 &&
+                        x * arcs.tbx[s] + y * arcs.tby[s] + z * arcs.tbz[s] <= 0.0;
+    if (inside) {
+        return std::asin(std::max(-1.0, std::min(1.0, d)));
+    }
+    const double ca = x * arcs.ax[s] + y * arcs.ay[s] + z * arcs.az[s];
+    const double cb = x * arcs.bx[s] + y * arcs.by[s] + z * arcs.bz[s];
+    const double angle = std::acos(std::max(-1.0, std::min(1.0, std::max(ca, cb))));
+    return d >= 0.0 ? angle : -angle;
+}
+
+/**
+ * Elabora un blocco di stazioni: per ogni arco aggiorna il migliore
+ * (massimo coseno della distanza angolare) di ciascuna stazione
+ */
+void processBlock(const ArcTable& arcs, const CoordinateView& stations, std::size_t base,
+                  std::size_t n, double radius_km, double ground_speed_fallback,
+                  StationPrediction* out) {
+    double x[kBlockSize], y[kBlockSize], z[kBlockSize];
+    double best_cos[kBlockSize];
+    std::size_t best_arc[kBlockSize];
+
+    for (std::size_t i = 0; i < n; ++i) {
+        unitVector(stations.x(base + i), stations.y(base + i), x[i], y[i], z[i]);
+        best_cos[i] = -2.0;
+        best_arc[i] = 0;
+    }
+
+    for (std::size_t s = 0; s < arcs.size(); ++s) {
+        const double ax = arcs.ax[s], ay = arcs.ay[s], az = arcs.az[s];
+        const double bx = arcs.bx[s], by = arcs.by[s], bz = arcs.bz[s];
+        const double nx = arcs.nx[s], ny = arcs.ny[s], nz = arcs.nz[s];
+        const double tax = arcs.tax[s], tay = arcs.tay[s], taz = arcs.taz[s];
+        const double tbx = arcs.tbx[s], tby = arcs.tby[s], tbz = arcs.tbz[s];
+
+        // Ciclo senza salti: solo prodotti scalari, sqrt e selezioni
+        for (std::size_t i = 0; i < n; ++i) {
+            const double d = x[i] * nx + y[i] * ny + z[i] * nz;
+            const double in_a = x[i] * tax + y[i] * tay + z[i] * taz;
+            const double in_b = x[i] * tbx + y[i] * tby + z[i] * tbz;
+            const double ca = x[i] * ax + y[i] * ay + z[i] * az;
+            const double cb = x[i] * bx + y[i] * by + z[i] * bz;
+            const double perpendicular = std::sqrt(std::max(0.0, 1.0 - d * d));
+            const double endpoint = ca > cb ? ca : cb;
+            const double c = (in_a >= 0.0 && in_b <= 0.0) ? perpendicular : endpoint;
+            const bool better = c > best_cos[i];
+            best_cos[i] = better ? c : best_cos[i];
+            best_arc[i] = better ? s : best_arc[i];
+        }
+    }
+
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::size_t s = best_arc[i];
+        StationPrediction& p = out[base + i];
+        const double angle = signedAngle(arcs, s, x[i], y[i], z[i]);
+        p.segment = s;
+        p.cross_track_km = angle * StationCrossTrack::kMeanEarthRadiusKm;
+        p.shadow_known = radius_km > 0.0;
+        p.in_shadow = std::abs(p.cross_track_km) <= radius_km;
+        p.chord_km = p.in_shadow
+            ? 2.0 * std::sqrt(radius_km * radius_km - p.cross_track_km * p.cross_track_km) : 0.0;
+
+        // Posizione lungo l'arco della proiezione della stazione
+        const double along = std::atan2(x[i] * arcs.tax[s] + y[i] * arcs.tay[s] + z[i] * arcs.taz[s],
+                                        x[i] * arcs.ax[s] + y[i] * arcs.ay[s] + z[i] * arcs.az[s]);
+        const double fraction = arcs.arc[s] > 0.0
+            ? std::max(0.0, std::min(1.0, along / arcs.arc[s])) : 0.0;
+
+        const double start = arcs.start_jd[s];
+        const double end = arcs.end_jd[s];
+        double speed_km_s = ground_speed_fallback;
+        if (start > 0.0 && end > start) {
+            p.mid_time_jd = start + fraction * (end - start);
+            p.mid_time_utc = ShadowPathEngine::isoFromJulianDate(p.mid_time_jd);
+            speed_km_s = arcs.arc[s] * StationCrossTrack::kMeanEarthRadiusKm /
+                         ((end - start) * kSecondsPerDay);
+        }
+        p.duration_seconds = speed_km_s > 0.0 ? p.chord_km / speed_km_s : 0.0;
+    }
+}
+
+} // namespace
+
+bool StationCrossTrack::compute(const OccultationData& data, const CoordinateView& stations,
+                                const Options& options, std::vector<StationPrediction>& predictions) {
+    predictions.clear();
+    const ArcTable arcs = buildArcs(data.central_line);
+    if (arcs.size() == 0) {
+        std::cerr << "Warning: linea centrale insufficiente per le previsioni delle stazioni" << std::endl;
+        return false;
+    }
+
+    // Raggio dell'ombra dal diametro dell'asteroide. I limiti dei dati sono
+    // a 1 sigma (diametro/2 + sigma) e non danno la larghezza dell'ombra:
+    // senza diametro si calcolano solo distanza e istante centrale
+    const double diameter_km = options.shadow_diameter_km > 0.0 ? options.shadow_diameter_km
+                                                                : data.shadow_diameter_km;
+    const double radius_km = diameter_km > 0.0 ? diameter_km / 2.0 : -1.0;
+
+    // Velocità al suolo se i timestamp mancano: dalla durata dichiarata
+    const double ground_speed = data.duration_seconds > 0.0 && radius_km > 0.0
+        ? 2.0 * radius_km / data.duration_seconds : 0.0;
+
+    const std::size_t count = stations.size();
+    predictions.resize(count);
+    const std::size_t blocks = (count + kBlockSize - 1) / kBlockSize;
+
+    // Sotto la soglia i thread costano più del calcolo
+    const unsigned int threads = count >= options.parallel_threshold ? options.threads : 1;
+    parallelFor(blocks, threads, [&](std::size_t b) {
+        const std::size_t base = b * kBlockSize;
+        processBlock(arcs, stations, base, std::min(kBlockSize, count - base), radius_km,
+                     ground_speed, predictions.data());
+    });
+    return true;
+}
+
+bool StationCrossTrack::compute(const OccultationData& data, const StationRegistry& registry,
+                                const Options& options, std::vector<StationPrediction>& predictions) {
+    CoordinateView view = CoordinateView::fromMembers(registry.stations(),
+                                                      &RegisteredStation::longitude,
+                                                      &RegisteredStation::latitude,
+                                                      &RegisteredStation::name);
+    return compute(data, view, options, predictions);
+}
+
+void StationCrossTrack::writeTable(const std::vector<StationPrediction>& predictions,
+                                   const CoordinateView& stations, std::ostream& out) {
+    out << "name,latitude,longitude,cross_track_km,chord_km,duration_s,mid_time_utc,in_shadow\n";
+    const auto flags = out.flags();
+    out << std::fixed;
+    for (std::size_t i = 0; i < predictions.size() && i < stations.size(); ++i) {
+        const StationPrediction& p = predictions[i];
+        const std::string* name = stations.label(i);
+        out << (name ? csvField(*name) : std::string()) << ','
+            << std::setprecision(5) << stations.y(i) << ',' << stations.x(i) << ','
+            << std::setprecision(2) << p.cross_track_km << ',';
+        // Diametro ignoto: corda, durata e appartenenza all'ombra restano vuote
+        if (p.shadow_known) {
+            out << p.chord_km << ',' << p.duration_seconds << ',';
+        } else {
+            out << ",,";
+        }
+        out << csvField(p.mid_time_utc) << ',';
+        if (p.shadow_known) {
+            out << (p.in_shadow ? "yes" : "no");
+        }
+        out << '\n';
+    }
+    out.flags(flags);
+}
+
+std::vector<std::string> StationCrossTrack::makeLabels(const std::vector<StationPrediction>& predictions,
+                                                       const CoordinateView& stations) {
+    std::vector<std::string> labels;
+    labels.reserve(predictions.size());
+    char buffer[64];
+    for (std::size_t i = 0; i < predictions.size(); ++i) {
+        const StationPrediction& p = predictions[i];
+        const std::string* name = i < stations.size() ? stations.label(i) : nullptr;
+        std::snprintf(buffer, sizeof(buffer), " %+.1f km", p.cross_track_km);
+        std::string label = (name ? *name : std::string()) + buffer;
+        if (p.mid_time_utc.size() >= 19) {
+            label += " " + p.mid_time_utc.substr(11, 8);
+        }
+        labels.push_back(std::move(label));
+    }
+    return labels;
+}
+
+} // namespace ioc_earth
@@ -0,0 +1,345 @@
+#include "StationRegistry.h"
+#include "CsvFormat.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace ioc_earth {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kDegToRad = kPi / 180.0;
+
+// Lunghezza di un grado di latitudine (km, sfera di raggio medio)
+constexpr double kKmPerDegree = 111.195;
+
+// Coseno minimo usato per allargare le celle in longitudine vicino ai poli
+constexpr double kMinCosLatitude = 0.01;
+
+std::string trim(const std::string& text) {
+    const auto first = text.find_first_not_of(" \t\r");
+    if (first == std::string::npos) return std::string();
+    const auto last = text.find_last_not_of(" \t\r");
+    return text.substr(first, last - first + 1);
+}
+
+double wrapLongitude(double lon) {
+    return std::remainder(lon, 360.0);
+}
+
+/**
+ * Distanza con segno di un punto da un segmento, in un piano locale
+ * equirettangolare centrato sul segmento (adatto a distanze di centinaia di km)
+ */
+struct SegmentFrame {
+    double lon0, lat0;     // Primo estremo
+    double bx, by;         // Secondo estremo relativo al primo (km)
+    double km_per_lon;     // km per grado di longitudine alla latitudine media
+    double inv_length2;    // 1 / |b|² (0 se il segmento è degenere)
+
+    SegmentFrame(const OccultationPathPoint& a, const OccultationPathPoint& b) {
+        lon0 = a.longitude;
+        lat0 = a.latitude;
+        km_per_lon = std::cos((a.latitude + b.latitude) * 0.5 * kDegToRad) * kKmPerDegree;
+        bx = wrapLongitude(b.longitude - a.longitude) * km_per_lon;
+        by = (b.latitude - a.latitude) * kKmPerDegree;
+        const double length2 = bx * bx + by * by;
+        inv_length2 = length2 > 0.0 ? 1.0 / length2 : 0.0;
+    }
+
+    double signedDistance(double lon, double lat, double& fraction) const {
+        const double px = wrapLongitude(lon - lon0) * km_per_lon;
+        const double py = (lat - lat0) * kKmPerDegree;
+        fraction = std::max(0.0, std::min(1.0, (px * bx + py * by) * inv_length2));
+        const double dx = px - fraction * bx;
+        const double dy = py - fraction * by;
+        const double distance = std::sqrt(dx * dx + dy * dy);
+        return (bx * py - by * px) >= 0.0 ? distance : -distance;
+    }
+};
+
+/**
+ * Distanza con segno di un punto dalla linea (ricerca esaustiva, per pochi punti)
+ */
+double distanceToLine(const std::vector<OccultationPathPoint>& line, double lon, double lat) {
+    double best = 0.0;
+    double best_abs = -1.0;
+    for (std::size_t i = 0; i < line.size(); ++i) {
+        const SegmentFrame frame(line[i], line[std::min(i + 1, line.size() - 1)]);
+        double fraction;
+        const double d = frame.signedDistance(lon, lat, fraction);
+        if (best_abs < 0.0 || std::abs(d) < best_abs) {
+            best = d;
+            best_abs = std::abs(d);
+        }
+        if (line.size() == 1) break;
+    }
+    return best;
+}
+
+/**
+ * Mantiene per ogni stazione solo la corrispondenza più vicina
+ */
+void reduceMatches(std::vector<StationMatch>& matches) {
+    std::sort(matches.begin(), matches.end(), [](const StationMatch& a, const StationMatch& b) {
+        return a.index != b.index ? a.index < b.index
+                                  : std::abs(a.distance_km) < std::abs(b.distance_km);
+    });
+    matches.erase(std::unique(matches.begin(), matches.end(),
+                              [](const StationMatch& a, const StationMatch& b) {
+                                  return a.index == b.index;
+                              }),
+                  matches.end());
+}
+
+} // namespace
+
+StationRegistry::StationRegistry(double cell_size_degrees)
+    : cell_size_(cell_size_degrees > 0.0 ? cell_size_degrees : 0.5) {
+    columns_ = static_cast<unsigned int>(std::ceil(360.0 / cell_size_));
+    rows_ = static_cast<unsigned int>(std::ceil(180.0 / cell_size_));
+}
+
+std::size_t StationRegistry::addStation(const RegisteredStation& station) {
+    stations_.push_back(station);
+    index_valid_ = false;
+    return stations_.size() - 1;
+}
+
+void StationRegistry::addStations(const std::vector<RegisteredStation>& stations) {
+    stations_.insert(stations_.end(), stations.begin(), stations.end());
+    index_valid_ = false;
+}
+
+void StationRegistry::clear() {
+    stations_.clear();
+    index_valid_ = false;
+}
+
+bool StationRegistry::loadFromCSV(const std::string& csv_path) {
+    std::ifstream file(csv_path);
+    if (!file.is_open()) {
+        std::cerr << "Error: Cannot open file " << csv_path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    std::vector<std::string> fields;
+    std::size_t line_number = 0;
+    std::size_t loaded = 0;
+    while (std::getline(file, line)) {
+        ++line_number;
+        const std::string trimmed = trim(line);
+        if (trimmed.empty() || trimmed[0] == '#') continue;
+
+        // Un campo tra virgolette può proseguire sulle righe successive
+        const std::size_t record_line = line_number;
+        std::string record = line;
+        bool complete = splitCsvRecord(record, fields);
+        while (!complete && std::getline(file, line)) {
+            ++line_number;
+            record += '\n';
+            record += line;
+            complete = splitCsvRecord(record, fields);
+        }
+
+        RegisteredStation station;
+        try {
+            if (!complete) throw std::invalid_argument("virgolette non chiuse");
+            if (fields.size() < 3) throw std::invalid_argument("campi mancanti");
+            station.name = fields[0];
+            station.latitude = std::stod(fields[1]);
+            station.longitude = std::stod(fields[2]);
+            if (fields.size() > 3 && !fields[3].empty()) station.altitude_m = std::stod(fields[3]);
+            if (fields.size() > 4) station.observer = fields[4];
+        } catch (const std::exception&) {
+            std::cerr << "Warning: riga " << record_line << " non valida in " << csv_path << std::endl;
+            continue;
+        }
+        if (std::abs(station.latitude) > 90.0) {
+            std::cerr << "Warning: latitudine non valida alla riga " << record_line << std::endl;
+            continue;
+        }
+        stations_.push_back(std::move(station));
+        ++loaded;
+    }
+
+    index_valid_ = false;
+    std::cout << "Caricate " << loaded << " stazioni da " << csv_path << std::endl;
+    return true;
+}
+
+bool StationRegistry::saveToCSV(const std::string& csv_path) const {
+    std::ofstream file(csv_path);
+    if (!file.is_open()) {
+        std::cerr << "Error: Cannot create file " << csv_path << std::endl;
+        return false;
+    }
+
+    file << "# nome,latitudine,longitudine,quota_m,osservatore\n";
+    file << std::setprecision(10);
+    for (const auto& station : stations_) {
+        file << csvField(station.name) << ',' << station.latitude << ',' << station.longitude << ','
+             << station.altitude_m << ',' << csvField(station.observer) << '\n';
+    }
+    return static_cast<bool>(file);
+}
+
+unsigned int StationRegistry::columnOf(double lon) const {
+    double normalized = wrapLongitude(lon) + 180.0;
+    const auto column = static_cast<long>(std::floor(normalized / cell_size_));
+    return static_cast<unsigned int>(std::max(0L, std::min(column, static_cast<long>(columns_) - 1)));
+}
+
+unsigned int StationRegistry::rowOf(double lat) const {
+    const auto row = static_cast<long>(std::floor((lat + 90.0) / cell_size_));
+    return static_cast<unsigned int>(std::max(0L, std::min(row, static_cast<long>(rows_) - 1)));
+}
+
+void StationRegistry::ensureIndex() const {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    if (index_valid_) return;
+
+    // Ordinamento per conteggio: una passata per contare, una per riempire
+    const std::size_t cells = static_cast<std::size_t>(columns_) * rows_;
+    cell_offsets_.assign(cells + 1, 0);
+    std::vector<std::uint32_t> cell_of(stations_.size());
+    for (std::size_t i = 0; i < stations_.size(); ++i) {
+        cell_of[i] = rowOf(stations_[i].latitude) * columns_ + columnOf(stations_[i].longitude);
+        ++cell_offsets_[cell_of[i] + 1];
+    }
+    for (std::size_t c = 0; c < cells; ++c) {
+        cell_offsets_[c + 1] += cell_offsets_[c];
+    }
+
+    cell_items_.resize(stations_.size());
+    std::vector<std::uint32_t> cursor(cell_offsets_.begin(), cell_offsets_.end() - 1);
+    for (std::size_t i = 0; i < stations_.size(); ++i) {
+        cell_items_[cursor[cell_of[i]]++] = static_cast<std::uint32_t>(i);
+    }
+    index_valid_ = true;
+}
+
+template <typename Visit>
+void StationRegistry::forEachInBox(double min_lon, double min_lat, double max_lon, double max_lat,
+                                   Visit&& visit) const {
+    const unsigned int row_from = rowOf(min_lat);
+    const unsigned int row_to = rowOf(max_lat);
+
+    auto visit_columns = [&](unsigned int column_from, unsigned int column_to) {
+        for (unsigned int row = row_from; row <= row_to; ++row) {
+            const std::size_t base = static_cast<std::size_t>(row) * columns_;
+            for (std::uint32_t k = cell_offsets_[base + column_from];
+                 k < cell_offsets_[base + column_to + 1]; ++k) {
+                visit(static_cast<std::size_t>(cell_items_[k]));
+            }
+        }
+    };
+
+    // Le celle di una riga sono contigue: ogni intervallo di colonne è un
+    // unico intervallo di cell_items_. Il rettangolo può attraversare l'antimeridiano.
+    if (max_lon - min_lon >= 360.0) {
+        visit_columns(0, columns_ - 1);
+        return;
+    }
+    const double from = wrapLongitude(min_lon);
+    const double to = from + (max_lon - min_lon);
+    if (to < 180.0) {
+        visit_columns(columnOf(from), columnOf(to));
+    } else {
+        visit_columns(columnOf(from), columns_ - 1);
+        visit_columns(0, columnOf(to - 360.0));
+    }
+}
+
+void StationRegistry::queryBox(double min_lon, double min_lat, double max_lon, double max_lat,
+                               std::vector<std::size_t>& indices) const {
+    indices.clear();
+    ensureIndex();
+
+    // min_lon > max_lon: il rettangolo attraversa l'antimeridiano
+    if (max_lon < min_lon) max_lon += 360.0;
+    const double width = max_lon - min_lon;
+    forEachInBox(min_lon, min_lat, max_lon, max_lat, [&](std::size_t i) {
+        const auto& station = stations_[i];
+        const double offset = station.longitude - min_lon -
+                              360.0 * std::floor((station.longitude - min_lon) / 360.0);
+        if (station.latitude >= min_lat && station.latitude <= max_lat &&
+            (width >= 360.0 || offset <= width)) {
+            indices.push_back(i);
+        }
+    });
+    std::sort(indices.begin(), indices.end());
+}
+
+void StationRegistry::queryNearLine(const std::vector<OccultationPathPoint>& line,
+                                    double max_distance_km,
+                                    std::vector<StationMatch>& matches) const {
+    matches.clear();
+    if (line.empty() || stations_.empty() || max_distance_km < 0.0) return;
+    ensureIndex();
+
+    const double lat_margin = max_distance_km / kKmPerDegree;
+    const std::size_t segments = line.size() > 1 ? line.size() - 1 : 1;
+
+    for (std::size_t s = 0; s < segments; ++s) {
+        const OccultationPathPoint& a = line[s];
+        const OccultationPathPoint& b = line[std::min(s + 1, line.size() - 1)];
+        const SegmentFrame frame(a, b);
+
+        // Rettangolo del segmento allargato della distanza massima
+        const double b_lon = a.longitude + wrapLongitude(b.longitude - a.longitude);
+        const double min_lat = std::min(a.latitude, b.latitude) - lat_margin;
+        const double max_lat = std::max(a.latitude, b.latitude) + lat_margin;
+        const double extreme_lat = std::min(90.0, std::max(std::abs(min_lat), std::abs(max_lat)));
+        const double lon_margin = lat_margin /
+            std::max(kMinCosLatitude, std::cos(extreme_lat * kDegToRad));
+
+        forEachInBox(std::min(a.longitude, b_lon) - lon_margin, min_lat,
+                     std::max(a.longitude, b_lon) + lon_margin, max_lat,
+                     [&](std::size_t i) {
+            double fraction;
+            const double d = frame.signedDistance(stations_[i].longitude,
+                                                  stations_[i].latitude, fraction);
+            if (std::abs(d) <= max_distance_km) {
+                matches.push_back(StationMatch{i, d, s, fraction});
+            }
+        });
+    }
+
+    reduceMatches(matches);
+}
+
+void StationRegistry::queryInPath(const OccultationData& data, double margin_km,
+                                  std::vector<StationMatch>& matches) const {
+    matches.clear();
+    if (data.central_line.empty()) return;
+
+    // Semilarghezza della fascia da ciascun lato, misurata a metà dei limiti
+    auto half_width = [&](const std::vector<OccultationPathPoint>& limit, double& side) {
+        if (limit.empty()) return -1.0;
+        const auto& middle = limit[limit.size() / 2];
+        const double d = distanceToLine(data.central_line, middle.longitude, middle.latitude);
+        side = d >= 0.0 ? 1.0 : -1.0;
+        return std::abs(d);
+    };
+
+    double north_side = 1.0, south_side = -1.0;
+    double north = half_width(data.northern_limit, north_side);
+    double south = half_width(data.southern_limit, south_side);
+    if (north < 0.0) north = std::max(0.0, south);
+    if (south < 0.0) south = north;
+    if (data.northern_limit.empty()) north_side = -south_side;
+
+    queryNearLine(data.central_line, std::max(north, south) + margin_km, matches);
+
+    matches.erase(std::remove_if(matches.begin(), matches.end(), [&](const StationMatch& m) {
+        const bool on_north_side = (m.distance_km >= 0.0) == (north_side > 0.0);
+        return std::abs(m.distance_km) > (on_north_side ? north : south) + margin_km;
+    }), matches.end());
+}
+
+} // namespace ioc_earth
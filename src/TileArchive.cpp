@@ -0,0 +1,333 @@
+#include "TileArchive.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <utility>
+
+namespace ioc_earth {
+
+namespace {
+
+constexpr std::size_t kHeaderSize = 127;
+
+// Header e directory radice devono stare nei primi 16 KiB
+constexpr std::size_t kMaxRootSize = 16384 - kHeaderSize;
+
+constexpr std::size_t kInitialLeafSize = 4096;
+
+constexpr std::size_t kCopyBufferSize = 1 << 20;
+
+void appendVarint(std::string& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+template <typename T>
+void putLE(char* out, T value) {
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+        out[i] = static_cast<char>((static_cast<std::uint64_t>(value) >> (8 * i)) & 0xFF);
+    }
+}
+
+std::int32_t toE7(double degrees) {
+    return static_cast<std::int32_t>(std::lround(degrees * 1e7));
+}
+
+// FNV-1a a 64 bit: basta a raggruppare i candidati, l'uguaglianza è verificata sui byte
+std::uint64_t contentHash(const std::string& data) {
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+std::string jsonEscape(const std::string& text) {
+    std::string out;
+    out.reserve(text.size());
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) continue;
+                out.push_back(c);
+        }
+    }
+    return out;
+}
+
+const char* formatName(TileArchive::TileType type) {
+    switch (type) {
+        case TileArchive::TileType::MVT: return "pbf";
+        case TileArchive::TileType::PNG: return "png";
+        case TileArchive::TileType::JPEG: return "jpg";
+        case TileArchive::TileType::WebP: return "webp";
+        default: return "";
+    }
+}
+
+} // namespace
+
+TileArchive::TileArchive() = default;
+
+TileArchive::~TileArchive() {
+    if (data_.is_open()) {
+        data_.close();
+        std::remove(temp_path_.c_str());
+    }
+}
+
+std::uint64_t TileArchive::tileId(const TileCoord& tile) {
+    // Tile dei livelli precedenti: (4^z - 1) / 3
+    std::uint64_t id = ((1ULL << (2 * tile.z)) - 1) / 3;
+    std::uint64_t x = tile.x, y = tile.y;
+    for (std::uint64_t s = tile.z > 0 ? 1ULL << (tile.z - 1) : 0; s > 0; s >>= 1) {
+        const std::uint64_t rx = (x & s) ? 1 : 0;
+        const std::uint64_t ry = (y & s) ? 1 : 0;
+        id += s * s * ((3 * rx) ^ ry);
+        // Rotazione del quadrante (Hilbert)
+        if (ry == 0) {
+            if (rx == 1) {
+                x = s - 1 - (x & (s - 1));
+                y = s - 1 - (y & (s - 1));
+            }
+            std::swap(x, y);
+        }
+    }
+    return id;
+}
+
+bool TileArchive::open(const std::string& output_path, TileType type, Compression compression) {
+    output_path_ = output_path;
+    temp_path_ = output_path + ".tmp";
+    type_ = type;
+    compression_ = compression;
+    entries_.clear();
+    contents_.clear();
+    stats_ = Stats();
+    data_size_ = 0;
+
+    data_.open(temp_path_, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!data_) {
+        std::cerr << "Error: impossibile creare " << temp_path_ << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void TileArchive::setMetadata(const std::string& name, const std::string& description) {
+    name_ = name;
+    description_ = description;
+}
+
+void TileArchive::setBounds(double min_lon, double min_lat, double max_lon, double max_lat) {
+    bounds_[0] = min_lon;
+    bounds_[1] = min_lat;
+    bounds_[2] = max_lon;
+    bounds_[3] = max_lat;
+}
+
+bool TileArchive::sameContent(const Entry& entry, const std::string& data) {
+    if (entry.length != data.size()) {
+        return false;
+    }
+    std::string stored(entry.length, '\0');
+    data_.seekg(static_cast<std::streamoff>(entry.offset));
+    data_.read(&stored[0], entry.length);
+    data_.seekp(0, std::ios::end);
+    return data_ && stored == data;
+}
+
+bool TileArchive::addTile(const TileCoord& tile, const std::string& data) {
+    if (!data_.is_open()) {
+        std::cerr << "Error: archivio di tile non aperto" << std::endl;
+        return false;
+    }
+
+    if (entries_.empty()) {
+        min_zoom_ = max_zoom_ = tile.z;
+    }
+    min_zoom_ = std::min(min_zoom_, tile.z);
+    max_zoom_ = std::max(max_zoom_, tile.z);
+    ++stats_.addressed_tiles;
+
+    Entry entry{tileId(tile), 0, static_cast<std::uint32_t>(data.size()), 1};
+
+    // Contenuto già scritto: nuova voce che punta agli stessi byte
+    auto& candidates = contents_[contentHash(data)];
+    for (std::size_t index : candidates) {
+        if (sameContent(entries_[index], data)) {
+            entry.offset = entries_[index].offset;
+            entries_.push_back(entry);
+            stats_.bytes_deduplicated += data.size();
+            return true;
+        }
+    }
+
+    entry.offset = data_size_;
+    data_.seekp(0, std::ios::end);
+    if (!data_.write(data.data(), static_cast<std::streamsize>(data.size()))) {
+        std::cerr << "Error: scrittura della tile fallita in " << temp_path_ << std::endl;
+        return false;
+    }
+    data_size_ += data.size();
+    candidates.push_back(entries_.size());
+    entries_.push_back(entry);
+    ++stats_.tile_contents;
+    return true;
+}
+
+std::string TileArchive::serializeDirectory(const std::vector<Entry>& entries) {
+    std::string out;
+    appendVarint(out, entries.size());
+    std::uint64_t last_id = 0;
+    for (const Entry& e : entries) {
+        appendVarint(out, e.tile_id - last_id);
+        last_id = e.tile_id;
+    }
+    for (const Entry& e : entries) {
+        appendVarint(out, e.run_length);
+    }
+    for (const Entry& e : entries) {
+        appendVarint(out, e.length);
+    }
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        // 0: subito dopo la voce precedente
+        if (i > 0 && entries[i].offset == entries[i - 1].offset + entries[i - 1].length) {
+            appendVarint(out, 0);
+        } else {
+            appendVarint(out, entries[i].offset + 1);
+        }
+    }
+    return out;
+}
+
+bool TileArchive::finalize() {
+    if (!data_.is_open()) {
+        std::cerr << "Error: archivio di tile non aperto" << std::endl;
+        return false;
+    }
+
+    // Ordine per tile_id; per tile ripetute vale l'ultima aggiunta
+    std::stable_sort(entries_.begin(), entries_.end(),
+                     [](const Entry& a, const Entry& b) { return a.tile_id < b.tile_id; });
+    std::vector<Entry> runs;
+    runs.reserve(entries_.size());
+    for (std::size_t i = 0; i < entries_.size(); ++i) {
+        if (i + 1 < entries_.size() && entries_[i + 1].tile_id == entries_[i].tile_id) {
+            continue;
+        }
+        const Entry& e = entries_[i];
+        if (!runs.empty()) {
+            Entry& last = runs.back();
+            if (last.offset == e.offset && last.length == e.length &&
+                last.tile_id + last.run_length == e.tile_id) {
+                ++last.run_length;
+                continue;
+            }
+        }
+        runs.push_back(e);
+    }
+    stats_.tile_entries = runs.size();
+
+    // Directory radice, o radice di puntatori a directory foglia
+    std::string root = serializeDirectory(runs);
+    std::string leaves;
+    if (root.size() > kMaxRootSize) {
+        std::size_t leaf_size = kInitialLeafSize;
+        while (true) {
+            std::vector<Entry> root_entries;
+            leaves.clear();
+            for (std::size_t first = 0; first < runs.size(); first += leaf_size) {
+                const std::size_t last = std::min(runs.size(), first + leaf_size);
+                const std::string leaf = serializeDirectory(
+                    std::vector<Entry>(runs.begin() + first, runs.begin() + last));
+                root_entries.push_back({runs[first].tile_id, leaves.size(),
+                                        static_cast<std::uint32_t>(leaf.size()), 0});
+                leaves += leaf;
+            }
+            root = serializeDirectory(root_entries);
+            if (root.size() <= kMaxRootSize) break;
+            leaf_size += leaf_size / 5;
+        }
+    }
+
+    std::ostringstream metadata;
+    metadata << "{\"name\":\"" << jsonEscape(name_) << "\",\"description\":\"" << jsonEscape(description_)
+             << "\",\"format\":\"" << formatName(type_) << "\"}";
+    const std::string metadata_json = metadata.str();
+
+    char header[kHeaderSize] = {};
+    std::copy_n("PMTiles", 7, header);
+    header[7] = 3;
+    const std::uint64_t root_offset = kHeaderSize;
+    const std::uint64_t metadata_offset = root_offset + root.size();
+    const std::uint64_t leaves_offset = metadata_offset + metadata_json.size();
+    const std::uint64_t data_offset = leaves_offset + leaves.size();
+    putLE<std::uint64_t>(header + 8, root_offset);
+    putLE<std::uint64_t>(header + 16, root.size());
+    putLE<std::uint64_t>(header + 24, metadata_offset);
+    putLE<std::uint64_t>(header + 32, metadata_json.size());
+    putLE<std::uint64_t>(header + 40, leaves_offset);
+    putLE<std::uint64_t>(header + 48, leaves.size());
+    putLE<std::uint64_t>(header + 56, data_offset);
+    putLE<std::uint64_t>(header + 64, data_size_);
+    putLE<std::uint64_t>(header + 72, runs.empty() ? 0 : stats_.addressed_tiles);
+    putLE<std::uint64_t>(header + 80, stats_.tile_entries);
+    putLE<std::uint64_t>(header + 88, stats_.tile_contents);
+    header[96] = 0;                                            // Dati nell'ordine di arrivo
+    header[97] = static_cast<char>(Compression::None);         // Directory e metadati non compressi
+    header[98] = static_cast<char>(compression_);
+    header[99] = static_cast<char>(type_);
+    header[100] = static_cast<char>(min_zoom_);
+    header[101] = static_cast<char>(max_zoom_);
+    putLE<std::int32_t>(header + 102, toE7(bounds_[0]));
+    putLE<std::int32_t>(header + 106, toE7(bounds_[1]));
+    putLE<std::int32_t>(header + 110, toE7(bounds_[2]));
+    putLE<std::int32_t>(header + 114, toE7(bounds_[3]));
+    header[118] = static_cast<char>(min_zoom_);
+    putLE<std::int32_t>(header + 119, toE7((bounds_[0] + bounds_[2]) / 2.0));
+    putLE<std::int32_t>(header + 123, toE7((bounds_[1] + bounds_[3]) / 2.0));
+
+    std::ofstream out(output_path_, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Error: impossibile creare " << output_path_ << std::endl;
+        return false;
+    }
+    out.write(header, kHeaderSize);
+    out << root << metadata_json << leaves;
+
+    // Copia dei dati delle tile dal file temporaneo
+    data_.flush();
+    data_.seekg(0);
+    std::vector<char> buffer(kCopyBufferSize);
+    std::uint64_t remaining = data_size_;
+    while (remaining > 0 && data_) {
+        const std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(remaining, buffer.size()));
+        data_.read(buffer.data(), static_cast<std::streamsize>(chunk));
+        out.write(buffer.data(), data_.gcount());
+        remaining -= static_cast<std::uint64_t>(data_.gcount());
+    }
+    data_.close();
+    std::remove(temp_path_.c_str());
+
+    if (remaining > 0 || !out) {
+        std::cerr << "Error: scrittura dell'archivio fallita: " << output_path_ << std::endl;
+        return false;
+    }
+
+    std::cout << "✓ Archivio PMTiles: " << output_path_ << " (" << stats_.addressed_tiles << " tile, "
+              << stats_.tile_contents << " contenuti distinti)" << std::endl;
+    return true;
+}
+
+} // namespace ioc_earth
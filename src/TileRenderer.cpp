@@ -0,0 +1,423 @@
+#include "TileRenderer.h"
+#include "ParallelFor.h"
+#include "PathDensifier.h"
+#include "TileArchive.h"
+#include "StationRegistry.h"
+#include <mapnik/image.hpp>
+#include <mapnik/image_view.hpp>
+#include <mapnik/image_util.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
+
+namespace ioc_earth {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kDegToRad = kPi / 180.0;
+
+// Latitudine massima della griglia Web Mercator
+constexpr double kMaxTileLat = 85.05112878;
+
+// Metà del lato del mondo proiettato (m), sulla sfera di MapProjection
+constexpr double kHalfWorld = kPi * MapProjection::kSphereRadius;
+
+// Posizione in unità di tile al livello con n tile per lato
+inline double tileX(double lon, double n) {
+    return (lon + 180.0) / 360.0 * n;
+}
+
+inline double tileY(double lat, double n) {
+    const double phi = std::max(-kMaxTileLat, std::min(kMaxTileLat, lat)) * kDegToRad;
+    return (1.0 - std::log(std::tan(phi) + 1.0 / std::cos(phi)) / kPi) / 2.0 * n;
+}
+
+inline std::uint64_t tileKey(unsigned int x, unsigned int y) {
+    return (static_cast<std::uint64_t>(x) << 32) | y;
+}
+
+/**
+ * @brief Raccoglie le tile entro pad (unità di tile) da punti e segmenti
+ */
+class CoverageMarker {
+public:
+    CoverageMarker(unsigned int zoom, double pad)
+        : n_(1u << zoom), pad_(pad) {}
+
+    void point(double lon, double lat) {
+        mark(tileX(lon, n_), tileY(lat, n_));
+    }
+
+    void line(const CoordinateView& path) {
+        for (std::size_t i = 0; i + 1 < path.size(); ++i) {
+            double lon0 = path.x(i), lon1 = path.x(i + 1);
+            // Antimeridiano: prosegue oltre ±180, la x viene poi riportata nella griglia
+            if (lon1 - lon0 > 180.0) lon1 -= 360.0;
+            else if (lon0 - lon1 > 180.0) lon1 += 360.0;
+
+            const double x0 = tileX(lon0, n_), y0 = tileY(path.y(i), n_);
+            const double x1 = tileX(lon1, n_), y1 = tileY(path.y(i + 1), n_);
+            // Passo 2*pad: ogni punto del segmento dista al massimo pad da un campione
+            const double length = std::max(std::abs(x1 - x0), std::abs(y1 - y0));
+            const std::size_t steps = std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(length / (2.0 * pad_))));
+            for (std::size_t s = 0; s <= steps; ++s) {
+                const double t = static_cast<double>(s) / steps;
+                mark(x0 + (x1 - x0) * t, y0 + (y1 - y0) * t);
+            }
+        }
+        if (path.size() == 1) {
+            point(path.x(0), path.y(0));
+        }
+    }
+
+    std::vector<std::uint64_t>& keys() { return keys_; }
+
+private:
+    unsigned int n_;
+    double pad_;
+    std::vector<std::uint64_t> keys_;
+
+    void mark(double fx, double fy) {
+        const long y_from = std::max(0L, static_cast<long>(std::floor(fy - pad_)));
+        const long y_to = std::min(static_cast<long>(n_) - 1, static_cast<long>(std::floor(fy + pad_)));
+        const long x_from = static_cast<long>(std::floor(fx - pad_));
+        const long x_to = static_cast<long>(std::floor(fx + pad_));
+        for (long y = y_from; y <= y_to; ++y) {
+            for (long x = x_from; x <= x_to; ++x) {
+                const long wrapped = ((x % static_cast<long>(n_)) + n_) % n_;
+                keys_.push_back(tileKey(static_cast<unsigned int>(wrapped), static_cast<unsigned int>(y)));
+            }
+        }
+    }
+};
+
+bool isTransparent(const mapnik::image_rgba8& image, unsigned int x0, unsigned int y0, unsigned int size) {
+    for (unsigned int y = y0; y < y0 + size; ++y) {
+        const std::uint32_t* row = image.get_row(y) + x0;
+        for (unsigned int x = 0; x < size; ++x) {
+            if (row[x] & 0xFF000000u) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+TileRenderer::TileRenderer(std::shared_ptr<const OccultationData> data)
+    : data_(std::move(data)) {
+}
+
+TileRenderer::~TileRenderer() = default;
+
+void TileRenderer::setOptions(const Options& options) {
+    const bool margin_changed = options.station_margin_km != options_.station_margin_km;
+    options_ = options;
+    if (margin_changed) {
+        updateRegistryMatches();
+    }
+}
+
+void TileRenderer::setStationRegistry(std::shared_ptr<const StationRegistry> registry) {
+    registry_ = std::move(registry);
+    updateRegistryMatches();
+}
+
+void TileRenderer::updateRegistryMatches() {
+    registry_indices_.clear();
+    if (!registry_ || !data_) {
+        return;
+    }
+    std::vector<StationMatch> matches;
+    registry_->queryInPath(*data_, options_.station_margin_km, matches);
+    for (const auto& match : matches) {
+        registry_indices_.push_back(match.index);
+    }
+    std::sort(registry_indices_.begin(), registry_indices_.end());
+}
+
+void TileRenderer::tileBounds(const TileCoord& tile,
+                              double& min_lon, double& min_lat, double& max_lon, double& max_lat) {
+    const double n = static_cast<double>(1u << tile.z);
+    auto lat = [n](double y) {
+        return std::atan(std::sinh(kPi * (1.0 - 2.0 * y / n))) / kDegToRad;
+    };
+    min_lon = tile.x / n * 360.0 - 180.0;
+    max_lon = (tile.x + 1) / n * 360.0 - 180.0;
+    max_lat = lat(tile.y);
+    min_lat = lat(tile.y + 1.0);
+}
+
+double TileRenderer::toleranceDegrees(unsigned int zoom) const {
+    if (style_.path_tolerance_pixels <= 0.0) {
+        return 0.0;
+    }
+    const double degrees_per_pixel = 360.0 / (static_cast<double>(options_.tile_size) * (1u << zoom));
+    return style_.path_tolerance_pixels * degrees_per_pixel;
+}
+
+double TileRenderer::padTiles() const {
+    // Metà del simbolo più grande più un pixel di antialiasing
+    const double symbol = std::max({style_.central_line_width, style_.sigma_lines_width,
+                                    style_.time_marker_size, style_.station_marker_size});
+    return (symbol / 2.0 + 1.0) / options_.tile_size;
+}
+
+std::vector<TileCoord> TileRenderer::coveredTiles(unsigned int zoom) const {
+    std::vector<TileCoord> tiles;
+    if (!data_ || zoom > kMaxZoom) {
+        return tiles;
+    }
+
+    CoverageMarker marker(zoom, padTiles());
+    const double tolerance = toleranceDegrees(zoom);
+    for (const auto* line : {&data_->central_line, &data_->northern_limit, &data_->southern_limit}) {
+        if (line->empty()) continue;
+        marker.line(PathDensifier::shared().densify(data_, *line, tolerance)->view());
+    }
+    for (const auto& m : data_->time_markers) {
+        marker.point(m.longitude, m.latitude);
+    }
+    for (const auto& s : data_->stations) {
+        marker.point(s.longitude, s.latitude);
+    }
+    if (registry_) {
+        for (std::size_t index : registry_indices_) {
+            const auto& s = registry_->stations()[index];
+            marker.point(s.longitude, s.latitude);
+        }
+    }
+
+    auto& keys = marker.keys();
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    tiles.reserve(keys.size());
+    for (std::uint64_t key : keys) {
+        tiles.push_back({zoom, static_cast<unsigned int>(key >> 32), static_cast<unsigned int>(key & 0xFFFFFFFFu)});
+    }
+    return tiles;
+}
+
+std::unique_ptr<MapPathRenderer> TileRenderer::createRenderer(unsigned int zoom, unsigned int side_pixels) const {
+    auto renderer = std::make_unique<MapPathRenderer>(side_pixels, side_pixels);
+    renderer->setProjection(MapProjection::mercator(0.0));
+    renderer->setBackgroundColor("transparent");
+
+    if (options_.include_shapefile) {
+        renderer->addShapefileLayer("../../data/ne_50m_admin_0_countries.shp", "countries");
+        renderer->addShapefileLayer("../../data/ne_50m_coastline.shp", "coastline");
+    }
+
+    // Stesso ordine dei layer di OccultationRenderer
+    const double tolerance = toleranceDegrees(zoom);
+    for (const auto* line : {&data_->northern_limit, &data_->southern_limit}) {
+        if (line->empty()) continue;
+        renderer->addGPSPath(PathDensifier::shared().densify(data_, *line, tolerance)->view(),
+                             style_.sigma_lines_color, style_.sigma_lines_width);
+    }
+    if (!data_->central_line.empty()) {
+        renderer->addGPSPath(PathDensifier::shared().densify(data_, data_->central_line, tolerance)->view(),
+                             style_.central_line_color, style_.central_line_width);
+    }
+
+    if (!data_->time_markers.empty()) {
+        using TimeMarker = OccultationData::TimeMarker;
+        CoordinateView markers = CoordinateView::fromMembers(data_->time_markers, &TimeMarker::longitude,
+                                                             &TimeMarker::latitude);
+        if (style_.show_time_labels) {
+            markers.withLabels(&data_->time_markers.front().time_utc, sizeof(TimeMarker));
+        }
+        renderer->addPointLabels(markers, "timestamp", style_.label_font_size);
+    }
+
+    if (!data_->stations.empty()) {
+        using Station = OccultationData::ObservationStation;
+        CoordinateView stations = CoordinateView::fromMembers(data_->stations, &Station::longitude,
+                                                              &Station::latitude);
+        if (style_.show_station_labels) {
+            stations.withLabels(&data_->stations.front().name, sizeof(Station));
+        }
+        renderer->addPointLabels(stations, "timestamp", style_.label_font_size);
+    }
+
+    if (registry_ && !registry_indices_.empty()) {
+        CoordinateView stations = CoordinateView::fromMembers(registry_->stations(),
+                                                              &RegisteredStation::longitude,
+                                                              &RegisteredStation::latitude);
+        if (style_.show_station_labels) {
+            stations.withLabels(&registry_->stations().front().name, sizeof(RegisteredStation));
+        }
+        stations.withIndices(registry_indices_.data(), registry_indices_.size());
+        renderer->addPointLabels(stations, "timestamp", style_.label_font_size);
+    }
+    return renderer;
+}
+
+bool TileRenderer::render(const TileSink& sink, Stats* stats) {
+    if (!data_ || data_->central_line.empty()) {
+        std::cerr << "Error: nessun dato di occultazione per le tile" << std::endl;
+        return false;
+    }
+    if (options_.tile_size == 0 || options_.min_zoom > options_.max_zoom || options_.format.isVector()) {
+        std::cerr << "Error: opzioni delle tile non valide" << std::endl;
+        return false;
+    }
+
+    std::cout << "\n=== Rendering Tile XYZ ===" << std::endl;
+
+    // Metatile da renderizzare, ordinati per livello
+    const unsigned int max_zoom = std::min(options_.max_zoom, kMaxZoom);
+    const unsigned int meta = std::max(1u, options_.metatile);
+    std::vector<MetaTile> jobs;
+    std::size_t candidates = 0;
+    for (unsigned int z = options_.min_zoom; z <= max_zoom; ++z) {
+        std::map<std::uint64_t, std::size_t> job_index;
+        for (const TileCoord& tile : coveredTiles(z)) {
+            const unsigned int mx = tile.x / meta, my = tile.y / meta;
+            auto inserted = job_index.emplace(tileKey(mx, my), jobs.size());
+            if (inserted.second) {
+                jobs.push_back({z, mx, my, {}});
+            }
+            jobs[inserted.first->second].tiles.push_back(tile);
+            ++candidates;
+        }
+    }
+    std::cout << "Tile candidate: " << candidates << " in " << jobs.size() << " metatile" << std::endl;
+
+    // Stato per thread: renderer con i layer del livello corrente e immagine
+    struct WorkerState {
+        std::unique_ptr<MapPathRenderer> renderer;
+        unsigned int renderer_zoom = 0;
+        mapnik::image_rgba8 image;
+    };
+    const unsigned int threads = parallelThreadCount(options_.threads, jobs.size());
+    std::vector<WorkerState> states(threads);
+
+    std::atomic<bool> failed{false};
+    std::atomic<std::size_t> metatiles{0}, rendered{0}, written{0}, empty{0};
+    std::mutex sink_mutex;
+
+    parallelFor(jobs.size(), threads, [&](std::size_t j, unsigned int worker) {
+        WorkerState& state = states[worker];
+        const MetaTile& job = jobs[j];
+        const unsigned int n = 1u << job.z;
+        const unsigned int side = std::min(meta, n);
+        const unsigned int tile = options_.tile_size;
+        const unsigned int buffer = options_.buffer_pixels;
+
+        // Layer costruiti una volta per livello, riusati per i metatile successivi
+        if (!state.renderer || state.renderer_zoom != job.z) {
+            state.renderer = createRenderer(job.z, side * tile + 2 * buffer);
+            state.renderer_zoom = job.z;
+        }
+
+        const double tile_m = 2.0 * kHalfWorld / n;
+        const double buffer_m = tile_m * buffer / tile;
+        const double min_x = -kHalfWorld + job.mx * side * tile_m;
+        const double max_y = kHalfWorld - job.my * side * tile_m;
+        state.renderer->setProjectedExtent(min_x - buffer_m, max_y - side * tile_m - buffer_m,
+                                           min_x + side * tile_m + buffer_m, max_y + buffer_m);
+        if (!state.renderer->renderToImage(state.image)) {
+            failed = true;
+            return false;
+        }
+        ++metatiles;
+
+        for (const TileCoord& coord : job.tiles) {
+            const unsigned int px = buffer + (coord.x - job.mx * side) * tile;
+            const unsigned int py = buffer + (coord.y - job.my * side) * tile;
+            ++rendered;
+            if (options_.skip_empty && isTransparent(state.image, px, py, tile)) {
+                ++empty;
+                continue;
+            }
+            mapnik::image_view_rgba8 view(px, py, tile, tile, state.image);
+            const std::string png = mapnik::save_to_string(view, options_.format.mapnikFormat());
+
+            std::lock_guard<std::mutex> lock(sink_mutex);
+            if (failed) return false;
+            if (!sink(coord, png)) {
+                failed = true;
+                return false;
+            }
+            ++written;
+        }
+        return true;
+    });
+
+    if (stats) {
+        stats->metatiles = metatiles;
+        stats->tiles_rendered = rendered;
+        stats->tiles_written = written;
+        stats->tiles_empty = empty;
+    }
+    std::cout << "Tile scritte: " << written << ", vuote scartate: " << empty << std::endl;
+    return !failed;
+}
+
+bool TileRenderer::renderToDirectory(const std::string& output_dir, Stats* stats) {
+    const std::string extension = "." + options_.format.extension();
+    return render([&output_dir, &extension](const TileCoord& tile, const std::string& png) {
+        const std::filesystem::path dir = std::filesystem::path(output_dir) /
+                                          std::to_string(tile.z) / std::to_string(tile.x);
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        std::ofstream file(dir / (std::to_string(tile.y) + extension), std::ios::binary);
+        if (!file || !file.write(png.data(), static_cast<std::streamsize>(png.size()))) {
+            std::cerr << "Error: impossibile scrivere la tile in " << dir.string() << std::endl;
+            return false;
+        }
+        return true;
+    }, stats);
+}
+
+bool TileRenderer::renderToArchive(const std::string& archive_path, Stats* stats) {
+    if (!data_) {
+        std::cerr << "Error: nessun dato di occultazione per le tile" << std::endl;
+        return false;
+    }
+
+    TileArchive::TileType type = TileArchive::TileType::PNG;
+    if (options_.format.type == ImageFormat::Type::JPEG) {
+        type = TileArchive::TileType::JPEG;
+    } else if (options_.format.type == ImageFormat::Type::WebP) {
+        type = TileArchive::TileType::WebP;
+    }
+    TileArchive archive;
+    if (!archive.open(archive_path, type)) {
+        return false;
+    }
+    archive.setMetadata(data_->event_id, data_->asteroid_name + " / " + data_->star_name);
+
+    double min_lon = std::numeric_limits<double>::max(), min_lat = std::numeric_limits<double>::max();
+    double max_lon = std::numeric_limits<double>::lowest(), max_lat = std::numeric_limits<double>::lowest();
+    for (const auto* line : {&data_->central_line, &data_->northern_limit, &data_->southern_limit}) {
+        for (const auto& p : *line) {
+            min_lon = std::min(min_lon, p.longitude);
+            max_lon = std::max(max_lon, p.longitude);
+            min_lat = std::min(min_lat, p.latitude);
+            max_lat = std::max(max_lat, p.latitude);
+        }
+    }
+    if (min_lon <= max_lon) {
+        archive.setBounds(min_lon, min_lat, max_lon, max_lat);
+    }
+
+    if (!render([&archive](const TileCoord& tile, const std::string& png) {
+            return archive.addTile(tile, png);
+        }, stats)) {
+        return false;
+    }
+    return archive.finalize();
+}
+
+} // namespace ioc_earth
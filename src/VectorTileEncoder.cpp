@@ -0,0 +1,273 @@
+#include "VectorTileEncoder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace ioc_earth {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kDegToRad = kPi / 180.0;
+
+// Latitudine massima della griglia Web Mercator
+constexpr double kMaxTileLat = 85.05112878;
+
+// Comandi di geometria MVT
+constexpr std::uint32_t kMoveTo = 1;
+constexpr std::uint32_t kLineTo = 2;
+
+// Tipi di filo protobuf
+constexpr std::uint32_t kVarint = 0;
+constexpr std::uint32_t kFixed64 = 1;
+constexpr std::uint32_t kLengthDelimited = 2;
+
+inline std::uint32_t command(std::uint32_t id, std::uint32_t count) {
+    return (id & 0x7) | (count << 3);
+}
+
+inline std::uint32_t zigzag(std::int32_t value) {
+    return (static_cast<std::uint32_t>(value) << 1) ^ static_cast<std::uint32_t>(value >> 31);
+}
+
+void writeVarint(std::string& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+inline void writeKey(std::string& out, std::uint32_t field, std::uint32_t wire_type) {
+    writeVarint(out, (field << 3) | wire_type);
+}
+
+void writeBytes(std::string& out, std::uint32_t field, const std::string& bytes) {
+    writeKey(out, field, kLengthDelimited);
+    writeVarint(out, bytes.size());
+    out += bytes;
+}
+
+void writePacked(std::string& out, std::uint32_t field, const std::vector<std::uint32_t>& values) {
+    if (values.empty()) return;
+    std::string packed;
+    for (std::uint32_t v : values) {
+        writeVarint(packed, v);
+    }
+    writeBytes(out, field, packed);
+}
+
+std::string encodeValue(const VectorTileValue& value) {
+    std::string out;
+    if (const auto* text = std::get_if<std::string>(&value)) {
+        writeBytes(out, 1, *text);
+    } else if (const auto* number = std::get_if<double>(&value)) {
+        writeKey(out, 3, kFixed64);
+        std::uint64_t bits;
+        std::memcpy(&bits, number, sizeof(bits));
+        for (int i = 0; i < 8; ++i) {
+            out.push_back(static_cast<char>((bits >> (8 * i)) & 0xFF));
+        }
+    } else {
+        const std::int64_t integer = std::get<std::int64_t>(value);
+        writeKey(out, 6, kVarint);   // sint64
+        writeVarint(out, (static_cast<std::uint64_t>(integer) << 1) ^ static_cast<std::uint64_t>(integer >> 63));
+    }
+    return out;
+}
+
+/**
+ * @brief Ritaglia il segmento p0-p1 sul box [lo, hi]² (Liang-Barsky)
+ * @return false se il segmento è tutto fuori; t0/t1 delimitano la parte interna
+ */
+bool clipSegment(double x0, double y0, double x1, double y1, double lo, double hi,
+                 double& t0, double& t1) {
+    t0 = 0.0;
+    t1 = 1.0;
+    const double dx = x1 - x0, dy = y1 - y0;
+    const double p[4] = {-dx, dx, -dy, dy};
+    const double q[4] = {x0 - lo, hi - x0, y0 - lo, hi - y0};
+    for (int i = 0; i < 4; ++i) {
+        if (p[i] == 0.0) {
+            if (q[i] < 0.0) return false;
+            continue;
+        }
+        const double t = q[i] / p[i];
+        if (p[i] < 0.0) {
+            if (t > t1) return false;
+            t0 = std::max(t0, t);
+        } else {
+            if (t < t0) return false;
+            t1 = std::min(t1, t);
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+VectorTileEncoder::VectorTileEncoder(const TileCoord& tile, std::uint32_t extent, std::uint32_t buffer)
+    : tile_(tile), extent_(extent), buffer_(buffer) {
+}
+
+void VectorTileEncoder::beginLayer(const std::string& name) {
+    layers_.emplace_back();
+    layers_.back().name = name;
+}
+
+void VectorTileEncoder::toTile(double lon, double lat, double& x, double& y) const {
+    const double n = static_cast<double>(1u << tile_.z);
+    const double phi = std::max(-kMaxTileLat, std::min(kMaxTileLat, lat)) * kDegToRad;
+    x = ((lon + 180.0) / 360.0 * n - tile_.x) * extent_;
+    y = ((1.0 - std::log(std::tan(phi) + 1.0 / std::cos(phi)) / kPi) / 2.0 * n - tile_.y) * extent_;
+}
+
+void VectorTileEncoder::addTags(Layer& layer, const VectorTileProperties& properties,
+                                std::vector<std::uint32_t>& tags) {
+    tags.reserve(properties.size() * 2);
+    for (const auto& property : properties) {
+        auto key = layer.key_index.emplace(property.first, static_cast<std::uint32_t>(layer.keys.size()));
+        if (key.second) layer.keys.push_back(property.first);
+        auto value = layer.value_index.emplace(property.second, static_cast<std::uint32_t>(layer.values.size()));
+        if (value.second) layer.values.push_back(property.second);
+        tags.push_back(key.first->second);
+        tags.push_back(value.first->second);
+    }
+}
+
+bool VectorTileEncoder::addLine(const CoordinateView& line, const VectorTileProperties& properties) {
+    if (layers_.empty() || line.size() < 2) {
+        return false;
+    }
+
+    // Longitudini continue; la linea viene spostata di un giro del mondo se
+    // così cade più vicino alla tile (tile ai bordi dell'antimeridiano)
+    const double world = static_cast<double>(extent_) * (1u << tile_.z);
+    std::vector<double> xs(line.size()), ys(line.size());
+    double previous_lon = line.x(0);
+    double unwrapped = previous_lon;
+    for (std::size_t i = 0; i < line.size(); ++i) {
+        if (i > 0) {
+            unwrapped += std::remainder(line.x(i) - previous_lon, 360.0);
+            previous_lon = line.x(i);
+        }
+        toTile(unwrapped, line.y(i), xs[i], ys[i]);
+    }
+    const double center = extent_ / 2.0;
+    const double shift = std::round((center - xs[0]) / world) * world;
+
+    // Ritaglio: una parte nuova ogni volta che la linea rientra nel box
+    const double lo = -buffer_, hi = extent_ + buffer_;
+    std::vector<std::vector<std::pair<std::int32_t, std::int32_t>>> parts;
+    bool open = false;
+    auto append = [&parts](double x, double y) {
+        const std::pair<std::int32_t, std::int32_t> p(static_cast<std::int32_t>(std::lround(x)),
+                                                      static_cast<std::int32_t>(std::lround(y)));
+        if (parts.back().empty() || parts.back().back() != p) {
+            parts.back().push_back(p);
+        }
+    };
+    for (std::size_t i = 0; i + 1 < line.size(); ++i) {
+        const double x0 = xs[i] + shift, y0 = ys[i];
+        const double x1 = xs[i + 1] + shift, y1 = ys[i + 1];
+        double t0, t1;
+        if (!clipSegment(x0, y0, x1, y1, lo, hi, t0, t1)) {
+            open = false;
+            continue;
+        }
+        if (!open || t0 > 0.0) {
+            parts.emplace_back();
+            append(x0 + (x1 - x0) * t0, y0 + (y1 - y0) * t0);
+        }
+        append(x0 + (x1 - x0) * t1, y0 + (y1 - y0) * t1);
+        open = t1 >= 1.0;
+    }
+
+    Feature feature{next_id_, 2, {}, {}};
+    std::int32_t cursor_x = 0, cursor_y = 0;
+    for (const auto& part : parts) {
+        if (part.size() < 2) continue;
+        feature.geometry.push_back(command(kMoveTo, 1));
+        feature.geometry.push_back(zigzag(part[0].first - cursor_x));
+        feature.geometry.push_back(zigzag(part[0].second - cursor_y));
+        feature.geometry.push_back(command(kLineTo, static_cast<std::uint32_t>(part.size() - 1)));
+        for (std::size_t i = 1; i < part.size(); ++i) {
+            feature.geometry.push_back(zigzag(part[i].first - part[i - 1].first));
+            feature.geometry.push_back(zigzag(part[i].second - part[i - 1].second));
+        }
+        cursor_x = part.back().first;
+        cursor_y = part.back().second;
+    }
+    if (feature.geometry.empty()) {
+        return false;
+    }
+
+    Layer& layer = layers_.back();
+    addTags(layer, properties, feature.tags);
+    layer.features.push_back(std::move(feature));
+    ++next_id_;
+    return true;
+}
+
+bool VectorTileEncoder::addPoint(double lon, double lat, const VectorTileProperties& properties) {
+    if (layers_.empty()) {
+        return false;
+    }
+
+    double x, y;
+    toTile(lon, lat, x, y);
+    const double world = static_cast<double>(extent_) * (1u << tile_.z);
+    x += std::round((extent_ / 2.0 - x) / world) * world;
+    if (x < -buffer_ || x > extent_ + buffer_ || y < -buffer_ || y > extent_ + buffer_) {
+        return false;
+    }
+
+    Feature feature{next_id_++, 1, {}, {}};
+    feature.geometry = {command(kMoveTo, 1),
+                        zigzag(static_cast<std::int32_t>(std::lround(x))),
+                        zigzag(static_cast<std::int32_t>(std::lround(y)))};
+    Layer& layer = layers_.back();
+    addTags(layer, properties, feature.tags);
+    layer.features.push_back(std::move(feature));
+    return true;
+}
+
+bool VectorTileEncoder::empty() const {
+    return std::all_of(layers_.begin(), layers_.end(),
+                       [](const Layer& layer) { return layer.features.empty(); });
+}
+
+std::string VectorTileEncoder::encode() const {
+    std::string tile;
+    for (const Layer& layer : layers_) {
+        if (layer.features.empty()) continue;
+
+        std::string message;
+        writeKey(message, 15, kVarint);
+        writeVarint(message, 2);                     // Versione della specifica
+        writeBytes(message, 1, layer.name);
+        for (const Feature& feature : layer.features) {
+            std::string encoded;
+            writeKey(encoded, 1, kVarint);
+            writeVarint(encoded, feature.id);
+            writePacked(encoded, 2, feature.tags);
+            writeKey(encoded, 3, kVarint);
+            writeVarint(encoded, feature.type);
+            writePacked(encoded, 4, feature.geometry);
+            writeBytes(message, 2, encoded);
+        }
+        for (const std::string& key : layer.keys) {
+            writeBytes(message, 3, key);
+        }
+        for (const VectorTileValue& value : layer.values) {
+            writeBytes(message, 4, encodeValue(value));
+        }
+        writeKey(message, 5, kVarint);
+        writeVarint(message, extent_);
+
+        writeBytes(tile, 3, message);
+    }
+    return tile;
+}
+
+} // namespace ioc_earth
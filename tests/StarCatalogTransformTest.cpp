@@ -0,0 +1,81 @@
+#include "StarCatalogTransform.h"
+#include <cmath>
+#include <iostream>
+
+using ioc_earth::StarCatalogTransform;
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+int failures = 0;
+
+void check(bool condition, const char* what) {
+    if (!condition) {
+        std::cerr << "FALLITO: " << what << std::endl;
+        ++failures;
+    }
+}
+
+double sexagesimal(double units, double minutes, double seconds) {
+    return units + minutes / 60.0 + seconds / 3600.0;
+}
+
+double arcsecDistance(double ra1, double dec1, double ra2, double dec2) {
+    const double d_ra = std::remainder(ra1 - ra2, 360.0) * std::cos(dec2 * kPi / 180.0);
+    return std::hypot(d_ra, dec1 - dec2) * 3600.0;
+}
+
+/**
+ * Meeus, Astronomical Algorithms, esempio 21.b: θ Persei da J2000.0 al
+ * 2028 novembre 13.19 TD (JD 2462088.69), moto proprio e precessione
+ */
+void testMeeusExample21b() {
+    const double ra0 = sexagesimal(2.0, 44.0, 11.986) * 15.0;
+    const double dec0 = sexagesimal(49.0, 13.0, 42.48);
+    const double pm_ra = 0.03425 * 15.0 * 1000.0 * std::cos(dec0 * kPi / 180.0);  // μα·cosδ, mas/anno
+    const double pm_dec = -0.0895 * 1000.0;
+    const double epoch_jd = 2462088.69;
+
+    double ra = 0.0, dec = 0.0;
+    StarCatalogTransform::transformBatch(&ra0, &dec0, &pm_ra, &pm_dec, 1, sizeof(double),
+                                         epoch_jd, StarCatalogTransform::Options(), &ra, &dec);
+    const double expected_ra = sexagesimal(2.0, 46.0, 11.331) * 15.0;
+    const double expected_dec = sexagesimal(49.0, 20.0, 54.54);
+    const double error = arcsecDistance(ra, dec, expected_ra, expected_dec);
+    std::cout << "Meeus 21.b: errore " << error << "\"" << std::endl;
+    check(error < 0.1, "Meeus 21.b: posizione all'epoca entro 0.1\"");
+
+    // Solo moto proprio: lo spostamento è quello del moto proprio, senza precessione
+    StarCatalogTransform::Options proper_motion_only;
+    proper_motion_only.precession = false;
+    StarCatalogTransform::transformBatch(&ra0, &dec0, &pm_ra, &pm_dec, 1, sizeof(double),
+                                         epoch_jd, proper_motion_only, &ra, &dec);
+    const double years = (epoch_jd - ioc_earth::kJulianDateJ2000) / 365.25;
+    const double expected_shift = std::hypot(pm_ra, pm_dec) / 1000.0 * years;
+    const double shift = arcsecDistance(ra, dec, ra0, dec0);
+    check(std::abs(shift - expected_shift) < 0.01, "Solo moto proprio: spostamento atteso");
+}
+
+void testJulianDate() {
+    double jd = 0.0;
+    check(StarCatalogTransform::julianDateFromISO("2000-01-01T12:00:00Z", jd) &&
+          std::abs(jd - ioc_earth::kJulianDateJ2000) < 1.0e-9, "JD di J2000.0");
+    // Meeus, esempio 7.a: 1957 ottobre 4.81
+    check(StarCatalogTransform::julianDateFromISO("1957-10-04T19:26:24", jd) &&
+          std::abs(jd - 2436116.31) < 1.0e-6, "JD di Meeus 7.a");
+    check(!StarCatalogTransform::julianDateFromISO("2025-13-01", jd), "Mese non valido");
+}
+
+} // namespace
+
+int main() {
+    testMeeusExample21b();
+    testJulianDate();
+    if (failures > 0) {
+        std::cerr << failures << " verifiche fallite" << std::endl;
+        return 1;
+    }
+    std::cout << "Tutte le verifiche superate" << std::endl;
+    return 0;
+}